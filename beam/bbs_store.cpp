@@ -0,0 +1,273 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "bbs_store.h"
+
+namespace beam {
+
+/////////////////////////////
+// BloomFilter
+void BbsStore::BloomFilter::Reset(uint32_t nSize)
+{
+	assert(nSize && !(nSize & (nSize - 1)));
+
+	m_vCounters.assign(nSize, 0);
+	m_nMask = nSize - 1;
+}
+
+uint32_t BbsStore::BloomFilter::get_Pos(const Key& key, uint32_t iProbe) const
+{
+	// the key is a hash, its slices are independent and uniformly distributed
+	static_assert(sizeof(key.m_pData) >= sizeof(uint32_t) * s_Probes, "");
+
+	uint32_t n;
+	memcpy(&n, key.m_pData + sizeof(uint32_t) * iProbe, sizeof(n));
+	return n & m_nMask;
+}
+
+void BbsStore::BloomFilter::Add(const Key& key)
+{
+	for (uint32_t i = 0; i < s_Probes; i++)
+	{
+		uint8_t& n = m_vCounters[get_Pos(key, i)];
+		if (n != 0xff)
+			n++;
+	}
+}
+
+void BbsStore::BloomFilter::Remove(const Key& key)
+{
+	for (uint32_t i = 0; i < s_Probes; i++)
+	{
+		uint8_t& n = m_vCounters[get_Pos(key, i)];
+		assert(n);
+		if (n != 0xff)
+			n--;
+	}
+}
+
+bool BbsStore::BloomFilter::MayContain(const Key& key) const
+{
+	for (uint32_t i = 0; i < s_Probes; i++)
+		if (!m_vCounters[get_Pos(key, i)])
+			return false;
+
+	return true;
+}
+
+/////////////////////////////
+// BbsStore
+static const uint32_t s_BloomMinSize = 1U << 10;
+
+bool BbsStore::Msg::InChannel::operator < (const InChannel& x) const
+{
+	if (m_Channel < x.m_Channel)
+		return true;
+	if (m_Channel > x.m_Channel)
+		return false;
+	return (m_TimePosted < x.m_TimePosted);
+}
+
+BbsStore::BbsStore()
+{
+	m_Bloom.Reset(s_BloomMinSize);
+}
+
+void BbsStore::CalcKey(Key& key, BbsChannel channel, const ByteBuffer& msg)
+{
+	ECC::Hash::Processor hp;
+	if (!msg.empty())
+		hp.Write(&msg.front(), static_cast<uint32_t>(msg.size()));
+	hp << channel >> key;
+}
+
+BbsStore::Msg* BbsStore::Find(const Key& key)
+{
+	if (!m_Bloom.MayContain(key))
+		return nullptr;
+
+	Msg::InKey x;
+	x.m_Value = key;
+
+	Msg::KeySet::iterator it = m_setKeys.find(x);
+	return (m_setKeys.end() == it) ? nullptr : &it->get_ParentObj();
+}
+
+BbsStore::Msg& BbsStore::Insert(const Key& key, BbsChannel channel, Timestamp t, ByteBuffer&& buf, bool bPending)
+{
+	Msg* pMsg = new Msg;
+	pMsg->m_Message = std::move(buf);
+	pMsg->m_Key.m_Value = key;
+	pMsg->m_Channel.m_Channel = channel;
+	pMsg->m_Channel.m_TimePosted = t;
+
+	m_setKeys.insert(pMsg->m_Key);
+	m_setChannels.insert(pMsg->m_Channel);
+	m_mapBuckets[t / m_BucketSpan_s].push_back(pMsg->m_Bucket);
+
+	pMsg->m_bPending = bPending;
+	if (bPending)
+		m_lstPending.push_back(pMsg->m_Pending);
+
+	m_Bloom.Add(key);
+	MaybeResizeBloom();
+
+	return *pMsg;
+}
+
+void BbsStore::DeleteInternal(Msg& x)
+{
+	m_Bloom.Remove(x.m_Key.m_Value);
+
+	m_setKeys.erase(Msg::KeySet::s_iterator_to(x.m_Key));
+	m_setChannels.erase(Msg::ChannelSet::s_iterator_to(x.m_Channel));
+
+	if (x.m_bPending)
+		m_lstPending.erase(Msg::PendingList::s_iterator_to(x.m_Pending));
+
+	delete &x;
+}
+
+void BbsStore::Delete(Msg& x)
+{
+	std::map<Timestamp, Msg::BucketList>::iterator it = m_mapBuckets.find(x.m_Channel.m_TimePosted / m_BucketSpan_s);
+	assert(m_mapBuckets.end() != it);
+
+	it->second.erase(Msg::BucketList::s_iterator_to(x.m_Bucket));
+	if (it->second.empty())
+		m_mapBuckets.erase(it);
+
+	DeleteInternal(x);
+	MaybeResizeBloom();
+}
+
+void BbsStore::Clear()
+{
+	for (std::map<Timestamp, Msg::BucketList>::iterator it = m_mapBuckets.begin(); m_mapBuckets.end() != it; it++)
+		it->second.clear_and_dispose([this](Msg::InBucket* p) { DeleteInternal(p->get_ParentObj()); });
+
+	m_mapBuckets.clear();
+	assert(m_setKeys.empty() && m_setChannels.empty() && m_lstPending.empty());
+
+	m_Bloom.Reset(s_BloomMinSize);
+}
+
+uint32_t BbsStore::DeleteOld(Timestamp tMinToRemain)
+{
+	uint32_t nCount = 0;
+	Timestamp iBucketMin = tMinToRemain / m_BucketSpan_s;
+
+	while (!m_mapBuckets.empty())
+	{
+		std::map<Timestamp, Msg::BucketList>::iterator it = m_mapBuckets.begin();
+		if (it->first > iBucketMin)
+			break;
+
+		Msg::BucketList& lst = it->second;
+		bool bLast = (it->first == iBucketMin);
+
+		if (it->first < iBucketMin)
+		{
+			// the whole bucket is expired
+			nCount += static_cast<uint32_t>(lst.size());
+			lst.clear_and_dispose([this](Msg::InBucket* p) { DeleteInternal(p->get_ParentObj()); });
+		}
+		else
+		{
+			// the bucket of the threshold, only part of it may be expired
+			for (Msg::BucketList::iterator itMsg = lst.begin(); lst.end() != itMsg; )
+			{
+				Msg& x = (itMsg++)->get_ParentObj();
+				if (x.m_Channel.m_TimePosted < tMinToRemain)
+				{
+					lst.erase(Msg::BucketList::s_iterator_to(x.m_Bucket));
+					DeleteInternal(x);
+					nCount++;
+				}
+			}
+		}
+
+		if (lst.empty())
+			m_mapBuckets.erase(it);
+
+		if (bLast)
+			break;
+	}
+
+	MaybeResizeBloom();
+	return nCount;
+}
+
+void BbsStore::MaybeResizeBloom()
+{
+	// keep 16-128 counters per element, i.e. 0.2% false positives at most with 4 probes
+	uint64_t nCounters = static_cast<uint64_t>(get_Count()) << 4;
+	uint32_t nSize = m_Bloom.get_Size();
+
+	if ((nCounters <= nSize) && ((nCounters << 3) >= nSize || (nSize <= s_BloomMinSize)))
+		return;
+
+	uint32_t nSizeNew = s_BloomMinSize;
+	while (nSizeNew < (nCounters << 2))
+		nSizeNew <<= 1;
+
+	if (nSizeNew == nSize)
+		return;
+
+	m_Bloom.Reset(nSizeNew);
+	for (Msg::KeySet::iterator it = m_setKeys.begin(); m_setKeys.end() != it; it++)
+		m_Bloom.Add(it->m_Value);
+}
+
+void BbsStore::Load(NodeDB& db)
+{
+	NodeDB::WalkerBbs wlk(db);
+	for (db.EnumAllBbs(wlk); wlk.MoveNext(); )
+	{
+		ByteBuffer buf;
+		wlk.m_Data.m_Message.Export(buf);
+		Insert(wlk.m_Data.m_Key, wlk.m_Data.m_Channel, wlk.m_Data.m_TimePosted, std::move(buf), false);
+	}
+}
+
+uint32_t BbsStore::Flush(NodeDB& db)
+{
+	if (m_lstPending.empty())
+		return 0;
+
+	uint32_t nCount = 0;
+	NodeDB::Transaction t(db);
+
+	while (!m_lstPending.empty())
+	{
+		Msg& x = m_lstPending.front().get_ParentObj();
+
+		NodeDB::WalkerBbs::Data d;
+		d.m_Key = x.m_Key.m_Value;
+		d.m_Channel = x.m_Channel.m_Channel;
+		d.m_TimePosted = x.m_Channel.m_TimePosted;
+		d.m_Message = NodeDB::Blob(x.m_Message);
+
+		db.BbsIns(d);
+
+		m_lstPending.pop_front();
+		x.m_bPending = false;
+		nCount++;
+	}
+
+	t.Commit();
+	return nCount;
+}
+
+} // namespace beam
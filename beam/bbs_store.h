@@ -0,0 +1,111 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <boost/intrusive/set.hpp>
+#include <boost/intrusive/list.hpp>
+#include "node_db.h"
+
+namespace beam {
+
+// In-memory store of the BBS messages. They are short-lived, hence the DB is only used to survive restarts.
+// - Lookups by key are screened by a counting bloom filter (most of the announced messages are new).
+// - Messages are indexed by channel/time for subscriptions, and grouped in time buckets for O(bucket) expiration.
+// - Persistence is optional and write-behind: new messages are queued, and inserted into the DB in batches.
+struct BbsStore
+{
+	typedef ECC::Hash::Value Key;
+
+	struct Msg
+	{
+		ByteBuffer m_Message;
+		bool m_bPending; // not persisted yet
+
+		struct InKey :public boost::intrusive::set_base_hook<> {
+			Key m_Value;
+			bool operator < (const InKey& x) const { return (m_Value < x.m_Value); }
+			IMPLEMENT_GET_PARENT_OBJ(Msg, m_Key)
+		} m_Key;
+
+		struct InChannel :public boost::intrusive::set_base_hook<> {
+			BbsChannel m_Channel;
+			Timestamp m_TimePosted;
+			bool operator < (const InChannel& x) const;
+			IMPLEMENT_GET_PARENT_OBJ(Msg, m_Channel)
+		} m_Channel;
+
+		struct InBucket :public boost::intrusive::list_base_hook<> {
+			IMPLEMENT_GET_PARENT_OBJ(Msg, m_Bucket)
+		} m_Bucket;
+
+		struct InPending :public boost::intrusive::list_base_hook<> {
+			IMPLEMENT_GET_PARENT_OBJ(Msg, m_Pending)
+		} m_Pending;
+
+		typedef boost::intrusive::set<InKey> KeySet;
+		typedef boost::intrusive::multiset<InChannel> ChannelSet;
+		typedef boost::intrusive::list<InBucket> BucketList;
+		typedef boost::intrusive::list<InPending> PendingList;
+	};
+
+	// Counters instead of bits, so that expired messages can be removed. Saturated counters stick (no false negatives).
+	class BloomFilter
+	{
+		std::vector<uint8_t> m_vCounters;
+		uint32_t m_nMask = 0;
+
+		uint32_t get_Pos(const Key&, uint32_t iProbe) const;
+
+	public:
+		static const uint32_t s_Probes = 4;
+
+		void Reset(uint32_t nSize); // power of 2
+		uint32_t get_Size() const { return m_nMask + 1; }
+
+		void Add(const Key&);
+		void Remove(const Key&);
+		bool MayContain(const Key&) const;
+	};
+
+	Msg::KeySet m_setKeys;
+	Msg::ChannelSet m_setChannels; // ordered by channel, time
+	std::map<Timestamp, Msg::BucketList> m_mapBuckets; // by m_TimePosted / m_BucketSpan_s
+	Msg::PendingList m_lstPending;
+	BloomFilter m_Bloom;
+
+	uint32_t m_BucketSpan_s = 3600; // must not be changed while non-empty
+
+	BbsStore();
+	~BbsStore() { Clear(); }
+
+	static void CalcKey(Key&, BbsChannel, const ByteBuffer&);
+
+	Msg* Find(const Key&);
+	Msg& Insert(const Key&, BbsChannel, Timestamp, ByteBuffer&&, bool bPending); // must be unique (Find it first)
+	void Delete(Msg&);
+	void Clear();
+	uint32_t get_Count() const { return static_cast<uint32_t>(m_setKeys.size()); }
+
+	uint32_t DeleteOld(Timestamp tMinToRemain); // returns the number of deleted messages
+
+	void Load(NodeDB&); // all the messages in the DB, assumed to be unique
+	uint32_t Flush(NodeDB&); // inserts the pending messages in a single transaction, returns their number
+
+private:
+	void DeleteInternal(Msg&); // leaves the bucket as-is
+	void MaybeResizeBloom();
+};
+
+} // namespace beam
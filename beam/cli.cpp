@@ -62,6 +62,7 @@ namespace
 io::Reactor::Ptr reactor;
 
 static const unsigned LOG_ROTATION_PERIOD = 3*60*60*1000; // 3 hours
+static const size_t LOG_ASYNC_QUEUE_SIZE = 16 * 1024; // records, the node logs asynchronously
 
 int main_impl(int argc, char* argv[])
 {
@@ -109,7 +110,7 @@ int main_impl(int argc, char* argv[])
 #endif
 
 		const auto path = boost::filesystem::system_complete("./logs");
-		auto logger = beam::Logger::create(logLevel, logLevel, fileLogLevel, "node_", path.string());
+		auto logger = beam::Logger::create(logLevel, logLevel, fileLogLevel, "node_", path.string(), LOG_ASYNC_QUEUE_SIZE);
 
 		try
 		{
@@ -146,6 +147,10 @@ int main_impl(int argc, char* argv[])
 					node.m_Cfg.m_MiningThreads = vm[cli::MINING_THREADS].as<uint32_t>();
 					node.m_Cfg.m_MinerID = vm[cli::MINER_ID].as<uint32_t>();
 					node.m_Cfg.m_VerificationThreads = vm[cli::VERIFICATION_THREADS].as<int>();
+
+					node.m_Cfg.m_MetricsListen.port(vm[cli::METRICS_PORT].as<uint16_t>());
+					node.m_Cfg.m_MetricsListen.ip(INADDR_LOOPBACK);
+					node.m_Cfg.m_Timeout.m_MetricsDump_ms = vm[cli::METRICS_PERIOD].as<uint32_t>() * 1000;
 					if (node.m_Cfg.m_MiningThreads > 0)
 					{
 						if (!beam::read_wallet_seed(node.m_Cfg.m_WalletKey, vm)) {
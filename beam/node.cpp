@@ -31,7 +31,7 @@ void Node::RefreshCongestions()
 	for (TaskSet::iterator it = m_setTasks.begin(); m_setTasks.end() != it; it++)
 		it->m_bRelevant = false;
 
-	m_Processor.EnumCongestions();
+	m_Processor.EnumCongestions(m_Cfg.m_Sync.m_BlocksWindow);
 
 	for (TaskList::iterator it = m_lstTasksUnassigned.begin(); m_lstTasksUnassigned.end() != it; )
 	{
@@ -67,13 +67,6 @@ void Node::WantedTx::OnExpired(const KeyType& key)
 	}
 }
 
-void Node::Bbs::CalcMsgKey(NodeDB::WalkerBbs::Data& d)
-{
-	ECC::Hash::Processor hp;
-	hp.Write(d.m_Message.p, d.m_Message.n);
-	hp << d.m_Channel >> d.m_Key;
-}
-
 uint32_t Node::Bbs::WantedMsg::get_Timeout_ms()
 {
 	return get_ParentObj().get_ParentObj().m_Cfg.m_Timeout.m_GetBbsMsg_ms;
@@ -96,24 +89,19 @@ void Node::Bbs::WantedMsg::OnExpired(const KeyType& key)
 
 void Node::Wanted::Clear()
 {
-	while (!m_lst.empty())
-		DeleteInternal(m_lst.back());
+	while (!m_set.empty())
+		DeleteInternal(*m_set.begin());
 }
 
 void Node::Wanted::DeleteInternal(Item& n)
 {
-	m_lst.erase(List::s_iterator_to(n));
 	m_set.erase(Set::s_iterator_to(n));
-	delete &n;
+	delete &n; // cancels its timeout
 }
 
 void Node::Wanted::Delete(Item& n)
 {
-	bool bFront = (&m_lst.front() == &n);
 	DeleteInternal(n);
-
-	if (bFront)
-		SetTimer();
 }
 
 bool Node::Wanted::Delete(const KeyType& key)
@@ -137,54 +125,25 @@ bool Node::Wanted::Add(const KeyType& key)
 	if (m_set.end() != it)
 		return false; // already waiting for it
 
-	bool bEmpty = m_lst.empty();
-
 	Item* p = new Item;
 	p->m_Key = key;
-	p->m_Advertised_ms = GetTime_ms();
+	p->m_pThis = this;
 
 	m_set.insert(*p);
-	m_lst.push_back(*p);
-
-	if (bEmpty)
-		SetTimer();
+	io::Reactor::get_Current().timer_wheel().set(*p, get_Timeout_ms());
 
 	return true;
 }
 
-void Node::Wanted::SetTimer()
+void Node::Wanted::Item::on_timer()
 {
-	if (m_lst.empty())
-	{
-		if (m_pTimer)
-			m_pTimer->cancel();
-	}
-	else
-	{
-		if (!m_pTimer)
-			m_pTimer = io::Timer::create(io::Reactor::get_Current().shared_from_this());
-
-		uint32_t dt = GetTime_ms() - m_lst.front().m_Advertised_ms;
-		const uint32_t timeout_ms = get_Timeout_ms();
-
-		m_pTimer->start((timeout_ms > dt) ? (timeout_ms - dt) : 0, false, [this]() { OnTimer(); });
-	}
+	m_pThis->OnTimer(*this);
 }
 
-void Node::Wanted::OnTimer()
+void Node::Wanted::OnTimer(Item& n)
 {
-	uint32_t t_ms = GetTime_ms();
-	const uint32_t timeout_ms = get_Timeout_ms();
-
-	while (!m_lst.empty())
-	{
-		Item& n = m_lst.front();
-		if (t_ms - n.m_Advertised_ms < timeout_ms)
-			break;
-
-		OnExpired(n.m_Key); // should not invalidate our structure
-		Delete(n); // will also reschedule the timer
-	}
+	OnExpired(n.m_Key); // should not invalidate our structure
+	DeleteInternal(n);
 }
 
 void Node::TryAssignTask(Task& t, const PeerID* pPeerID)
@@ -198,17 +157,25 @@ void Node::TryAssignTask(Task& t, const PeerID* pPeerID)
 			bool bCreate = false;
 			PeerMan::PeerInfoPlus* pInfo = (PeerMan::PeerInfoPlus*) m_PeerMan.Find(*pPeerID, bCreate);
 
-			if (pInfo && pInfo->m_pLive && pInfo->m_pLive->m_bPiRcvd)
+			if (pInfo && pInfo->m_pLive && pInfo->m_pLive->m_bPiRcvd && ShouldAssignTask(t, *pInfo->m_pLive))
 				pSel = pInfo->m_pLive;
 		}
 
-		for (PeerList::iterator it = m_lstPeers.begin(); !pSel && (m_lstPeers.end() != it); it++)
+		if (!pSel)
 		{
-			Peer& p = *it;
-			if (ShouldAssignTask(t, p))
+			if (t.m_Key.second)
+				pSel = SelectPeerForBlock(t);
+			else
 			{
-				pSel = &p;
-				break;
+				for (PeerList::iterator it = m_lstPeers.begin(); m_lstPeers.end() != it; it++)
+				{
+					Peer& p = *it;
+					if (ShouldAssignTask(t, p))
+					{
+						pSel = &p;
+						break;
+					}
+				}
 			}
 		}
 
@@ -227,6 +194,25 @@ void Node::TryAssignTask(Task& t, const PeerID* pPeerID)
 	}
 }
 
+Node::Peer* Node::SelectPeerForBlock(Task& t)
+{
+	// spread the blocks across all the capable peers, prefer the one that is expected to deliver first.
+	// Peers with unknown performance are tried first
+	Peer* pSel = NULL;
+
+	for (PeerList::iterator it = m_lstPeers.begin(); m_lstPeers.end() != it; it++)
+	{
+		Peer& p = *it;
+		if (!ShouldAssignTask(t, p))
+			continue;
+
+		if (!pSel || (p.m_BlockStats.get_Eta_ms() < pSel->m_BlockStats.get_Eta_ms()))
+			pSel = &p;
+	}
+
+	return pSel;
+}
+
 void Node::AssignTask(Task& t, Peer& p)
 {
 	if (t.m_Key.second)
@@ -246,6 +232,10 @@ void Node::AssignTask(Task& t, Peer& p)
 
 	assert(!t.m_pOwner);
 	t.m_pOwner = &p;
+	t.m_TimeAssigned_ms = GetTime_ms();
+
+	if (t.m_Key.second)
+		p.m_BlockStats.m_InFlight++;
 
 	m_lstTasksUnassigned.erase(TaskList::s_iterator_to(t));
 	p.m_lstTasks.push_back(t);
@@ -271,10 +261,18 @@ bool Node::ShouldAssignTask(Task& t, Peer& p)
 	if (!(p.m_bPiRcvd && p.m_pInfo))
 		return false;
 
-	// check if the peer currently transfers a block
-	for (TaskList::iterator it = p.m_lstTasks.begin(); p.m_lstTasks.end() != it; it++)
-		if (it->m_Key.second)
+	if (t.m_Key.second)
+	{
+		// block requests are pipelined, up to the peer's window
+		if (p.m_BlockStats.m_InFlight >= std::min(p.m_BlockStats.m_Window, m_Cfg.m_Sync.m_MaxBlocksPerPeer))
+			return false;
+	}
+	else
+	{
+		// don't queue header requests behind blocks
+		if (p.m_BlockStats.m_InFlight)
 			return false;
+	}
 
 	return p.m_setRejected.end() == p.m_setRejected.find(t.m_Key);
 }
@@ -294,6 +292,7 @@ void Node::Processor::RequestData(const Block::SystemState::ID& id, bool bBlock,
 		pTask->m_Key = tKey.m_Key;
 		pTask->m_bRelevant = true;
 		pTask->m_pOwner = NULL;
+		pTask->m_TimeAssigned_ms = 0;
 
 		get_ParentObj().m_setTasks.insert(*pTask);
 		get_ParentObj().m_lstTasksUnassigned.push_back(*pTask);
@@ -375,6 +374,9 @@ void Node::Processor::OnRolledBack()
 
 bool Node::Processor::VerifyBlock(const Block::BodyBase& block, TxBase::IReader&& r, const HeightRange& hr)
 {
+	static metrics::Histogram& s_Latency = metrics::Registry::get().histogram("node.verify_block_us");
+	metrics::LatencyTimer lt(s_Latency);
+
 	uint32_t nThreads = get_ParentObj().m_Cfg.m_VerificationThreads;
 	if (!nThreads)
 	{
@@ -417,6 +419,47 @@ bool Node::Processor::VerifyBlock(const Block::BodyBase& block, TxBase::IReader&
 	return !v.m_bFail && v.m_Context.IsValidBlock(block, m_Cursor.m_SubsidyOpen);
 }
 
+bool Node::Processor::VerifyPoW(const Block::SystemState::Full* pS, size_t nCount)
+{
+	uint32_t nThreads = get_ParentObj().m_Cfg.m_VerificationThreads;
+	if ((nThreads <= 1) || (nCount <= 1))
+		return NodeProcessor::VerifyPoW(pS, nCount);
+
+	// The Verifier threads are dedicated to the tx verification. PoW is verified in short-lived threads, each one checks every nThreads-th header
+	std::vector<std::thread> vThreads(nThreads);
+	std::vector<uint8_t> vValid(nThreads, 1);
+
+	for (uint32_t i = 0; i < nThreads; i++)
+		vThreads[i] = std::thread([pS, nCount, nThreads, i, &vValid]()
+		{
+			for (size_t iHdr = i; iHdr < nCount; iHdr += nThreads)
+				if (!pS[iHdr].IsValidPoW())
+				{
+					vValid[i] = 0;
+					break;
+				}
+		});
+
+	bool bValid = true;
+	for (uint32_t i = 0; i < nThreads; i++)
+	{
+		vThreads[i].join();
+		if (!vValid[i])
+			bValid = false;
+	}
+
+	return bValid;
+}
+
+uint32_t Node::Processor::get_BulkThreads()
+{
+	int nThreads = get_ParentObj().m_Cfg.m_VerificationThreads;
+	if (nThreads < 0)
+		nThreads = std::thread::hardware_concurrency(); // may be called before the config is normalized (during initialization)
+
+	return std::max(nThreads, 1);
+}
+
 void Node::Processor::Verifier::Thread(uint32_t iVerifier)
 {
 	std::unique_ptr<Verifier::MyBatch> p(new Verifier::MyBatch);
@@ -512,6 +555,9 @@ Node::Peer* Node::AllocPeer(const beam::io::Address& addr)
 	Peer* pPeer = new Peer(*this);
 	m_lstPeers.push_back(*pPeer);
 
+	pPeer->set_Threads(&m_NetThreads);
+	pPeer->m_SendLimits = m_Cfg.m_SendLimits;
+
 	pPeer->m_pInfo = NULL;
 	pPeer->m_bConnected = false;
 	pPeer->m_bPiRcvd = false;
@@ -521,6 +567,9 @@ Node::Peer* Node::AllocPeer(const beam::io::Address& addr)
 	pPeer->m_TipWork = Zero;
 	pPeer->m_RemoteAddr = addr;
 	ZeroObject(pPeer->m_Config);
+	pPeer->m_BlockStats.Reset();
+	ZeroObject(pPeer->m_pReconcileCells);
+	ZeroObject(pPeer->m_pReconcileServed);
 
 	LOG_INFO() << "+Peer " << addr;
 
@@ -568,9 +617,12 @@ void Node::Initialize()
 
 	RefreshCongestions();
 
+	if (m_Cfg.m_NetworkThreads)
+		m_NetThreads.Create(m_Cfg.m_NetworkThreads);
+
 	if (m_Cfg.m_Listen.port())
 	{
-		m_Server.Listen(m_Cfg.m_Listen);
+		m_Server.Listen(m_Cfg.m_Listen, &m_NetThreads);
 		if (m_Cfg.m_BeaconPeriod_ms)
 			m_Beacon.Start();
 	}
@@ -635,30 +687,59 @@ void Node::Initialize()
 	if (m_Compressor.m_bEnabled)
 		m_Compressor.Init();
 
-	m_Bbs.Cleanup();
+	m_Bbs.Init();
+
+	m_Metrics.Init();
+}
+
+void Node::Bbs::Init()
+{
+	const Config& cfg = get_ParentObj().m_Cfg; // alias
+
+	m_Store.m_BucketSpan_s = std::max(cfg.m_Timeout.m_BbsCleanupPeriod_ms / 1000, 1U);
+	m_Store.Load(get_ParentObj().m_Processor.get_DB());
+
+	if (cfg.m_Timeout.m_BbsFlush_ms)
+	{
+		m_pTimerFlush = io::Timer::create(io::Reactor::get_Current().shared_from_this());
+		m_pTimerFlush->start(cfg.m_Timeout.m_BbsFlush_ms, true, [this]() { Flush(); });
+	}
+
+	Cleanup();
 }
 
 void Node::Bbs::Cleanup()
 {
-	get_ParentObj().m_Processor.get_DB().BbsDelOld(getTimestamp() - get_ParentObj().m_Cfg.m_Timeout.m_BbsMessageTimeout_s);
+	Timestamp tMinToRemain = getTimestamp() - get_ParentObj().m_Cfg.m_Timeout.m_BbsMessageTimeout_s;
+
+	// expired messages are dropped from memory bucket-wise, the DB deletion is an indexed range delete of the same period
+	uint32_t nCount = m_Store.DeleteOld(tMinToRemain);
+	get_ParentObj().m_Processor.get_DB().BbsDelOld(tMinToRemain);
 	m_LastCleanup_ms = GetTime_ms();
 
+	if (nCount)
+		LOG_INFO() << "Bbs messages expired: " << nCount << ", remaining: " << m_Store.get_Count();
+
 	FindRecommendedChannel();
 }
 
-void Node::Bbs::FindRecommendedChannel()
+void Node::Bbs::Flush()
 {
-	NodeDB& db = get_ParentObj().m_Processor.get_DB(); // alias
+	m_Store.Flush(get_ParentObj().m_Processor.get_DB());
+}
 
+void Node::Bbs::FindRecommendedChannel()
+{
 	uint32_t nChannel = 0, nCount = 0, nCountFound;
 	bool bFound = false;
 
-	NodeDB::WalkerBbs wlk(db);
-	for (db.EnumAllBbs(wlk); ; )
+	BbsStore::Msg::ChannelSet::iterator it = m_Store.m_setChannels.begin();
+	for (; ; )
 	{
-		bool bMoved = wlk.MoveNext();
+		bool bMoved = (m_Store.m_setChannels.end() != it);
+		BbsChannel nChannelNext = bMoved ? (it++)->m_Channel : nChannel;
 
-		if (bMoved && (wlk.m_Data.m_Channel == nChannel))
+		if (bMoved && (nChannelNext == nChannel))
 			nCount++;
 		else
 		{
@@ -669,7 +750,7 @@ void Node::Bbs::FindRecommendedChannel()
 				m_RecommendedChannel = nChannel;
 			}
 
-			if (!bFound && (nChannel + 1 != wlk.m_Data.m_Channel)) // fine also for !bMoved
+			if (!bFound && (nChannel + 1 != nChannelNext)) // fine also for !bMoved
 			{
 				bFound = true;
 				nCountFound = 0;
@@ -679,7 +760,7 @@ void Node::Bbs::FindRecommendedChannel()
 			if (!bMoved)
 				break;
 
-			nChannel = wlk.m_Data.m_Channel;
+			nChannel = nChannelNext;
 			nCount = 1;
 		}
 	}
@@ -730,12 +811,23 @@ Node::~Node()
 
 	m_Compressor.StopCurrent();
 
+	m_Metrics.m_pServer.reset();
+	m_Metrics.m_mapStreams.clear();
+	m_Metrics.m_pTimerStreams.reset();
+
+	if (m_Bbs.m_pTimerFlush)
+		m_Bbs.Flush(); // don't lose the pending messages
+
 	for (PeerList::iterator it = m_lstPeers.begin(); m_lstPeers.end() != it; it++)
 		ZeroObject(it->m_Config); // prevent re-assigning of tasks in the next loop
 
 	while (!m_lstPeers.empty())
 		m_lstPeers.front().DeleteSelf(false, proto::NodeConnection::ByeReason::Stopping);
 
+	// the links flush and close their connections before the network threads stop
+	m_Server.m_pServer.reset();
+	m_NetThreads.Destroy();
+
 	while (!m_lstTasksUnassigned.empty())
 		DeleteUnassignedTask(m_lstTasksUnassigned.front());
 
@@ -840,6 +932,7 @@ void Node::Peer::OnConnectedSecure()
 	msgCfg.m_SpreadingTransactions = true;
 	msgCfg.m_Bbs = true;
 	msgCfg.m_SendPeers = true;
+	msgCfg.m_Reconciliation = m_This.m_Cfg.m_Reconciliation;
 	Send(msgCfg);
 
 	if (m_This.m_Processor.m_Cursor.m_Sid.m_Row)
@@ -992,6 +1085,12 @@ void Node::Peer::ReleaseTask(Task& t)
 	assert(this == t.m_pOwner);
 	t.m_pOwner = NULL;
 
+	if (t.m_Key.second)
+	{
+		assert(m_BlockStats.m_InFlight);
+		m_BlockStats.m_InFlight--;
+	}
+
 	m_lstTasks.erase(TaskList::s_iterator_to(t));
 	m_This.m_lstTasksUnassigned.push_back(t);
 
@@ -1005,6 +1104,13 @@ void Node::Peer::DeleteSelf(bool bIsError, uint8_t nByeReason)
 {
 	LOG_INFO() << "-Peer " << m_RemoteAddr;
 
+	if (m_BlockStats.m_Blocks)
+		LOG_INFO() << "Peer " << m_RemoteAddr << " delivered " << m_BlockStats.m_Blocks << " blocks, " << m_BlockStats.m_Bytes << " bytes, avg " << m_BlockStats.m_Avg_ms << " ms per block";
+
+	const SendStats::PerClass& gossip = get_SendStats().m_p[SendClass::Gossip];
+	if (gossip.m_Dropped)
+		LOG_INFO() << "Peer " << m_RemoteAddr << " was too slow, dropped " << gossip.m_Dropped << " gossip messages";
+
 	if (nByeReason && m_bConnected)
 	{
 		proto::Bye msg;
@@ -1091,6 +1197,7 @@ Node::Task& Node::Peer::get_FirstTask()
 void Node::Peer::OnFirstTaskDone()
 {
 	ReleaseTask(get_FirstTask());
+	TakeTasks(); // the pipeline may have a free slot now
 	SetTimerWrtFirstTask();
 }
 
@@ -1167,12 +1274,52 @@ void Node::Peer::OnMsg(proto::Body&& msg)
 	assert(m_bPiRcvd && m_pInfo);
 	m_This.m_PeerMan.ModifyRating(*m_pInfo, PeerMan::Rating::RewardBlock, true);
 
+	OnBlockDelivered(t, msg.m_Buffer.size());
+
 	const Block::SystemState::ID& id = t.m_Key.first;
 
 	NodeProcessor::DataStatus::Enum eStatus = m_This.m_Processor.OnBlock(id, msg.m_Buffer, m_pInfo->m_ID.m_Key);
 	OnFirstTaskDone(eStatus);
 }
 
+void Node::Peer::OnBlockDelivered(const Task& t, size_t nSize)
+{
+	// the requests are served in order, hence the delivery time is counted since the previous block (or the request, whichever is later)
+	uint32_t t_ms = GetTime_ms();
+	uint32_t dt_ms = t_ms - t.m_TimeAssigned_ms;
+
+	if (m_BlockStats.m_Blocks)
+		dt_ms = std::min(dt_ms, t_ms - m_BlockStats.m_LastRcv_ms);
+
+	m_BlockStats.m_LastRcv_ms = t_ms;
+	m_BlockStats.OnDelivered(dt_ms, nSize, m_This.m_Cfg.m_Sync.m_MaxBlocksPerPeer);
+}
+
+void Node::BlockStats::Reset()
+{
+	ZeroObject(*this);
+	m_Window = 1;
+}
+
+void Node::BlockStats::OnDelivered(uint32_t dt_ms, size_t nSize, uint32_t nWindowMax)
+{
+	dt_ms = std::max(dt_ms, 1U);
+
+	// additive increase, multiplicative decrease
+	if (m_Avg_ms && (dt_ms > m_Avg_ms * s_SlowFactor))
+		m_Window = std::max(m_Window / 2, 1U);
+	else
+		if (m_Window < nWindowMax)
+			m_Window++;
+
+	m_Avg_ms = m_Avg_ms ?
+		(m_Avg_ms * 7 + dt_ms) / 8 :
+		dt_ms;
+
+	m_Blocks++;
+	m_Bytes += nSize;
+}
+
 void Node::Peer::OnFirstTaskDone(NodeProcessor::DataStatus::Enum eStatus)
 {
 	if (NodeProcessor::DataStatus::Invalid == eStatus)
@@ -1215,9 +1362,10 @@ bool Node::Peer::OnNewTransaction(Transaction::Ptr&& ptx)
 	if (bValid)
 		bValid = m_This.m_Processor.ValidateTx(tx, ctx);
 
+	if (Logger::will_log(LOG_LEVEL_INFO))
 	{
-		// Log it
-		std::ostringstream os;
+		// Log it, directly into the log message
+		LogMessage os(LOG_LEVEL_INFO);
 
 		os << "Tx " << key.m_Key << " from " << m_RemoteAddr;
 
@@ -1243,15 +1391,11 @@ bool Node::Peer::OnNewTransaction(Transaction::Ptr&& ptx)
 			os << "\n\tK: Fee=" << tx.m_vKernelsOutput[i]->m_Fee;
 
 		os << "\n\tValid: " << bValid;
-		LOG_INFO() << os.str();
 	}
 
 	if (!bValid)
 		return false;
 
-	proto::HaveTransaction msgOut;
-	msgOut.m_ID = key.m_Key;
-
 	for (PeerList::iterator it = m_This.m_lstPeers.begin(); m_This.m_lstPeers.end() != it; it++)
 	{
 		Peer& peer = *it;
@@ -1260,7 +1404,7 @@ bool Node::Peer::OnNewTransaction(Transaction::Ptr&& ptx)
 		if (!peer.m_Config.m_SpreadingTransactions)
 			continue;
 
-		peer.Send(msgOut);
+		peer.m_Inventory.AddTx(key.m_Key);
 	}
 
 	m_This.m_TxPool.AddValidTx(std::move(ptx), ctx, key.m_Key);
@@ -1282,15 +1426,15 @@ void Node::Peer::OnMsg(proto::Config&& msg)
 		Send(msgHdr);
 	}
 
+	// with reconciliation the peer gets our sets by itself, and vice versa
+	bool bReconcile = m_This.m_Cfg.m_Reconciliation && msg.m_Reconciliation;
+
 	if (!m_Config.m_SpreadingTransactions && msg.m_SpreadingTransactions)
 	{
-		proto::HaveTransaction msgOut;
-
-		for (NodeProcessor::TxPool::TxSet::iterator it = m_This.m_TxPool.m_setTxs.begin(); m_This.m_TxPool.m_setTxs.end() != it; it++)
-		{
-			msgOut.m_ID = it->m_Key;
-			Send(msgOut);
-		}
+		if (bReconcile)
+			RequestSketch(proto::Reconciliation::SetType::Transactions, proto::Reconciliation::s_CellsPerHashMin);
+		else
+			AnnounceAll(proto::Reconciliation::SetType::Transactions);
 	}
 
 	if (m_Config.m_SendPeers != msg.m_SendPeers)
@@ -1311,42 +1455,70 @@ void Node::Peer::OnMsg(proto::Config&& msg)
 
 	if (!m_Config.m_Bbs && msg.m_Bbs)
 	{
-		proto::BbsHaveMsg msgOut;
-
-		NodeDB& db = m_This.m_Processor.get_DB();
-		NodeDB::WalkerBbs wlk(db);
-
-		for (db.EnumAllBbs(wlk); wlk.MoveNext(); )
-		{
-			msgOut.m_Key = wlk.m_Data.m_Key;
-			Send(msgOut);
-		}
+		if (bReconcile)
+			RequestSketch(proto::Reconciliation::SetType::Bbs, proto::Reconciliation::s_CellsPerHashMin);
+		else
+			AnnounceAll(proto::Reconciliation::SetType::Bbs);
 	}
 
 	m_Config = msg;
 }
 
 void Node::Peer::OnMsg(proto::HaveTransaction&& msg)
+{
+	if (!IsTxWanted(msg.m_ID))
+		return;
+
+	proto::GetTransaction msgOut;
+	msgOut.m_ID = msg.m_ID;
+	Send(msgOut);
+}
+
+void Node::Peer::OnMsg(proto::HaveTransactions&& msg)
+{
+	if (msg.m_IDs.size() > proto::Inventory::s_EntriesMax)
+		ThrowUnexpected();
+
+	proto::GetTransactions msgOut;
+
+	for (size_t i = 0; i < msg.m_IDs.size(); i++)
+		if (IsTxWanted(msg.m_IDs[i]))
+			msgOut.m_IDs.push_back(msg.m_IDs[i]);
+
+	if (!msgOut.m_IDs.empty())
+		Send(msgOut);
+}
+
+bool Node::Peer::IsTxWanted(const Transaction::KeyType& id)
 {
 	NodeProcessor::TxPool::Element::Tx key;
-	key.m_Key = msg.m_ID;
+	key.m_Key = id;
 
 	NodeProcessor::TxPool::TxSet::iterator it = m_This.m_TxPool.m_setTxs.find(key);
 	if (m_This.m_TxPool.m_setTxs.end() != it)
-		return; // already have it
+		return false; // already have it
 
-	if (!m_This.m_Wtx.Add(key.m_Key))
-		return; // already waiting for it
-
-	proto::GetTransaction msgOut;
-	msgOut.m_ID = msg.m_ID;
-	Send(msgOut);
+	return m_This.m_Wtx.Add(key.m_Key); // false if already waiting for it
 }
 
 void Node::Peer::OnMsg(proto::GetTransaction&& msg)
+{
+	SendTx(msg.m_ID);
+}
+
+void Node::Peer::OnMsg(proto::GetTransactions&& msg)
+{
+	if (msg.m_IDs.size() > proto::Inventory::s_EntriesMax)
+		ThrowUnexpected();
+
+	for (size_t i = 0; i < msg.m_IDs.size(); i++)
+		SendTx(msg.m_IDs[i]);
+}
+
+void Node::Peer::SendTx(const Transaction::KeyType& id)
 {
 	NodeProcessor::TxPool::Element::Tx key;
-	key.m_Key = msg.m_ID;
+	key.m_Key = id;
 
 	NodeProcessor::TxPool::TxSet::iterator it = m_This.m_TxPool.m_setTxs.find(key);
 	if (m_This.m_TxPool.m_setTxs.end() == it)
@@ -1590,6 +1762,156 @@ void Node::Peer::OnMsg(proto::GetExternalAddr&& msg)
 	Send(msgOut);
 }
 
+uint32_t Node::Peer::get_ReconcileSet(Iblt* pIblt, uint8_t nSetType)
+{
+	switch (nSetType)
+	{
+	case proto::Reconciliation::SetType::Transactions:
+		{
+			const NodeProcessor::TxPool::TxSet& s = m_This.m_TxPool.m_setTxs; // alias
+			if (pIblt)
+				for (NodeProcessor::TxPool::TxSet::const_iterator it = s.begin(); s.end() != it; it++)
+					pIblt->Add(it->m_Key);
+
+			return static_cast<uint32_t>(s.size());
+		}
+
+	case proto::Reconciliation::SetType::Bbs:
+		{
+			const BbsStore::Msg::KeySet& s = m_This.m_Bbs.m_Store.m_setKeys; // alias
+			if (pIblt)
+				for (BbsStore::Msg::KeySet::const_iterator it = s.begin(); s.end() != it; it++)
+					pIblt->Add(it->m_Value);
+
+			return static_cast<uint32_t>(s.size());
+		}
+	}
+
+	ThrowUnexpected();
+	return 0;
+}
+
+void Node::Peer::AnnounceAll(uint8_t nSetType)
+{
+	if (proto::Reconciliation::SetType::Transactions == nSetType)
+	{
+		const NodeProcessor::TxPool::TxSet& s = m_This.m_TxPool.m_setTxs; // alias
+		for (NodeProcessor::TxPool::TxSet::const_iterator it = s.begin(); s.end() != it; it++)
+			m_Inventory.AddTx(it->m_Key);
+	}
+	else
+	{
+		const BbsStore::Msg::KeySet& s = m_This.m_Bbs.m_Store.m_setKeys; // alias
+		for (BbsStore::Msg::KeySet::const_iterator it = s.begin(); s.end() != it; it++)
+			m_Inventory.AddBbs(it->m_Value);
+	}
+}
+
+void Node::Peer::RequestSketch(uint8_t nSetType, uint32_t nCellsPerHash)
+{
+	if (nCellsPerHash > proto::Reconciliation::s_CellsPerHashMax)
+		nCellsPerHash = 0; // too different, ask for the whole set
+
+	m_pReconcileCells[nSetType] = nCellsPerHash;
+
+	proto::GetReconcileSketch msgOut;
+	msgOut.m_SetType = nSetType;
+	msgOut.m_CellsPerHash = nCellsPerHash;
+	Send(msgOut);
+}
+
+void Node::Peer::OnMsg(proto::GetReconcileSketch&& msg)
+{
+	if (!m_This.m_Cfg.m_Reconciliation ||
+		(msg.m_CellsPerHash > proto::Reconciliation::s_CellsPerHashMax) ||
+		(msg.m_SetType >= _countof(m_pReconcileServed)))
+		ThrowUnexpected();
+
+	// each sketch walks the whole set. The peer retries only with a bigger table, and finally asks for the whole set, once
+	uint32_t& nServed = m_pReconcileServed[msg.m_SetType];
+	uint32_t nCells = msg.m_CellsPerHash ? msg.m_CellsPerHash : static_cast<uint32_t>(-1);
+	if (nCells <= nServed)
+		ThrowUnexpected();
+	nServed = nCells;
+
+	if (!msg.m_CellsPerHash)
+	{
+		AnnounceAll(msg.m_SetType);
+		return;
+	}
+
+	Iblt t;
+	t.Reset(msg.m_CellsPerHash);
+
+	proto::ReconcileSketch msgOut;
+	msgOut.m_SetType = msg.m_SetType;
+	msgOut.m_SetSize = get_ReconcileSet(&t, msg.m_SetType);
+	msgOut.m_Cells.swap(t.m_vCells);
+	Send(msgOut);
+}
+
+void Node::Peer::OnMsg(proto::ReconcileSketch&& msg)
+{
+	if ((msg.m_SetType >= _countof(m_pReconcileCells)) || !m_pReconcileCells[msg.m_SetType])
+		ThrowUnexpected(); // not requested
+
+	uint32_t nCellsPerHash = m_pReconcileCells[msg.m_SetType];
+	m_pReconcileCells[msg.m_SetType] = 0;
+
+	Iblt t;
+	t.m_vCells.swap(msg.m_Cells);
+	if (t.m_vCells.size() != nCellsPerHash * Iblt::s_Hashes)
+		ThrowUnexpected();
+
+	// the difference is at least that of the sizes, the table should be ~1.5 times bigger.
+	// The size is reported by the peer, hence the 64-bit arithmetic
+	uint32_t nSize = get_ReconcileSet(NULL, msg.m_SetType);
+	uint64_t nDiffMin3 = uint64_t((nSize > msg.m_SetSize) ? (nSize - msg.m_SetSize) : (msg.m_SetSize - nSize)) * 3;
+
+	if (uint64_t(nCellsPerHash) * Iblt::s_Hashes * 2 < nDiffMin3)
+	{
+		if (uint64_t(proto::Reconciliation::s_CellsPerHashMax) * Iblt::s_Hashes * 2 < nDiffMin3)
+			nCellsPerHash = 0; // too different, ask for the whole set
+		else
+			while (uint64_t(nCellsPerHash) * Iblt::s_Hashes * 2 < nDiffMin3)
+				nCellsPerHash <<= 1;
+
+		RequestSketch(msg.m_SetType, nCellsPerHash);
+		return;
+	}
+
+	Iblt tMy;
+	tMy.Reset(nCellsPerHash);
+	get_ReconcileSet(&tMy, msg.m_SetType);
+	t.Subtract(tMy);
+
+	std::vector<Iblt::Key> vPeer, vMy;
+	if (!t.Decode(vPeer, vMy))
+	{
+		RequestSketch(msg.m_SetType, nCellsPerHash << 1);
+		return;
+	}
+
+	// handle what we miss as if it was announced. What only we have - the peer requests by itself
+	for (size_t i0 = 0; i0 < vPeer.size(); i0 += proto::Inventory::s_EntriesMax)
+	{
+		size_t i1 = std::min(vPeer.size(), i0 + proto::Inventory::s_EntriesMax);
+
+		if (proto::Reconciliation::SetType::Transactions == msg.m_SetType)
+		{
+			proto::HaveTransactions msgHave;
+			msgHave.m_IDs.assign(vPeer.begin() + i0, vPeer.begin() + i1);
+			OnMsg(std::move(msgHave));
+		}
+		else
+		{
+			proto::BbsHaveMsgs msgHave;
+			msgHave.m_Keys.assign(vPeer.begin() + i0, vPeer.begin() + i1);
+			OnMsg(std::move(msgHave));
+		}
+	}
+}
+
 void Node::Peer::OnMsg(proto::BbsMsg&& msg)
 {
 	Timestamp t = getTimestamp();
@@ -1599,28 +1921,21 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
 	if ((msg.m_TimePosted <= t0) || (msg.m_TimePosted > t1))
 		return;
 
-	NodeDB& db = m_This.m_Processor.get_DB();
-	NodeDB::WalkerBbs wlk(db);
-
-	wlk.m_Data.m_Channel = msg.m_Channel;
-	wlk.m_Data.m_TimePosted = msg.m_TimePosted;
-	wlk.m_Data.m_Message = NodeDB::Blob(msg.m_Message);
+	BbsStore& bs = m_This.m_Bbs.m_Store; // alias
 
-	Bbs::CalcMsgKey(wlk.m_Data);
+	BbsStore::Key keyMsg;
+	BbsStore::CalcKey(keyMsg, msg.m_Channel, msg.m_Message);
 
-	if (db.BbsFind(wlk))
+	if (bs.Find(keyMsg))
 		return; // already have it
 
 	m_This.m_Bbs.MaybeCleanup();
 
-	db.BbsIns(wlk.m_Data);
-	m_This.m_Bbs.m_W.Delete(wlk.m_Data.m_Key);
+	const BbsStore::Msg& x = bs.Insert(keyMsg, msg.m_Channel, msg.m_TimePosted, std::move(msg.m_Message), m_This.m_Cfg.m_Timeout.m_BbsFlush_ms > 0);
+	m_This.m_Bbs.m_W.Delete(keyMsg);
 
 	// 1. Send to other BBS-es
 
-	proto::BbsHaveMsg msgOut;
-	msgOut.m_Key = wlk.m_Data.m_Key;
-
 	for (PeerList::iterator it = m_This.m_lstPeers.begin(); m_This.m_lstPeers.end() != it; it++)
 	{
 		Peer& peer = *it;
@@ -1629,7 +1944,7 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
 		if (!peer.m_Config.m_Bbs)
 			continue;
 
-		peer.Send(msgOut);
+		peer.m_Inventory.AddBbs(keyMsg);
 	}
 
 	// 2. Send to subscribed
@@ -1645,49 +1960,121 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
 		if (this == s.m_pPeer)
 			continue;
 
-		s.m_pPeer->SendBbsMsg(wlk.m_Data);
+		s.m_pPeer->SendBbsMsg(x);
 	}
 }
 
 void Node::Peer::OnMsg(proto::BbsHaveMsg&& msg)
 {
-	NodeDB& db = m_This.m_Processor.get_DB();
-	NodeDB::WalkerBbs wlk(db);
-
-	wlk.m_Data.m_Key = msg.m_Key;
-	if (db.BbsFind(wlk))
-		return; // already have it
-
-	if (!m_This.m_Bbs.m_W.Add(msg.m_Key))
-		return; // already waiting for it
+	if (!IsBbsWanted(msg.m_Key))
+		return;
 
 	proto::BbsGetMsg msgOut;
 	msgOut.m_Key = msg.m_Key;
 	Send(msgOut);
 }
 
+void Node::Peer::OnMsg(proto::BbsHaveMsgs&& msg)
+{
+	if (msg.m_Keys.size() > proto::Inventory::s_EntriesMax)
+		ThrowUnexpected();
+
+	proto::BbsGetMsgs msgOut;
+
+	for (size_t i = 0; i < msg.m_Keys.size(); i++)
+		if (IsBbsWanted(msg.m_Keys[i]))
+			msgOut.m_Keys.push_back(msg.m_Keys[i]);
+
+	if (!msgOut.m_Keys.empty())
+		Send(msgOut);
+}
+
+bool Node::Peer::IsBbsWanted(const BbsMsgID& key)
+{
+	if (m_This.m_Bbs.m_Store.Find(key))
+		return false; // already have it
+
+	return m_This.m_Bbs.m_W.Add(key); // false if already waiting for it
+}
+
 void Node::Peer::OnMsg(proto::BbsGetMsg&& msg)
 {
-	NodeDB& db = m_This.m_Processor.get_DB();
-	NodeDB::WalkerBbs wlk(db);
+	SendBbs(msg.m_Key);
+}
 
-	wlk.m_Data.m_Key = msg.m_Key;
-	if (!db.BbsFind(wlk))
-		return; // don't have it
+void Node::Peer::OnMsg(proto::BbsGetMsgs&& msg)
+{
+	if (msg.m_Keys.size() > proto::Inventory::s_EntriesMax)
+		ThrowUnexpected();
 
-	SendBbsMsg(wlk.m_Data);
+	for (size_t i = 0; i < msg.m_Keys.size(); i++)
+		SendBbs(msg.m_Keys[i]);
+}
+
+void Node::Peer::SendBbs(const BbsMsgID& key)
+{
+	const BbsStore::Msg* pMsg = m_This.m_Bbs.m_Store.Find(key);
+	if (pMsg) // otherwise don't have it
+		SendBbsMsg(*pMsg);
 }
 
-void Node::Peer::SendBbsMsg(const NodeDB::WalkerBbs::Data& d)
+void Node::Peer::SendBbsMsg(const BbsStore::Msg& x)
 {
 	proto::BbsMsg msgOut;
-	msgOut.m_Channel = d.m_Channel;
-	msgOut.m_TimePosted = d.m_TimePosted;
-	d.m_Message.Export(msgOut.m_Message); // TODO: avoid buf allocation
+	msgOut.m_Channel = x.m_Channel.m_Channel;
+	msgOut.m_TimePosted = x.m_Channel.m_TimePosted;
+	msgOut.m_Message = x.m_Message; // TODO: avoid buf allocation
 
 	Send(msgOut);
 }
 
+void Node::Peer::Inventory::AddTx(const Transaction::KeyType& key)
+{
+	m_vTxs.push_back(key);
+	OnAdded(m_vTxs.size());
+}
+
+void Node::Peer::Inventory::AddBbs(const BbsMsgID& key)
+{
+	m_vBbs.push_back(key);
+	OnAdded(m_vBbs.size());
+}
+
+void Node::Peer::Inventory::OnAdded(size_t nCount)
+{
+	uint32_t timeout_ms = get_ParentObj().m_This.m_Cfg.m_Timeout.m_InvTrickle_ms;
+
+	if (!timeout_ms || (nCount >= proto::Inventory::s_EntriesMax))
+		Flush();
+	else
+		if (!is_set())
+			io::Reactor::get_Current().timer_wheel().set(*this, timeout_ms);
+}
+
+void Node::Peer::Inventory::on_timer()
+{
+	Flush();
+}
+
+void Node::Peer::Inventory::Flush()
+{
+	cancel();
+
+	if (!m_vTxs.empty())
+	{
+		proto::HaveTransactions msg;
+		msg.m_IDs.swap(m_vTxs);
+		get_ParentObj().Send(msg);
+	}
+
+	if (!m_vBbs.empty())
+	{
+		proto::BbsHaveMsgs msg;
+		msg.m_Keys.swap(m_vBbs);
+		get_ParentObj().Send(msg);
+	}
+}
+
 void Node::Peer::OnMsg(proto::BbsSubscribe&& msg)
 {
 	Bbs::Subscription::InPeer key;
@@ -1707,14 +2094,14 @@ void Node::Peer::OnMsg(proto::BbsSubscribe&& msg)
 		m_This.m_Bbs.m_Subscribed.insert(pS->m_Bbs);
 		m_Subscriptions.insert(pS->m_Peer);
 
-		NodeDB& db = m_This.m_Processor.get_DB();
-		NodeDB::WalkerBbs wlk(db);
+		const BbsStore::Msg::ChannelSet& s = m_This.m_Bbs.m_Store.m_setChannels; // alias
 
-		wlk.m_Data.m_Channel = msg.m_Channel;
-		wlk.m_Data.m_TimePosted = msg.m_TimeFrom;
+		BbsStore::Msg::InChannel key;
+		key.m_Channel = msg.m_Channel;
+		key.m_TimePosted = msg.m_TimeFrom;
 
-		for (db.EnumBbs(wlk); wlk.MoveNext(); )
-			SendBbsMsg(wlk.m_Data);
+		for (BbsStore::Msg::ChannelSet::const_iterator it = s.lower_bound(key); (s.end() != it) && (it->m_Channel == msg.m_Channel); it++)
+			SendBbsMsg(it->get_ParentObj());
 	}
 	else
 		Unsubscribe(it->get_ParentObj());
@@ -1767,6 +2154,8 @@ void Node::Miner::OnRefresh(uint32_t iIdx)
 
 		LOG_INFO() << "Mining nonce = " << s.m_PoW.m_Nonce;
 
+		metrics::LatencyTimer::Clock::time_point tSolve = metrics::LatencyTimer::Clock::now();
+
 		Block::PoW::Cancel fnCancel = [this, pTask](bool bRetrying)
 		{
 			if (*pTask->m_pStop)
@@ -1814,6 +2203,9 @@ void Node::Miner::OnRefresh(uint32_t iIdx)
 				continue;
 		}
 
+		static metrics::Histogram& s_SolveTime = metrics::Registry::get().histogram("node.miner_solve_us");
+		s_SolveTime.record(std::chrono::duration_cast<std::chrono::microseconds>(metrics::LatencyTimer::Clock::now() - tSolve).count());
+
 		std::scoped_lock<std::mutex> scope(m_Mutex);
 
 		if (*pTask->m_pStop)
@@ -2180,15 +2572,181 @@ void Node::Compressor::Proceed()
 	m_Link.m_pEvt->post();
 }
 
+struct Node::Compressor::Squasher
+{
+	// Merges adjacent ranges of the same level (i.e. same number of the original chunks) in the worker threads, while the next chunks are being extracted.
+	// The merge order is the same as of the sequential binary aggregation, but independent pairs are merged concurrently.
+	struct Range
+	{
+		HeightRange m_hr;
+		uint32_t m_Level;
+		bool m_bBusy; // being merged
+	};
+
+	typedef std::list<Range> RangeList;
+
+	struct Job
+	{
+		RangeList::iterator m_it;
+		HeightRange m_hr0;
+		HeightRange m_hr1;
+	};
+
+	Compressor& m_This;
+	RangeList m_lst;
+	std::vector<Job> m_vJobs;
+	std::vector<std::thread> m_vThreads;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Cond;
+
+	uint32_t m_Pending; // jobs queued or running
+	bool m_bFail;
+	bool m_bDone;
+
+	Squasher(Compressor& x, uint32_t nThreads)
+		:m_This(x)
+		,m_Pending(0)
+		,m_bFail(false)
+		,m_bDone(false)
+	{
+		m_vThreads.resize(std::max(nThreads, 1U));
+		for (size_t i = 0; i < m_vThreads.size(); i++)
+			m_vThreads[i] = std::thread(&Squasher::Thread, this);
+	}
+
+	~Squasher()
+	{
+		{
+			std::unique_lock<std::mutex> scope(m_Mutex);
+			m_bDone = true;
+			m_vJobs.clear(); // not started yet
+		}
+
+		m_Cond.notify_all();
+
+		for (size_t i = 0; i < m_vThreads.size(); i++)
+			m_vThreads[i].join();
+	}
+
+	void Schedule(bool bAnyLevel)
+	{
+		// should be called under lock
+		for (RangeList::iterator it = m_lst.begin(); m_lst.end() != it; it++)
+		{
+			RangeList::iterator itNext = it;
+			if (m_lst.end() == ++itNext)
+				break;
+
+			if (it->m_bBusy || itNext->m_bBusy)
+				continue;
+			if (!bAnyLevel && (it->m_Level != itNext->m_Level))
+				continue;
+
+			m_vJobs.emplace_back();
+			Job& job = m_vJobs.back();
+			job.m_it = it;
+			job.m_hr0 = it->m_hr;
+			job.m_hr1 = itNext->m_hr;
+
+			it->m_hr.m_Max = itNext->m_hr.m_Max;
+			it->m_Level = std::max(it->m_Level, itNext->m_Level);
+			it->m_bBusy = true;
+			m_lst.erase(itNext);
+
+			m_Pending++;
+			m_Cond.notify_all();
+		}
+	}
+
+	bool Add(const HeightRange& hr)
+	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
+		if (m_bFail)
+			return false;
+
+		m_lst.emplace_back();
+		Range& r = m_lst.back();
+		r.m_hr = hr;
+		r.m_Level = 0;
+		r.m_bBusy = false;
+
+		Schedule(false);
+		return true;
+	}
+
+	bool Finalize()
+	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
+
+		while (true)
+		{
+			if (m_bFail)
+				return false;
+
+			Schedule(true);
+			if (!m_Pending)
+				break;
+
+			m_Cond.wait(scope);
+		}
+
+		assert(m_lst.size() == 1);
+		return true;
+	}
+
+	void Thread()
+	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
+
+		while (true)
+		{
+			if (m_vJobs.empty())
+			{
+				if (m_bDone)
+					break;
+
+				m_Cond.wait(scope);
+				continue;
+			}
+
+			Job job = m_vJobs.back();
+			m_vJobs.pop_back();
+
+			scope.unlock();
+
+			bool bOk = false;
+			try {
+				bOk = m_This.SquashOnce(job.m_hr0, job.m_hr1);
+			} catch (const std::exception& e) {
+				LOG_WARNING() << e.what();
+			}
+
+			scope.lock();
+
+			if (!bOk)
+				m_bFail = true;
+
+			job.m_it->m_bBusy = false;
+			job.m_it->m_Level++;
+			m_Pending--;
+
+			if (!m_bFail)
+				Schedule(false);
+
+			m_Cond.notify_all();
+		}
+	}
+};
+
 bool Node::Compressor::ProceedInternal()
 {
 	assert(m_hrNew.m_Max);
 	const Config::HistoryCompression& cfg = get_ParentObj().m_Cfg.m_HistoryCompression;
 
-	std::vector<HeightRange> v;
+	Squasher sq(*this, cfg.m_SquashThreads);
 
-	uint32_t i = 0;
-	for (Height hPos = m_hrNew.m_Min; hPos < m_hrNew.m_Max; i++)
+	for (Height hPos = m_hrNew.m_Min; hPos < m_hrNew.m_Max; )
 	{
 		HeightRange hr;
 		hr.m_Min = hPos + 1; // convention is boundary-inclusive, whereas m_hrNew excludes min bound
@@ -2206,15 +2764,14 @@ bool Node::Compressor::ProceedInternal()
 				return false;
 		}
 
-		v.push_back(hr);
-		hPos = hr.m_Max;
+		if (!sq.Add(hr))
+			return false;
 
-		for (uint32_t j = i; 1 & j; j >>= 1)
-			SquashOnce(v);
+		hPos = hr.m_Max;
 	}
 
-	while (v.size() > 1)
-		SquashOnce(v);
+	if (!sq.Finalize())
+		return false;
 
 	if (m_hrNew.m_Min >= Rules::HeightGenesis)
 	{
@@ -2237,21 +2794,13 @@ bool Node::Compressor::ProceedInternal()
 	return true;
 }
 
-bool Node::Compressor::SquashOnce(std::vector<HeightRange>& v)
+bool Node::Compressor::SquashOnce(const HeightRange& hr0, const HeightRange& hr1)
 {
-	assert(v.size() >= 2);
-
-	HeightRange& hr0 = v[v.size() - 2];
-	HeightRange& hr1 = v[v.size() - 1];
-
 	Block::Body::RW rw, rwSrc0, rwSrc1;
 	FmtPath(rw, hr1.m_Max, &hr0.m_Min);
 	FmtPath(rwSrc0, hr0.m_Max, &hr0.m_Min);
 	FmtPath(rwSrc1, hr1.m_Max, &hr1.m_Min);
 
-	hr0.m_Max = hr1.m_Max;
-	v.pop_back();
-
 	rw.m_bAutoDelete = rwSrc0.m_bAutoDelete = rwSrc1.m_bAutoDelete = true;
 
 	if (!SquashOnce(rw, rwSrc0, rwSrc1))
@@ -2500,4 +3049,118 @@ void Node::PeerMan::DeletePeer(PeerInfo& pi)
 	delete (PeerInfoPlus*)&pi;
 }
 
+void Node::Metrics::Init()
+{
+	const Config& cfg = get_ParentObj().m_Cfg;
+
+	if (cfg.m_MetricsListen.port())
+	{
+		m_pServer = io::TcpServer::create(
+			io::Reactor::get_Current().shared_from_this(),
+			cfg.m_MetricsListen,
+			[this](io::TcpStream::Ptr&& newStream, io::ErrorCode errorCode) { OnAccepted(std::move(newStream), errorCode); });
+
+		LOG_INFO() << "Metrics are served on " << cfg.m_MetricsListen;
+	}
+
+	if (cfg.m_Timeout.m_MetricsDump_ms)
+	{
+		m_pTimer = io::Timer::create(io::Reactor::get_Current().shared_from_this());
+		m_pTimer->start(cfg.m_Timeout.m_MetricsDump_ms, true, [this]() { OnTimer(); });
+	}
+}
+
+void Node::Metrics::Update()
+{
+	static metrics::Gauge& s_TxPool = metrics::Registry::get().gauge("node.tx_pool");
+	static metrics::Gauge& s_Peers = metrics::Registry::get().gauge("node.peers");
+	static metrics::Gauge& s_Height = metrics::Registry::get().gauge("node.height");
+	static metrics::Gauge& s_Bbs = metrics::Registry::get().gauge("node.bbs_messages");
+
+	Node& n = get_ParentObj();
+	s_TxPool.set(n.m_TxPool.m_setTxs.size());
+	s_Peers.set(n.m_lstPeers.size());
+	s_Height.set(n.m_Processor.m_Cursor.m_ID.m_Height);
+	s_Bbs.set(n.m_Bbs.m_Store.get_Count());
+}
+
+void Node::Metrics::OnTimer()
+{
+	Update();
+	LOG_INFO() << "Metrics:\n" << metrics::Registry::get().to_text();
+}
+
+void Node::Metrics::OnAccepted(io::TcpStream::Ptr&& newStream, io::ErrorCode)
+{
+	if (!newStream)
+		return;
+
+	uint64_t id = ++m_LastStreamID;
+	io::TcpStream& s = *newStream;
+
+	Stream& x = m_mapStreams[id];
+	x.m_pStream = std::move(newStream);
+	x.m_Accepted_ms = GetTime_ms();
+
+	s.enable_read([this, id](io::ErrorCode errorCode, void* p, size_t n) { OnRequest(id, errorCode, p, n); });
+
+	if (1 == m_mapStreams.size())
+	{
+		if (!m_pTimerStreams)
+			m_pTimerStreams = io::Timer::create(io::Reactor::get_Current().shared_from_this());
+		m_pTimerStreams->start(get_ParentObj().m_Cfg.m_Timeout.m_MetricsRequest_ms, false, [this]() { OnTimerStreams(); });
+	}
+}
+
+void Node::Metrics::OnTimerStreams()
+{
+	// the timeout is the same for all, the oldest stream is the first one
+	uint32_t nTimeout_ms = get_ParentObj().m_Cfg.m_Timeout.m_MetricsRequest_ms;
+	uint32_t t_ms = GetTime_ms();
+
+	while (!m_mapStreams.empty())
+	{
+		uint32_t dt_ms = t_ms - m_mapStreams.begin()->second.m_Accepted_ms;
+		if (dt_ms < nTimeout_ms)
+		{
+			m_pTimerStreams->start(nTimeout_ms - dt_ms, false, [this]() { OnTimerStreams(); });
+			break;
+		}
+
+		m_mapStreams.erase(m_mapStreams.begin());
+	}
+}
+
+void Node::Metrics::OnRequest(uint64_t id, io::ErrorCode errorCode, const void* p, size_t n)
+{
+	auto it = m_mapStreams.find(id);
+	if (m_mapStreams.end() == it)
+		return;
+
+	io::TcpStream::Ptr pStream = std::move(it->second.m_pStream);
+	m_mapStreams.erase(it);
+
+	if (io::EC_OK != errorCode)
+		return;
+
+	// The 1st chunk is enough, the request only selects the format
+	bool bJson = (std::string((const char*) p, n).find("json") != std::string::npos);
+
+	Update();
+	std::string sBody = bJson ?
+		metrics::Registry::get().to_json() :
+		metrics::Registry::get().to_text();
+
+	std::ostringstream os;
+	os << "HTTP/1.0 200 OK\r\n"
+		<< "Content-Type: " << (bJson ? "application/json" : "text/plain") << "\r\n"
+		<< "Content-Length: " << sBody.size() << "\r\n"
+		<< "Connection: close\r\n\r\n"
+		<< sBody;
+
+	std::string sResp = os.str();
+	pStream->write(sResp.data(), sResp.size());
+	pStream->shutdown(); // the reactor completes the write and closes it
+}
+
 } // namespace beam
@@ -15,7 +15,11 @@
 #pragma once
 
 #include "node_processor.h"
+#include "bbs_store.h"
 #include "../utility/io/timer.h"
+#include "../utility/io/timerwheel.h"
+#include "../utility/io/tcpserver.h"
+#include "../utility/metrics.h"
 #include "../core/proto.h"
 #include "../core/block_crypt.h"
 #include <boost/intrusive/list.hpp>
@@ -55,12 +59,22 @@ struct Node
 			uint32_t m_TopPeersUpd_ms = 1000 * 60 * 10; // once in 10 minutes
 			uint32_t m_PeersUpdate_ms	= 1000; // reconsider every second
 			uint32_t m_PeersDbFlush_ms = 1000 * 60; // 1 minute
+			uint32_t m_InvTrickle_ms = 100; // announcements to a peer are batched for this period. 0 - send immediately
 			uint32_t m_BbsMessageTimeout_s	= 3600 * 24; // 1 day
 			uint32_t m_BbsMessageMaxAhead_s	= 3600 * 2; // 2 hours
 			uint32_t m_BbsCleanupPeriod_ms = 3600 * 1000; // 1 hour
+			uint32_t m_BbsFlush_ms = 1000; // write-behind of the new bbs messages. 0 - don't persist them
+			uint32_t m_MetricsDump_ms = 0; // periodic log dump of the metrics, disabled by default
+			uint32_t m_MetricsRequest_ms = 1000 * 5; // connections to the metrics endpoint that don't send the request in time are closed
 		} m_Timeout;
 
+		struct Sync {
+			uint32_t m_BlocksWindow = 64;		// max number of consecutive missing blocks requested simultaneously
+			uint32_t m_MaxBlocksPerPeer = 8;	// max number of block requests pipelined to a single peer
+		} m_Sync;
+
 		uint32_t m_BbsIdealChannelPopulation = 100;
+		bool m_Reconciliation = true; // sync the tx pool and bbs messages with peers via set reconciliation, if they support it
 		uint32_t m_MaxPoolTransactions = 100 * 1000;
 		uint32_t m_MiningThreads = 0; // by default disabled
 		uint32_t m_MinerID = 0; // used as a seed for miner nonce generation
@@ -70,6 +84,17 @@ struct Node
 		// negative: number of cores minus number of mining threads. 
 		int m_VerificationThreads = 0;
 
+		// Number of network threads. If non-zero - the peers' I/O, encryption and message (de)serialization are performed by them,
+		// whereas the message handlers (and the processor) stay in the node thread.
+		uint32_t m_NetworkThreads = 0;
+
+		// Local endpoint that serves the metrics (counters, gauges, latency histograms) as text, or json if requested (i.e. GET /json).
+		// Disabled if the port is 0. Should not be exposed to the outside world.
+		io::Address m_MetricsListen;
+
+		// Per-peer outgoing queue limits. When the peer doesn't keep up - the gossip is dropped first, the requested data is never dropped.
+		proto::NodeConnection::SendLimits m_SendLimits;
+
 		struct HistoryCompression
 		{
 			std::string m_sPathOutput;
@@ -78,6 +103,7 @@ struct Node
 			Height m_Threshold = 60 * 24;		// 1 day roughly. Newer blocks should not be aggregated (not mature enough)
 			Height m_MinAggregate = 60 * 24;	// how many new blocks should produce new file
 			uint32_t m_Naggling = 32;			// combine up to 32 blocks in memory, before involving file system
+			uint32_t m_SquashThreads = 2;		// max number of independent ranges merged concurrently (each with its own bounded stream buffers)
 			uint32_t m_MaxBacklog = 7;
 		} m_HistoryCompression;
 
@@ -107,6 +133,26 @@ struct Node
 
 	NodeProcessor& get_Processor() { return m_Processor; } // for tests only!
 
+	// Block requests are pipelined to a peer, up to its window. The window starts at 1 for each connection, grows by 1
+	// with each block delivered in time, and is halved when a block takes much longer than the average (the peer or the link is congested).
+	// A peer that doesn't deliver at all is disconnected on timeout
+	struct BlockStats
+	{
+		uint32_t m_InFlight;	// block requests currently pipelined to this peer
+		uint32_t m_Window;		// max allowed in-flight requests
+		uint32_t m_Avg_ms;		// moving average of the time it takes to deliver a block. 0 if unknown yet
+		uint32_t m_LastRcv_ms;
+		uint64_t m_Blocks;
+		uint64_t m_Bytes;
+
+		static const uint32_t s_SlowFactor = 4; // delivery time relative to the average, above which the window is shrunk
+
+		void Reset();
+		void OnDelivered(uint32_t dt_ms, size_t nSize, uint32_t nWindowMax);
+
+		uint32_t get_Eta_ms() const { return (m_InFlight + 1) * m_Avg_ms; }
+	};
+
 private:
 
 	struct Processor
@@ -118,6 +164,8 @@ private:
 		void OnNewState() override;
 		void OnRolledBack() override;
 		bool VerifyBlock(const Block::BodyBase&, TxBase::IReader&&, const HeightRange&) override;
+		bool VerifyPoW(const Block::SystemState::Full*, size_t nCount) override;
+		uint32_t get_BulkThreads() override;
 		bool ApproveState(const Block::SystemState::ID&) override;
 		void OnStateData() override;
 		void OnBlockData() override;
@@ -170,6 +218,7 @@ private:
 
 		bool m_bRelevant;
 		Peer* m_pOwner;
+		uint32_t m_TimeAssigned_ms;
 
 		bool operator < (const Task& t) const { return (m_Key < t.m_Key); }
 	};
@@ -182,6 +231,7 @@ private:
 
 	void TryAssignTask(Task&, const PeerID*);
 	bool ShouldAssignTask(Task&, Peer&);
+	Peer* SelectPeerForBlock(Task&);
 	void AssignTask(Task&, Peer&);
 	void DeleteUnassignedTask(Task&);
 
@@ -191,27 +241,25 @@ private:
 
 		struct Item
 			:public boost::intrusive::set_base_hook<>
-			,public boost::intrusive::list_base_hook<>
+			,public io::TimerWheel::Entry
 		{
 			KeyType m_Key;
-			uint32_t m_Advertised_ms;
+			Wanted* m_pThis;
 
 			bool operator < (const Item& n) const { return (m_Key < n.m_Key); }
+
+			// io::TimerWheel::Entry
+			virtual void on_timer() override;
 		};
 
-		typedef boost::intrusive::list<Item> List;
 		typedef boost::intrusive::multiset<Item> Set;
 
-		List m_lst;
-		Set m_set;
-		io::Timer::Ptr m_pTimer;
-		uint32_t m_Timeout_ms = 0;
+		Set m_set; // expiration is tracked by the reactor's timer wheel
 
 		void Delete(Item&);
 		void DeleteInternal(Item&);
 		void Clear();
-		void SetTimer();
-		void OnTimer();
+		void OnTimer(Item&);
 		bool Add(const KeyType&);
 		bool Delete(const KeyType&);
 
@@ -239,12 +287,16 @@ private:
 			IMPLEMENT_GET_PARENT_OBJ(Bbs, m_W)
 		} m_W;
 
-		static void CalcMsgKey(NodeDB::WalkerBbs::Data&);
+		BbsStore m_Store;
+		io::Timer::Ptr m_pTimerFlush;
+
 		uint32_t m_LastCleanup_ms = 0;
 		uint32_t m_RecommendedChannel = 0;
+		void Init();
 		void Cleanup();
 		void FindRecommendedChannel();
 		void MaybeCleanup();
+		void Flush();
 
 		struct Subscription
 		{
@@ -315,10 +367,34 @@ private:
 		proto::Config m_Config;
 
 		TaskList m_lstTasks;
+
+		BlockStats m_BlockStats;
+
 		std::set<Task::Key> m_setRejected; // data that shouldn't be requested from this peer. Reset after reconnection or on receiving NewTip
 
 		Bbs::Subscription::PeerSet m_Subscriptions;
 
+		uint32_t m_pReconcileCells[2]; // requested sketch sizes per set type, 0 if none
+		uint32_t m_pReconcileServed[2]; // the biggest sketch sent to the peer per set type, -1 after the whole set
+
+		// IDs of the new transactions and bbs messages, to be announced in batches
+		struct Inventory
+			:public io::TimerWheel::Entry
+		{
+			std::vector<Transaction::KeyType> m_vTxs;
+			std::vector<BbsMsgID> m_vBbs;
+
+			void AddTx(const Transaction::KeyType&);
+			void AddBbs(const BbsMsgID&);
+			void OnAdded(size_t nCount);
+			void Flush();
+
+			// io::TimerWheel::Entry
+			virtual void on_timer() override;
+
+			IMPLEMENT_GET_PARENT_OBJ(Peer, m_Inventory)
+		} m_Inventory;
+
 		io::Timer::Ptr m_pTimer;
 		io::Timer::Ptr m_pTimerPeers;
 
@@ -334,11 +410,19 @@ private:
 		void SetTimer(uint32_t timeout_ms);
 		void KillTimer();
 		void OnResendPeers();
-		void SendBbsMsg(const NodeDB::WalkerBbs::Data&);
+		void SendBbsMsg(const BbsStore::Msg&);
 		void DeleteSelf(bool bIsError, uint8_t nByeReason);
 		bool OnNewTransaction(Transaction::Ptr&&);
+		bool IsTxWanted(const Transaction::KeyType&);
+		void SendTx(const Transaction::KeyType&);
+		bool IsBbsWanted(const BbsMsgID&);
+		void SendBbs(const BbsMsgID&);
+		uint32_t get_ReconcileSet(Iblt*, uint8_t nSetType); // returns the set size
+		void AnnounceAll(uint8_t nSetType);
+		void RequestSketch(uint8_t nSetType, uint32_t nCellsPerHash);
 
 		Task& get_FirstTask();
+		void OnBlockDelivered(const Task&, size_t nSize);
 		void OnFirstTaskDone();
 		void OnFirstTaskDone(NodeProcessor::DataStatus::Enum);
 
@@ -359,6 +443,8 @@ private:
 		virtual void OnMsg(proto::NewTransaction&&) override;
 		virtual void OnMsg(proto::HaveTransaction&&) override;
 		virtual void OnMsg(proto::GetTransaction&&) override;
+		virtual void OnMsg(proto::HaveTransactions&&) override;
+		virtual void OnMsg(proto::GetTransactions&&) override;
 		virtual void OnMsg(proto::GetMined&&) override;
 		virtual void OnMsg(proto::GetProofState&&) override;
 		virtual void OnMsg(proto::GetProofKernel&&) override;
@@ -368,9 +454,13 @@ private:
 		virtual void OnMsg(proto::PeerInfo&&) override;
 		virtual void OnMsg(proto::GetTime&&) override;
 		virtual void OnMsg(proto::GetExternalAddr&&) override;
+		virtual void OnMsg(proto::ReconcileSketch&&) override;
+		virtual void OnMsg(proto::GetReconcileSketch&&) override;
 		virtual void OnMsg(proto::BbsMsg&&) override;
 		virtual void OnMsg(proto::BbsHaveMsg&&) override;
 		virtual void OnMsg(proto::BbsGetMsg&&) override;
+		virtual void OnMsg(proto::BbsHaveMsgs&&) override;
+		virtual void OnMsg(proto::BbsGetMsgs&&) override;
 		virtual void OnMsg(proto::BbsSubscribe&&) override;
 		virtual void OnMsg(proto::BbsPickChannel&&) override;
 	};
@@ -396,6 +486,8 @@ private:
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_Server)
 	} m_Server;
 
+	proto::NodeConnection::Threads m_NetThreads;
+
 	struct Beacon
 	{
 		struct OutCtx;
@@ -476,9 +568,11 @@ private:
 		void OnNotify();
 		void Proceed();
 		bool ProceedInternal();
-		bool SquashOnce(std::vector<HeightRange>&);
+		bool SquashOnce(const HeightRange& hr0, const HeightRange& hr1);
 		bool SquashOnce(Block::BodyBase::RW&, Block::BodyBase::RW& rwSrc0, Block::BodyBase::RW& rwSrc1);
 
+		struct Squasher;
+
 		PerThread m_Link;
 		std::mutex m_Mutex;
 		std::condition_variable m_Cond;
@@ -493,6 +587,30 @@ private:
 
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_Compressor)
 	} m_Compressor;
+
+	struct Metrics
+	{
+		struct Stream
+		{
+			io::TcpStream::Ptr m_pStream;
+			uint32_t m_Accepted_ms;
+		};
+
+		io::TcpServer::Ptr m_pServer;
+		std::map<uint64_t, Stream> m_mapStreams; // connections waiting for the request, in the order of acceptance
+		uint64_t m_LastStreamID = 0;
+		io::Timer::Ptr m_pTimer;
+		io::Timer::Ptr m_pTimerStreams;
+
+		void Init();
+		void Update(); // samples the gauges
+		void OnAccepted(io::TcpStream::Ptr&&, io::ErrorCode);
+		void OnRequest(uint64_t id, io::ErrorCode, const void*, size_t);
+		void OnTimer();
+		void OnTimerStreams(); // closes the idle ones
+
+		IMPLEMENT_GET_PARENT_OBJ(Node, m_Metrics)
+	} m_Metrics;
 };
 
 } // namespace beam
@@ -72,10 +72,25 @@ namespace beam {
 #define TblBbs_Time				"Time"
 #define TblBbs_Msg				"Message"
 
+const char* NodeDB::Query::get_Name(Enum val)
+{
+	switch (val)
+	{
+#define THE_MACRO(name) case name: return #name;
+	NodeDB_QueryAll(THE_MACRO)
+#undef THE_MACRO
+	default:
+		return "";
+	}
+}
+
 NodeDB::NodeDB()
 	:m_pDb(NULL)
 {
 	ZeroObject(m_pPrep);
+
+	for (int i = 0; i < Query::count; i++)
+		m_pLatency[i] = &metrics::Registry::get().histogram(std::string("db.") + Query::get_Name((Query::Enum) i) + "_us");
 }
 
 NodeDB::~NodeDB()
@@ -127,12 +142,14 @@ void NodeDB::Close()
 
 NodeDB::Recordset::Recordset(NodeDB& db)
 	:m_pStmt(NULL)
+	,m_eQuery(Query::count)
 	,m_DB(db)
 {
 }
 
 NodeDB::Recordset::Recordset(NodeDB& db, Query::Enum val, const char* sql)
 	:m_pStmt(NULL)
+	,m_eQuery(val)
 	,m_DB(db)
 {
 	m_pStmt = m_DB.get_Statement(val, sql);
@@ -155,12 +172,13 @@ void NodeDB::Recordset::Reset()
 void NodeDB::Recordset::Reset(Query::Enum val, const char* sql)
 {
 	Reset();
+	m_eQuery = val;
 	m_pStmt = m_DB.get_Statement(val, sql);
 }
 
 bool NodeDB::Recordset::Step()
 {
-	return m_DB.ExecStep(m_pStmt);
+	return m_DB.ExecStep(m_pStmt, m_eQuery);
 }
 
 void NodeDB::Recordset::StepStrict()
@@ -368,9 +386,16 @@ void NodeDB::ExecQuick(const char* szSql)
 	TestRet(sqlite3_exec(m_pDb, szSql, NULL, NULL, NULL));
 }
 
-bool NodeDB::ExecStep(sqlite3_stmt* pStmt)
+bool NodeDB::ExecStep(sqlite3_stmt* pStmt, Query::Enum val)
 {
-	int nVal = sqlite3_step(pStmt);
+	assert(val < Query::count);
+
+	int nVal;
+	{
+		metrics::LatencyTimer lt(*m_pLatency[val]);
+		nVal = sqlite3_step(pStmt);
+	}
+
 	switch (nVal)
 	{
 
@@ -396,7 +421,7 @@ bool NodeDB::ExecStep(sqlite3_stmt* pStmt)
 
 bool NodeDB::ExecStep(Query::Enum val, const char* sql)
 {
-	return ExecStep(get_Statement(val, sql));
+	return ExecStep(get_Statement(val, sql), val);
 
 }
 
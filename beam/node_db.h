@@ -17,6 +17,7 @@
 #include "../core/common.h"
 #include "../core/block_crypt.h"
 #include "../sqlite/sqlite3.h"
+#include "../utility/metrics.h"
 
 namespace beam {
 
@@ -47,82 +48,88 @@ public:
 
 	struct Query
 	{
+#define NodeDB_QueryAll(macro) \
+	macro(Begin) \
+	macro(Commit) \
+	macro(Rollback) \
+	macro(Scheme) \
+	macro(ParamGet) \
+	macro(ParamIns) \
+	macro(ParamUpd) \
+	macro(StateIns) \
+	macro(StateDel) \
+	macro(StateGet) \
+	macro(StateGetHeightAndPrev) \
+	macro(StateFind) \
+	macro(StateFind2) \
+	macro(StateFindWorkGreater) \
+	macro(StateUpdPrevRow) \
+	macro(StateGetNextFCount) \
+	macro(StateSetNextCount) \
+	macro(StateSetNextCountF) \
+	macro(StateGetHeightAndAux) \
+	macro(StateGetNextFunctional) \
+	macro(StateSetFlags) \
+	macro(StateGetFlags0) \
+	macro(StateGetFlags1) \
+	macro(StateGetChainWork) \
+	macro(StateGetNextCount) \
+	macro(StateSetPeer) \
+	macro(StateGetPeer) \
+	macro(TipAdd) \
+	macro(TipDel) \
+	macro(TipReachableAdd) \
+	macro(TipReachableDel) \
+	macro(EnumTips) \
+	macro(EnumFunctionalTips) \
+	macro(EnumAtHeight) \
+	macro(EnumAncestors) \
+	macro(StateGetPrev) \
+	macro(Unactivate) \
+	macro(Activate) \
+	macro(MmrGet) \
+	macro(MmrSet) \
+	macro(HashForHist) \
+	macro(SpendableAdd) \
+	macro(SpendableDel) \
+	macro(SpendableModify) \
+	macro(SpendableEnum) \
+	macro(SpendableGetBody) \
+	macro(StateGetBlock) \
+	macro(StateSetBlock) \
+	macro(StateDelBlock) \
+	macro(StateSetRollback) \
+	macro(MinedIns) \
+	macro(MinedUpd) \
+	macro(MinedDel) \
+	macro(MinedSel) \
+	macro(MacroblockEnum) \
+	macro(MacroblockIns) \
+	macro(MacroblockDel) \
+	macro(PeerAdd) \
+	macro(PeerDel) \
+	macro(PeerEnum) \
+	macro(BbsEnum) \
+	macro(BbsEnumAll) \
+	macro(BbsFind) \
+	macro(BbsDelOld) \
+	macro(BbsIns) \
+	macro(Dbg0) \
+	macro(Dbg1) \
+	macro(Dbg2) \
+	macro(Dbg3) \
+	macro(Dbg4)
+
 		enum Enum
 		{
-			Begin,
-			Commit,
-			Rollback,
-			Scheme,
-			ParamGet,
-			ParamIns,
-			ParamUpd,
-			StateIns,
-			StateDel,
-			StateGet,
-			StateGetHeightAndPrev,
-			StateFind,
-			StateFind2,
-			StateFindWorkGreater,
-			StateUpdPrevRow,
-			StateGetNextFCount,
-			StateSetNextCount,
-			StateSetNextCountF,
-			StateGetHeightAndAux,
-			StateGetNextFunctional,
-			StateSetFlags,
-			StateGetFlags0,
-			StateGetFlags1,
-			StateGetChainWork,
-			StateGetNextCount,
-			StateSetPeer,
-			StateGetPeer,
-			TipAdd,
-			TipDel,
-			TipReachableAdd,
-			TipReachableDel,
-			EnumTips,
-			EnumFunctionalTips,
-			EnumAtHeight,
-			EnumAncestors,
-			StateGetPrev,
-			Unactivate,
-			Activate,
-			MmrGet,
-			MmrSet,
-			HashForHist,
-			SpendableAdd,
-			SpendableDel,
-			SpendableModify,
-			SpendableEnum,
-			SpendableGetBody,
-			StateGetBlock,
-			StateSetBlock,
-			StateDelBlock,
-			StateSetRollback,
-			MinedIns,
-			MinedUpd,
-			MinedDel,
-			MinedSel,
-			MacroblockEnum,
-			MacroblockIns,
-			MacroblockDel,
-			PeerAdd,
-			PeerDel,
-			PeerEnum,
-			BbsEnum,
-			BbsEnumAll,
-			BbsFind,
-			BbsDelOld,
-			BbsIns,
-
-			Dbg0,
-			Dbg1,
-			Dbg2,
-			Dbg3,
-			Dbg4,
+#define THE_MACRO(name) name,
+			NodeDB_QueryAll(THE_MACRO)
+#undef THE_MACRO
 
 			count
 		};
+
+		static const char* get_Name(Enum);
 	};
 
 
@@ -149,6 +156,7 @@ public:
 	class Recordset
 	{
 		sqlite3_stmt* m_pStmt;
+		Query::Enum m_eQuery;
 	public:
 
 		NodeDB & m_DB;
@@ -350,6 +358,7 @@ private:
 
 	sqlite3* m_pDb;
 	sqlite3_stmt* m_pPrep[Query::count];
+	metrics::Histogram* m_pLatency[Query::count]; // per-step timings
 
 	void TestRet(int);
 	void ThrowSqliteError(int);
@@ -358,7 +367,7 @@ private:
 
 	void Create();
 	void ExecQuick(const char*);
-	bool ExecStep(sqlite3_stmt*);
+	bool ExecStep(sqlite3_stmt*, Query::Enum);
 	bool ExecStep(Query::Enum, const char*); // returns true while there's a row
 
 	sqlite3_stmt* get_Statement(Query::Enum, const char*);
@@ -115,43 +115,48 @@ void NodeProcessor::Initialize(const char* szPath)
 
 	InitCursor();
 
-	if (!m_Cursor.m_SubsidyOpen)
-		OnSubsidyOptionChanged(m_Cursor.m_SubsidyOpen);
-
-	// Load all the 'live' data
+	// Load all the 'live' data. Collect and sort the keys, then build the trees in bulk
 	{
 		struct Walker
 			:public UnspentWalker
 		{
+			std::vector<UtxoTree::Entry> m_vUtxos;
+			std::vector<Merkle::Hash> m_vKernels;
+
 			Walker(NodeProcessor& me) :UnspentWalker(me) {}
 
 			virtual bool OnUtxo(const UtxoTree::Key& key) override
 			{
-				UtxoTree::Cursor cu;
-				bool bCreate = true;
-
-				m_This.m_Utxos.Find(cu, key, bCreate)->m_Value.m_Count = m_nUnspentCount;
-				assert(bCreate);
-
+				m_vUtxos.emplace_back();
+				m_vUtxos.back().m_Key = key;
+				m_vUtxos.back().m_Value.m_Count = m_nUnspentCount;
 				return true;
 			}
 
 			virtual bool OnKernel(const Merkle::Hash& key) override
 			{
-				RadixHashOnlyTree::Cursor cu;
-				bool bCreate = true;
-
-				m_This.m_Kernels.Find(cu, key, bCreate);
-				assert(bCreate);
-
+				m_vKernels.push_back(key);
 				return true;
 			}
 		};
 
 		Walker wlk(*this);
 		wlk.Traverse();
+
+		std::sort(wlk.m_vUtxos.begin(), wlk.m_vUtxos.end(), [](const UtxoTree::Entry& a, const UtxoTree::Entry& b) { return a.m_Key < b.m_Key; });
+		std::sort(wlk.m_vKernels.begin(), wlk.m_vKernels.end());
+
+		uint32_t nThreads = get_BulkThreads();
+
+		if (!wlk.m_vUtxos.empty())
+			m_Utxos.BuildSorted(&wlk.m_vUtxos.front(), wlk.m_vUtxos.size(), nThreads);
+		if (!wlk.m_vKernels.empty())
+			m_Kernels.BuildSorted(&wlk.m_vKernels.front(), wlk.m_vKernels.size(), nThreads);
 	}
 
+	if (!m_Cursor.m_SubsidyOpen)
+		OnSubsidyOptionChanged(m_Cursor.m_SubsidyOpen); // after the bulk build, which assumes empty trees
+
 	NodeDB::Transaction t(m_DB);
 	TryGoUp();
 	t.Commit();
@@ -179,23 +184,43 @@ void NodeProcessor::InitCursor()
 	m_Cursor.m_SubsidyOpen = 0 != (m_DB.ParamIntGetDef(NodeDB::ParamID::SubsidyOpen, 1));
 }
 
-void NodeProcessor::EnumCongestions()
+void NodeProcessor::EnumCongestions(uint32_t nMaxBlocksPending)
 {
+	if (!nMaxBlocksPending)
+		nMaxBlocksPending = 1;
+
+	// the lowest missing blocks of the current branch, in a circular buffer (we walk the branch backwards)
+	std::vector<uint64_t> vMissing;
+
 	// request all potentially missing data
 	NodeDB::WalkerState ws(m_DB);
 	for (m_DB.EnumTips(ws); ws.MoveNext(); )
 	{
 		NodeDB::StateID& sid = ws.m_Sid; // alias
-		if (NodeDB::StateFlags::Reachable & m_DB.GetStateFlags(sid.m_Row))
+		uint32_t nFlags = m_DB.GetStateFlags(sid.m_Row);
+		if (NodeDB::StateFlags::Reachable & nFlags)
 			continue;
 
 		if (sid.m_Height < m_Cursor.m_Sid.m_Height)
 			continue; // not interested in tips behind the current cursor
 
 		bool bBlock = true;
+		uint64_t nMissing = 0;
 
-		while (sid.m_Height > Rules::HeightGenesis)
+		while (true)
 		{
+			if (!(NodeDB::StateFlags::Functional & nFlags))
+			{
+				size_t iPos = static_cast<size_t>(nMissing++ % nMaxBlocksPending);
+				if (iPos < vMissing.size())
+					vMissing[iPos] = sid.m_Row;
+				else
+					vMissing.push_back(sid.m_Row);
+			}
+
+			if (sid.m_Height <= Rules::HeightGenesis)
+				break;
+
 			NodeDB::StateID sidThis = sid;
 			if (!m_DB.get_Prev(sid))
 			{
@@ -203,30 +228,50 @@ void NodeProcessor::EnumCongestions()
 				break;
 			}
 
-			if (NodeDB::StateFlags::Reachable & m_DB.GetStateFlags(sid.m_Row))
+			nFlags = m_DB.GetStateFlags(sid.m_Row);
+			if (NodeDB::StateFlags::Reachable & nFlags)
 			{
 				sid = sidThis;
 				break;
 			}
 		}
 
-		Block::SystemState::Full s;
-		m_DB.get_State(sid.m_Row, s);
-
-		Block::SystemState::ID id;
-
-		if (bBlock)
-			s.get_ID(id);
-		else
+		if (!bBlock)
 		{
+			// headers are still missing. Blocks can't be interpreted before the branch is linked
+			Block::SystemState::Full s;
+			m_DB.get_State(sid.m_Row, s);
+
+			Block::SystemState::ID id;
 			id.m_Height = s.m_Height - 1;
 			id.m_Hash = s.m_Prev;
+
+			PeerID peer;
+			bool bPeer = m_DB.get_Peer(sid.m_Row, peer);
+
+			RequestData(id, false, bPeer ? &peer : NULL);
+			continue;
 		}
 
-		PeerID peer;
-		bool bPeer = m_DB.get_Peer(sid.m_Row, peer);
+		// request the missing blocks within the window, lowest first, so that they can be interpreted as they arrive
+		assert(nMissing);
+		uint64_t nWindow = std::min<uint64_t>(nMissing, nMaxBlocksPending);
+
+		for (uint64_t i = nMissing; i-- > nMissing - nWindow; )
+		{
+			uint64_t rowid = vMissing[static_cast<size_t>(i % nMaxBlocksPending)];
+
+			Block::SystemState::Full s;
+			m_DB.get_State(rowid, s);
+
+			Block::SystemState::ID id;
+			s.get_ID(id);
 
-		RequestData(id, bBlock, bPeer ? &peer : NULL);
+			PeerID peer;
+			bool bPeer = m_DB.get_Peer(rowid, peer);
+
+			RequestData(id, true, bPeer ? &peer : NULL);
+		}
 	}
 }
 
@@ -401,6 +446,9 @@ struct NodeProcessor::RollbackData
 
 bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, bool bFwd)
 {
+	static metrics::Histogram& s_Latency = metrics::Registry::get().histogram("node.handle_block_us");
+	metrics::LatencyTimer lt(s_Latency);
+
 	ByteBuffer bb;
 	RollbackData rbData;
 	m_DB.GetStateBlock(sid.m_Row, bb, rbData.m_Buf);
@@ -411,7 +459,7 @@ bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, bool bFwd)
 	Block::SystemState::ID id;
 	s.get_ID(id);
 
-	Block::Body block;
+	Block::BodyFlat block;
 	try {
 
 		Deserializer der;
@@ -735,9 +783,8 @@ struct NodeProcessor::UtxoSig
 	}
 };
 
-bool NodeProcessor::HandleBlockElement(const Output& v, Height h, const Height* pHMax, bool bFwd)
+bool NodeProcessor::get_UtxoKey(UtxoTree::Key::Data& d, const Output& v, Height h, const Height* pHMax)
 {
-	UtxoTree::Key::Data d;
 	d.m_Commitment = v.m_Commitment;
 	d.m_Maturity = v.get_MinMaturity(h);
 
@@ -751,6 +798,15 @@ bool NodeProcessor::HandleBlockElement(const Output& v, Height h, const Height*
 		d.m_Maturity = v.m_Maturity;
 	}
 
+	return true;
+}
+
+bool NodeProcessor::HandleBlockElement(const Output& v, Height h, const Height* pHMax, bool bFwd)
+{
+	UtxoTree::Key::Data d;
+	if (!get_UtxoKey(d, v, h, pHMax))
+		return false;
+
 	SpendableKey<UtxoTree::Key, DbType::Utxo> skey;
 	skey.m_Key = d;
 	NodeDB::Blob blob(&skey, sizeof(skey));
@@ -766,7 +822,7 @@ bool NodeProcessor::HandleBlockElement(const Output& v, Height h, const Height*
 		if (bCreate)
 		{
 			p->m_Value.m_Count = 1;
-			m_DB.AddSpendable(blob, NULL, 1, 1);
+			AddSpendableUtxo(skey.m_Key, 1);
 		}
 		else
 		{
@@ -791,6 +847,92 @@ bool NodeProcessor::HandleBlockElement(const Output& v, Height h, const Height*
 	return true;
 }
 
+void NodeProcessor::AddSpendableUtxo(const UtxoTree::Key& key, Input::Count nCount)
+{
+	SpendableKey<UtxoTree::Key, DbType::Utxo> skey;
+	skey.m_Key = key;
+
+	m_DB.AddSpendable(NodeDB::Blob(&skey, sizeof(skey)), NULL, nCount, nCount);
+}
+
+void NodeProcessor::AddSpendableKernel(const TxKernel& v, const Merkle::Hash& hvID)
+{
+	SpendableKey<Merkle::Hash, DbType::Kernel> skey;
+	skey.m_Key = hvID;
+
+	NodeDB::Blob blob(&skey, sizeof(skey)), body;
+	if (v.m_pHashLock)
+		body = NodeDB::Blob(v.m_pHashLock->m_Preimage);
+
+	m_DB.AddSpendable(blob, v.m_pHashLock ? &body : NULL, 1, 1);
+}
+
+bool NodeProcessor::HandleValidatedTxBulk(TxBase::IReader&& r, Height h, const Height* pHMax)
+{
+	// Collect all the UTXO and kernel keys, sort them, and build the trees in bulk.
+	// Since the state is empty - no inputs are expected, and there's nothing to undo (caller should just clear the trees on failure).
+	std::vector<UtxoTree::Key> vKeys;
+
+	r.Reset();
+	assert(!r.m_pUtxoIn && !r.m_pKernelIn);
+
+	for (; r.m_pUtxoOut; r.NextUtxoOut())
+	{
+		UtxoTree::Key::Data d;
+		if (!get_UtxoKey(d, *r.m_pUtxoOut, h, pHMax))
+			return false;
+
+		vKeys.emplace_back();
+		vKeys.back() = d;
+	}
+
+	std::sort(vKeys.begin(), vKeys.end());
+
+	std::vector<UtxoTree::Entry> vUtxos;
+
+	for (size_t i0 = 0; i0 < vKeys.size(); )
+	{
+		size_t i1 = i0 + 1;
+		while ((i1 < vKeys.size()) && (vKeys[i1] == vKeys[i0]))
+			i1++;
+
+		Input::Count nCount = static_cast<Input::Count>(i1 - i0);
+		if (nCount != i1 - i0)
+			return false; // overflow
+
+		vUtxos.emplace_back();
+		vUtxos.back().m_Key = vKeys[i0];
+		vUtxos.back().m_Value.m_Count = nCount;
+
+		AddSpendableUtxo(vKeys[i0], nCount);
+
+		i0 = i1;
+	}
+
+	std::vector<UtxoTree::Key>().swap(vKeys); // release
+
+	uint32_t nThreads = get_BulkThreads();
+	if (!vUtxos.empty())
+		m_Utxos.BuildSorted(&vUtxos.front(), vUtxos.size(), nThreads);
+
+	std::vector<Merkle::Hash> vKernels;
+	for (; r.m_pKernelOut; r.NextKernelOut())
+	{
+		vKernels.emplace_back();
+		r.m_pKernelOut->get_ID(vKernels.back());
+		AddSpendableKernel(*r.m_pKernelOut, vKernels.back());
+	}
+
+	std::sort(vKernels.begin(), vKernels.end());
+	if (std::adjacent_find(vKernels.begin(), vKernels.end()) != vKernels.end())
+		return false; // the same exactly kernel twice
+
+	if (!vKernels.empty())
+		m_Kernels.BuildSorted(&vKernels.front(), vKernels.size(), nThreads);
+
+	return true;
+}
+
 void NodeProcessor::OnSubsidyOptionChanged(bool bOpen)
 {
 	bool bAdd = !bOpen;
@@ -835,13 +977,8 @@ bool NodeProcessor::HandleBlockElement(const TxKernel& v, bool bFwd, bool bIsInp
 		m_DB.ModifySpendable(blob, 0, bFwd ? -1 : 1);
 	else
 		if (bFwd)
-		{
-			NodeDB::Blob body;
-			if (v.m_pHashLock)
-				body = NodeDB::Blob(v.m_pHashLock->m_Preimage);
-
-			m_DB.AddSpendable(blob, v.m_pHashLock ? &body : NULL, 1, 1);
-		} else
+			AddSpendableKernel(v, skey.m_Key);
+		else
 			m_DB.ModifySpendable(blob, -1, -1);
 
 	return true;
@@ -854,13 +991,13 @@ void NodeProcessor::DereferenceFossilBlock(uint64_t rowid)
 
 	m_DB.GetStateBlock(rowid, bbBlock, rbData.m_Buf);
 
-	Block::Body block;
+	Block::BodyFlat block;
 
 	Deserializer der;
 	der.reset(&bbBlock.at(0), bbBlock.size());
 	der & block;
 
-	Block::Body::Reader r = block.get_Reader();
+	Block::BodyFlat::Reader r = block.get_Reader();
 	r.Reset();
 
 	for (; r.m_pUtxoIn; r.NextUtxoIn())
@@ -930,7 +1067,7 @@ bool NodeProcessor::IsRelevantHeight(Height h)
 	return h >= hFossil + Rules::HeightGenesis;
 }
 
-NodeProcessor::DataStatus::Enum NodeProcessor::OnStateInternal(const Block::SystemState::Full& s, Block::SystemState::ID& id)
+NodeProcessor::DataStatus::Enum NodeProcessor::OnStateInternal(const Block::SystemState::Full& s, Block::SystemState::ID& id, bool bPoWVerified)
 {
 	s.get_ID(id);
 
@@ -940,7 +1077,7 @@ NodeProcessor::DataStatus::Enum NodeProcessor::OnStateInternal(const Block::Syst
 		return DataStatus::Invalid;
 	}
 
-	if (!s.IsValidPoW())
+	if (!bPoWVerified && !s.IsValidPoW())
 	{
 		LOG_WARNING() << id << " PoW invalid";
 		return DataStatus::Invalid;
@@ -1051,6 +1188,9 @@ uint64_t NodeProcessor::FindActiveAtStrict(Height h)
 // TxPool
 bool NodeProcessor::ValidateTx(const Transaction& tx, Transaction::Context& ctx)
 {
+	static metrics::Histogram& s_Latency = metrics::Registry::get().histogram("node.validate_tx_us");
+	metrics::LatencyTimer lt(s_Latency);
+
 	if (!tx.IsValid(ctx))
 		return false;
 
@@ -1061,14 +1201,13 @@ void NodeProcessor::TxPool::AddValidTx(Transaction::Ptr&& pValue, const Transact
 {
 	assert(pValue);
 
-	SerializerSizeCounter ssc;
-	ssc & pValue;
+	size_t nSize = get_serialized_size(pValue);
 
 	Element* p = new Element;
 	p->m_pValue = std::move(pValue);
 	p->m_Threshold.m_Value	= ctx.m_Height.m_Max;
 	p->m_Profit.m_Fee	= ctx.m_Fee.Hi ? Amount(-1) : ctx.m_Fee.Lo; // ignore huge fees (which are  highly unlikely), saturate.
-	p->m_Profit.m_nSize	= (uint32_t) ssc.m_Counter.m_Value;
+	p->m_Profit.m_nSize	= (uint32_t) nSize;
 	p->m_Tx.m_Key = key;
 
 	m_setThreshold.insert(p->m_Threshold);
@@ -1348,13 +1487,16 @@ bool NodeProcessor::GenerateNewBlock(TxPool& txp, Block::SystemState::Full& s, B
 		res.DeleteIntermediateOutputs();
 	}
 
-	Serializer ser;
+	size_t nSize = get_serialized_size(res);
+	if (nSize > Rules::get().MaxBodySize)
+		return false;
 
-	ser.reset();
+	Serializer ser;
+	ser.reserve(nSize); // single allocation
 	ser & res;
 	ser.swap_buf(bbBlock);
 
-	return bbBlock.size() <= Rules::get().MaxBodySize;
+	return true;
 }
 
 bool NodeProcessor::VerifyBlock(const Block::BodyBase& block, TxBase::IReader&& r, const HeightRange& hr)
@@ -1362,6 +1504,15 @@ bool NodeProcessor::VerifyBlock(const Block::BodyBase& block, TxBase::IReader&&
 	return block.IsValid(hr, m_Cursor.m_SubsidyOpen, std::move(r));
 }
 
+bool NodeProcessor::VerifyPoW(const Block::SystemState::Full* pS, size_t nCount)
+{
+	for (size_t i = 0; i < nCount; i++)
+		if (!pS[i].IsValidPoW())
+			return false;
+
+	return true;
+}
+
 void NodeProcessor::ExtractBlockWithExtra(Block::Body& block, const NodeDB::StateID& sid)
 {
 	ByteBuffer bb;
@@ -1496,38 +1647,67 @@ bool NodeProcessor::ImportMacroBlock(Block::BodyBase::IMacroReader& r)
 
 	LOG_INFO() << "Verifying headers...";
 
-	for (bool bFirstTime = true ; r.get_NextHdr(s); s.NextPrefix())
+	// PoW verification is the bottleneck, it's done in batches (possibly in parallel)
+	const size_t nHdrBatch = 1024;
+	std::vector<Block::SystemState::Full> vHdrs;
+	vHdrs.reserve(nHdrBatch);
+
+	for (bool bFirstTime = true ; ; s.NextPrefix())
 	{
-		if (bFirstTime)
+		bool bNext = r.get_NextHdr(s);
+		if (bNext)
 		{
-			bFirstTime = false;
+			if (bFirstTime)
+			{
+				bFirstTime = false;
 
-			Difficulty::Raw wrk;
-			s.m_PoW.m_Difficulty.Inc(wrk, m_Cursor.m_Full.m_ChainWork);
+				Difficulty::Raw wrk;
+				s.m_PoW.m_Difficulty.Inc(wrk, m_Cursor.m_Full.m_ChainWork);
 
-			if (wrk != s.m_ChainWork)
-			{
-				LOG_WARNING() << id << " Chainwork expected=" << wrk << ", actual=" << s.m_ChainWork;
-				return false;
+				if (wrk != s.m_ChainWork)
+				{
+					LOG_WARNING() << id << " Chainwork expected=" << wrk << ", actual=" << s.m_ChainWork;
+					return false;
+				}
 			}
+			else
+				s.m_PoW.m_Difficulty.Inc(s.m_ChainWork);
+
+			vHdrs.push_back(s);
 		}
-		else
-			s.m_PoW.m_Difficulty.Inc(s.m_ChainWork);
 
-		switch (OnStateInternal(s, id))
-		{
-		case DataStatus::Invalid:
+		if (!vHdrs.empty() && (!bNext || (vHdrs.size() == nHdrBatch)))
 		{
-			LOG_WARNING() << "Invald header encountered: " << id;
-			return false;
-		}
+			if (!VerifyPoW(&vHdrs.front(), vHdrs.size()))
+			{
+				vHdrs.front().get_ID(id);
+				LOG_WARNING() << "PoW invalid in headers batch starting at " << id;
+				return false;
+			}
 
-		case DataStatus::Accepted:
-			m_DB.InsertState(s);
+			for (size_t i = 0; i < vHdrs.size(); i++)
+			{
+				switch (OnStateInternal(vHdrs[i], id, true))
+				{
+				case DataStatus::Invalid:
+				{
+					LOG_WARNING() << "Invald header encountered: " << id;
+					return false;
+				}
 
-		default: // suppress the warning of not handling all the enum values
-			break;
+				case DataStatus::Accepted:
+					m_DB.InsertState(vHdrs[i]);
+
+				default: // suppress the warning of not handling all the enum values
+					break;
+				}
+			}
+
+			vHdrs.clear();
 		}
+
+		if (!bNext)
+			break;
 	}
 
 	uint64_t rowid = m_DB.StateFindSafe(id);
@@ -1545,9 +1725,23 @@ bool NodeProcessor::ImportMacroBlock(Block::BodyBase::IMacroReader& r)
 
 	LOG_INFO() << "Applying macroblock...";
 
+	// If imported into the empty state (i.e. from genesis) - there may be no inputs, and the trees are built in bulk
+	r.Reset();
+	bool bBulk = !cu.m_Sid.m_Row && !r.m_pUtxoIn && !r.m_pKernelIn;
+
 	RollbackData rbData;
-	if (!HandleValidatedTx(std::move(r), cu.m_ID.m_Height + 1, true, rbData, &id.m_Height))
+	bool bOk = bBulk ?
+		HandleValidatedTxBulk(std::move(r), cu.m_ID.m_Height + 1, &id.m_Height) :
+		HandleValidatedTx(std::move(r), cu.m_ID.m_Height + 1, true, rbData, &id.m_Height);
+
+	if (!bOk)
 	{
+		if (bBulk)
+		{
+			m_Utxos.Clear();
+			m_Kernels.Clear();
+		}
+
 		LOG_WARNING() << "Invalid in its context";
 		return false;
 	}
@@ -1598,8 +1792,16 @@ bool NodeProcessor::ImportMacroBlock(Block::BodyBase::IMacroReader& r)
 		if (m_Cursor.m_SubsidyOpen != cu.m_SubsidyOpen)
 			OnSubsidyOptionChanged(cu.m_SubsidyOpen);
 
-		rbData.m_Inputs = 0;
-		verify(HandleValidatedTx(std::move(r), cu.m_ID.m_Height + 1, false, rbData, &id.m_Height));
+		if (bBulk)
+		{
+			m_Utxos.Clear();
+			m_Kernels.Clear();
+		}
+		else
+		{
+			rbData.m_Inputs = 0;
+			verify(HandleValidatedTx(std::move(r), cu.m_ID.m_Height + 1, false, rbData, &id.m_Height));
+		}
 
 		// DB changes are not reverted explicitly, but they will be reverted by DB transaction rollback.
 
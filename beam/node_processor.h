@@ -42,10 +42,15 @@ class NodeProcessor
 
 	bool HandleBlock(const NodeDB::StateID&, bool bFwd);
 	bool HandleValidatedTx(TxBase::IReader&&, Height, bool bFwd, RollbackData&, const Height* = NULL);
+	bool HandleValidatedTxBulk(TxBase::IReader&&, Height, const Height* pHMax); // fast path for import into the empty state, no undo
 	void AdjustCumulativeParams(const Block::BodyBase&, bool bFwd);
 	bool HandleBlockElement(const Input&, Height, const Height*, bool bFwd, RollbackData&);
 	bool HandleBlockElement(const Output&, Height, const Height*, bool bFwd);
 	bool HandleBlockElement(const TxKernel&, bool bFwd, bool bIsInput);
+	static bool get_UtxoKey(UtxoTree::Key::Data&, const Output&, Height, const Height* pHMax);
+	// the db part of a new element, shared by the regular and the bulk paths
+	void AddSpendableUtxo(const UtxoTree::Key&, Input::Count);
+	void AddSpendableKernel(const TxKernel&, const Merkle::Hash& hvID);
 	void OnSubsidyOptionChanged(bool);
 
 	static void SquashOnce(std::vector<Block::Body>&);
@@ -112,13 +117,16 @@ public:
 
 	bool get_KernelHashPreimage(const Merkle::Hash& id, ECC::uintBig&);
 
-	void EnumCongestions();
+	// Request the missing headers and blocks. Up to nMaxBlocksPending consecutive missing blocks are requested per branch
+	void EnumCongestions(uint32_t nMaxBlocksPending);
 
 	virtual void RequestData(const Block::SystemState::ID&, bool bBlock, const PeerID* pPreferredPeer) {}
 	virtual void OnPeerInsane(const PeerID&) {}
 	virtual void OnNewState() {}
 	virtual void OnRolledBack() {}
 	virtual bool VerifyBlock(const Block::BodyBase&, TxBase::IReader&&, const HeightRange&);
+	virtual bool VerifyPoW(const Block::SystemState::Full*, size_t nCount); // may be parallelized, the order is irrelevant
+	virtual uint32_t get_BulkThreads() { return 1; } // for the bulk construction of the trees
 	virtual bool ApproveState(const Block::SystemState::ID&) { return true; }
 	virtual void OnStateData() {}
 	virtual void OnBlockData() {}
@@ -194,7 +202,7 @@ public:
 private:
 	bool GenerateNewBlock(TxPool&, Block::SystemState::Full&, Block::Body& block, Amount& fees, Height, RollbackData&);
 	bool GenerateNewBlock(TxPool&, Block::SystemState::Full&, ByteBuffer&, Amount& fees, Block::Body&, bool bInitiallyEmpty);
-	DataStatus::Enum OnStateInternal(const Block::SystemState::Full&, Block::SystemState::ID&);
+	DataStatus::Enum OnStateInternal(const Block::SystemState::Full&, Block::SystemState::ID&, bool bPoWVerified = false);
 };
 
 
@@ -22,6 +22,10 @@
 #include "../../utility/test_helpers.h"
 #include "../../core/serialization_adapters.h"
 
+#ifndef WIN32
+#	include <signal.h>
+#endif // WIN32
+
 #define LOG_VERBOSE_ENABLED 0
 #include "utility/logger.h"
 
@@ -436,6 +440,110 @@ namespace beam
 		}
 	}
 
+	void TestBbsStore()
+	{
+		BbsStore bs;
+		bs.m_BucketSpan_s = 10;
+
+		const uint32_t nMsgs = 5000;
+		std::vector<BbsStore::Key> vKeys;
+
+		for (uint32_t i = 0; i < nMsgs; i++)
+		{
+			ByteBuffer buf(sizeof(i));
+			memcpy(&buf.at(0), &i, sizeof(i));
+
+			BbsChannel ch = i % 7;
+
+			BbsStore::Key key;
+			BbsStore::CalcKey(key, ch, buf);
+			verify_test(!bs.Find(key));
+
+			bs.Insert(key, ch, 100 + i / 10, std::move(buf), true);
+			vKeys.push_back(key);
+		}
+
+		verify_test(bs.get_Count() == nMsgs);
+		verify_test(bs.m_Bloom.get_Size() >= (nMsgs << 4));
+
+		uint32_t nFalsePositives = 0;
+		for (uint32_t i = 0; i < nMsgs; i++)
+		{
+			verify_test(bs.Find(vKeys[i]));
+
+			BbsStore::Key key = vKeys[i];
+			key.Inc();
+			verify_test(!bs.Find(key));
+
+			ByteBuffer buf(sizeof(i));
+			memcpy(&buf.at(0), &i, sizeof(i));
+			BbsStore::CalcKey(key, 1000, buf); // unrelated hash
+
+			verify_test(!bs.Find(key));
+			if (bs.m_Bloom.MayContain(key))
+				nFalsePositives++;
+		}
+
+		verify_test(nFalsePositives * 100 < nMsgs);
+
+		// channel, starting from the specified time
+		BbsStore::Msg::InChannel key;
+		key.m_Channel = 3;
+		key.m_TimePosted = 200;
+
+		uint32_t nCount = 0;
+		for (BbsStore::Msg::ChannelSet::iterator it = bs.m_setChannels.lower_bound(key); (bs.m_setChannels.end() != it) && (it->m_Channel == key.m_Channel); it++)
+		{
+			verify_test(it->m_TimePosted >= key.m_TimePosted);
+			key.m_TimePosted = it->m_TimePosted;
+			nCount++;
+		}
+
+		uint32_t nExpected = 0;
+		for (uint32_t i = 1000; i < nMsgs; i++)
+			if (3 == i % 7)
+				nExpected++;
+
+		verify_test(nCount == nExpected);
+
+		// expiration: whole buckets, and part of the threshold bucket
+		verify_test(bs.DeleteOld(255) == 1550);
+		verify_test(bs.get_Count() == nMsgs - 1550);
+		verify_test(!bs.Find(vKeys[1549]));
+		verify_test(bs.Find(vKeys[1550]));
+
+		bs.Delete(*bs.Find(vKeys[nMsgs - 1]));
+		verify_test(!bs.Find(vKeys[nMsgs - 1]));
+		verify_test(bs.get_Count() == nMsgs - 1551);
+
+		// write-behind
+		DeleteFileA(g_sz);
+		{
+			NodeDB db;
+			db.Open(g_sz);
+
+			verify_test(bs.Flush(db) == bs.get_Count());
+			verify_test(!bs.Flush(db));
+		}
+
+		{
+			NodeDB db;
+			db.Open(g_sz);
+
+			BbsStore bs2;
+			bs2.m_BucketSpan_s = bs.m_BucketSpan_s;
+			bs2.Load(db);
+
+			verify_test(bs2.get_Count() == bs.get_Count());
+			for (uint32_t i = 1550; i + 1 < nMsgs; i++)
+				verify_test(bs2.Find(vKeys[i]));
+
+			verify_test(!bs2.Flush(db));
+		}
+
+		DeleteFileA(g_sz);
+	}
+
 	struct MiniWallet
 	{
 		ECC::Kdf m_Kdf;
@@ -660,7 +768,7 @@ namespace beam
 			rwData.Close();
 
 			verify_test(rwData.Open(true));
-			verify_test(np2.ImportMacroBlock(rwData));
+			verify_test(np2.ImportMacroBlock(rwData)); // into the empty state, bulk
 			rwData.Close();
 
 			verify_test(rwData.Open(false));
@@ -671,11 +779,75 @@ namespace beam
 			verify_test(np2.ImportMacroBlock(rwData));
 			rwData.Close();
 
+			verify_test(np2.m_Cursor.m_ID == np.m_Cursor.m_ID); // time-to-tip
+
 			rwData.Delete();
 		}
 	}
 
 
+	void BenchmarkMacroblockImport(const std::vector<BlockPlus::Ptr>& blockChain)
+	{
+		// time-to-tip of a node that gets the chain as 2 macroblocks: into the empty state (bulk), then on top of it
+		DeleteFileA(g_sz);
+		DeleteFileA(g_sz2);
+
+		NodeProcessor np;
+		np.Initialize(g_sz);
+
+		PeerID peer;
+		ZeroObject(peer);
+
+		for (size_t i = 0; i < blockChain.size(); i++)
+		{
+			np.OnState(blockChain[i]->m_Hdr, peer);
+
+			Block::SystemState::ID id;
+			blockChain[i]->m_Hdr.get_ID(id);
+			np.OnBlock(id, blockChain[i]->m_Body, peer);
+		}
+
+		Height hTip = Rules::HeightGenesis + blockChain.size() - 1;
+		Height hMid = blockChain.size() / 2 + Rules::HeightGenesis;
+		verify_test(np.m_Cursor.m_ID.m_Height == hTip);
+
+		NodeProcessor np2;
+		np2.Initialize(g_sz2);
+
+		Block::BodyBase::RW rwData;
+		rwData.m_sPath = g_sz3;
+
+		helpers::StopWatch sw;
+
+		verify_test(rwData.Open(false));
+		np.ExportMacroBlock(rwData, HeightRange(Rules::HeightGenesis, hMid));
+		rwData.Close();
+
+		verify_test(rwData.Open(true));
+		sw.start();
+		verify_test(np2.ImportMacroBlock(rwData));
+		sw.stop();
+		rwData.Close();
+
+		printf("Macroblock import (from genesis): %u ms\n", static_cast<unsigned int>(sw.milliseconds()));
+
+		verify_test(rwData.Open(false));
+		np.ExportMacroBlock(rwData, HeightRange(hMid + 1, hTip));
+		rwData.Close();
+
+		verify_test(rwData.Open(true));
+		sw.start();
+		verify_test(np2.ImportMacroBlock(rwData));
+		sw.stop();
+		rwData.Close();
+
+		printf("Macroblock import (incremental): %u ms\n", static_cast<unsigned int>(sw.milliseconds()));
+
+		verify_test(np2.m_Cursor.m_ID == np.m_Cursor.m_ID);
+
+		rwData.Delete();
+	}
+
 	class MyNodeProcessor2
 		:public NodeProcessor
 	{
@@ -795,6 +967,19 @@ namespace beam
 		node2.m_Cfg.m_Timeout = node.m_Cfg.m_Timeout;
 
 		node2.m_Cfg.m_BeaconPort = g_Port;
+		node2.m_Cfg.m_NetworkThreads = 2; // peers of node2 are served by network threads
+
+		// queue the outgoing messages whenever the previous ones aren't sent yet
+		node.m_Cfg.m_SendLimits.m_HighWatermark = 1;
+		node.m_Cfg.m_SendLimits.m_LowWatermark = 0;
+
+		// aggregate the history in small chunks, to involve several concurrent merges
+		node.m_Cfg.m_HistoryCompression.m_sPathOutput = g_sz3;
+		node.m_Cfg.m_HistoryCompression.m_sPathTmp = g_sz3;
+		node.m_Cfg.m_HistoryCompression.m_Threshold = 5;
+		node.m_Cfg.m_HistoryCompression.m_MinAggregate = 20;
+		node.m_Cfg.m_HistoryCompression.m_Naggling = 2;
+		node.m_Cfg.m_HistoryCompression.m_SquashThreads = 3;
 
 		ECC::SetRandom(node.m_Cfg.m_WalletKey.V);
 		ECC::SetRandom(node2.m_Cfg.m_WalletKey.V);
@@ -894,6 +1079,11 @@ namespace beam
 
 
 		pReactor->run();
+
+		NodeDB& db = node.get_Processor().get_DB();
+		NodeDB::WalkerState ws(db);
+		db.EnumMacroblocks(ws);
+		verify_test(ws.MoveNext()); // history generated
 	}
 
 
@@ -933,6 +1123,7 @@ namespace beam
 			std::list<uint32_t> m_queProofsKrnExpected;
 			uint32_t m_nChainWorkProofsPending = 0;
 			uint32_t m_nBbsMsgsPending = 0;
+			uint32_t m_nBbsMsgsSent = 0;
 
 
 			MyClient() {
@@ -1032,6 +1223,7 @@ namespace beam
 				Send(msgBbs);
 
 				m_nBbsMsgsPending++;
+				m_nBbsMsgsSent++;
 
 				// assume we've mined this
 				m_Wallet.AddMyUtxo(Rules::get().CoinbaseEmission, msg.m_Description.m_Height, KeyType::Coinbase);
@@ -1248,6 +1440,187 @@ namespace beam
 		cl2.m_pOtherClient = &cl;
 		cl2.Connect(addr);
 
+		struct MyClient3
+			:public proto::NodeConnection
+		{
+			uint32_t m_nKeys = 0; // announced in batches
+			uint32_t m_nMsgs = 0; // received upon the batched requests
+			uint32_t m_nSketches = 0; // reconciled with the node
+			bool m_bSketchRequested = false;
+			std::vector<BbsMsgID> m_vKeys;
+
+			virtual void OnConnectedSecure() override {
+				proto::Config msgCfg;
+				msgCfg.m_CfgChecksum = Rules::get().Checksum;
+				msgCfg.m_Bbs = true; // pretend to be a bbs node
+				msgCfg.m_Reconciliation = true;
+				Send(msgCfg);
+			}
+
+			void get_Sketch(Iblt& t, uint32_t nCellsPerHash) {
+				t.Reset(nCellsPerHash);
+				for (size_t i = 0; i < m_vKeys.size(); i++)
+					t.Add(m_vKeys[i]);
+			}
+
+			virtual void OnMsg(proto::GetReconcileSketch&& msg) override {
+				verify_test(proto::Reconciliation::SetType::Bbs == msg.m_SetType);
+				verify_test(msg.m_CellsPerHash);
+
+				Iblt t;
+				get_Sketch(t, msg.m_CellsPerHash);
+
+				proto::ReconcileSketch msgOut;
+				msgOut.m_SetType = msg.m_SetType;
+				msgOut.m_SetSize = (uint32_t) m_vKeys.size();
+				msgOut.m_Cells.swap(t.m_vCells);
+				Send(msgOut);
+			}
+
+			virtual void OnMsg(proto::ReconcileSketch&& msg) override {
+				Iblt t, tMy;
+				t.m_vCells.swap(msg.m_Cells);
+				verify_test(t.IsValid());
+
+				get_Sketch(tMy, (uint32_t) t.m_vCells.size() / Iblt::s_Hashes);
+				t.Subtract(tMy);
+
+				std::vector<Iblt::Key> vNode, vMy;
+				verify_test(t.Decode(vNode, vMy));
+				verify_test(vMy.empty()); // we only have what the node announced
+				m_nSketches++;
+			}
+
+			virtual void OnDisconnect(const DisconnectReason&) override {
+				fail_test("OnDisconnect");
+			}
+
+			virtual void OnMsg(proto::BbsHaveMsgs&& msg) override {
+				verify_test(!msg.m_Keys.empty() && (msg.m_Keys.size() <= proto::Inventory::s_EntriesMax));
+				m_nKeys += (uint32_t) msg.m_Keys.size();
+
+				m_vKeys.insert(m_vKeys.end(), msg.m_Keys.begin(), msg.m_Keys.end());
+
+				proto::BbsGetMsgs msgOut;
+				msgOut.m_Keys.swap(msg.m_Keys);
+				Send(msgOut);
+
+				if (m_bSketchRequested)
+					return; // the node serves only the growing sketches
+				m_bSketchRequested = true;
+
+				proto::GetReconcileSketch msgSketch;
+				msgSketch.m_SetType = proto::Reconciliation::SetType::Bbs;
+				msgSketch.m_CellsPerHash = proto::Reconciliation::s_CellsPerHashMin;
+				Send(msgSketch);
+			}
+
+			virtual void OnMsg(proto::BbsMsg&& msg) override {
+				m_nMsgs++;
+			}
+		};
+
+		MyClient3 cl3;
+		cl3.Connect(addr);
+
+		struct MyClient4
+			:public proto::NodeConnection
+		{
+			uint32_t m_nMsgs = 0; // received upon the announcements
+
+			virtual void OnConnectedSecure() override {
+				proto::Config msgCfg;
+				msgCfg.m_CfgChecksum = Rules::get().Checksum;
+				msgCfg.m_Bbs = true; // a bbs node without reconciliation, relies on the announcements only
+				Send(msgCfg);
+			}
+
+			virtual void OnDisconnect(const DisconnectReason&) override {
+				fail_test("OnDisconnect");
+			}
+
+			virtual void OnMsg(proto::BbsHaveMsgs&& msg) override {
+				proto::BbsGetMsgs msgOut;
+				msgOut.m_Keys.swap(msg.m_Keys);
+				Send(msgOut);
+			}
+
+			virtual void OnMsg(proto::BbsMsg&& msg) override {
+				m_nMsgs++;
+			}
+		};
+
+		MyClient4 cl4;
+		cl4.Connect(addr);
+
+		struct MyClient5
+			:public proto::NodeConnection
+		{
+			bool m_bDisconnected = false;
+
+			virtual void OnConnectedSecure() override {
+				proto::Config msgCfg;
+				msgCfg.m_CfgChecksum = Rules::get().Checksum;
+				msgCfg.m_Reconciliation = true;
+				Send(msgCfg);
+
+				// the same sketch again, the node should drop us
+				proto::GetReconcileSketch msgSketch;
+				msgSketch.m_SetType = proto::Reconciliation::SetType::Transactions;
+				msgSketch.m_CellsPerHash = proto::Reconciliation::s_CellsPerHashMin;
+				Send(msgSketch);
+				Send(msgSketch);
+			}
+
+			virtual void OnDisconnect(const DisconnectReason&) override {
+				m_bDisconnected = true;
+			}
+		};
+
+		MyClient5 cl5;
+		cl5.Connect(addr);
+
+		struct MyClient6
+			:public proto::NodeConnection
+		{
+			bool m_bWholeSetRequested = false;
+
+			virtual void OnConnectedSecure() override {
+				proto::Config msgCfg;
+				msgCfg.m_CfgChecksum = Rules::get().Checksum;
+				msgCfg.m_Bbs = true;
+				msgCfg.m_Reconciliation = true;
+				Send(msgCfg);
+			}
+
+			virtual void OnMsg(proto::GetReconcileSketch&& msg) override {
+				if (!msg.m_CellsPerHash)
+				{
+					m_bWholeSetRequested = true;
+					return;
+				}
+
+				verify_test(!m_bWholeSetRequested);
+
+				// absurd set size, no sketch can cover such a difference
+				Iblt t;
+				t.Reset(msg.m_CellsPerHash);
+
+				proto::ReconcileSketch msgOut;
+				msgOut.m_SetType = msg.m_SetType;
+				msgOut.m_SetSize = static_cast<uint32_t>(-1);
+				msgOut.m_Cells.swap(t.m_vCells);
+				Send(msgOut);
+			}
+
+			virtual void OnDisconnect(const DisconnectReason&) override {
+				fail_test("OnDisconnect");
+			}
+		};
+
+		MyClient6 cl6;
+		cl6.Connect(addr);
+
 
 		Node node2;
 		node2.m_Cfg.m_sPathLocal = g_sz2;
@@ -1267,6 +1640,18 @@ namespace beam
 			fail_test("some proofs missing");
 		if (!cl.IsAllBbsReceived())
 			fail_test("some BBS messages missing");
+		if (!cl3.m_nMsgs || (cl3.m_nMsgs > cl3.m_nKeys))
+			fail_test("batched BBS announcements/requests");
+		if (!cl3.m_nSketches)
+			fail_test("BBS reconciliation");
+		// the messages are posted one per block, the announcements are flushed by the timer wheel,
+		// which gets empty in between. Only the last ones may be still pending
+		if ((cl.m_nBbsMsgsSent < 10) || (cl4.m_nMsgs + 2 < cl.m_nBbsMsgsSent))
+			fail_test("BBS announcements to the peer without reconciliation");
+		if (!cl5.m_bDisconnected)
+			fail_test("repeated reconciliation sketch request");
+		if (!cl6.m_bWholeSetRequested)
+			fail_test("reconciliation with a huge set size");
 	}
 
 
@@ -1372,6 +1757,118 @@ namespace beam
 	};
 
 
+	void TestMetricsEndpoint()
+	{
+		io::Reactor::Ptr pReactor(io::Reactor::create());
+		io::Reactor::Scope scope(*pReactor);
+
+		Node node;
+		node.m_Cfg.m_sPathLocal = g_sz;
+		node.m_Cfg.m_MetricsListen.resolve("127.0.0.1");
+		node.m_Cfg.m_MetricsListen.port(g_Port + 2);
+		node.m_Cfg.m_Timeout.m_MetricsRequest_ms = 200;
+
+		ECC::SetRandom(node.m_Cfg.m_WalletKey.V);
+		node.Initialize();
+
+		// the 1st client requests the metrics, the 2nd one stays silent and should be dropped on timeout
+		struct MyClient
+		{
+			io::TcpStream::Ptr m_pStream;
+			std::string m_sResponse;
+			bool m_bClosed = false;
+		} pCl[2];
+
+		uint32_t nClosed = 0;
+		uint32_t t0_ms = GetTime_ms();
+
+		for (uint64_t i = 0; i < _countof(pCl); i++)
+		{
+			MyClient& cl = pCl[i];
+
+			pReactor->tcp_connect(node.m_Cfg.m_MetricsListen, i, [&cl, &nClosed, i](uint64_t, io::TcpStream::Ptr&& newStream, io::ErrorCode status)
+			{
+				verify_test(newStream && (io::EC_OK == status));
+				if (!newStream)
+				{
+					io::Reactor::get_Current().stop();
+					return;
+				}
+
+				cl.m_pStream = std::move(newStream);
+				cl.m_pStream->enable_read([&cl, &nClosed](io::ErrorCode errorCode, void* p, size_t n)
+				{
+					if (io::EC_OK == errorCode)
+					{
+						cl.m_sResponse.append((const char*) p, n);
+						return;
+					}
+
+					if (!cl.m_bClosed)
+					{
+						cl.m_bClosed = true;
+						if (2 == ++nClosed)
+							io::Reactor::get_Current().stop();
+					}
+				});
+
+				if (!i)
+				{
+					static const char szRequest[] = "GET /json HTTP/1.0\r\n\r\n";
+					cl.m_pStream->write(szRequest, sizeof(szRequest) - 1);
+				}
+			});
+		}
+
+		io::Timer::Ptr pTimer = io::Timer::create(pReactor);
+		pTimer->start(10000, false, []() { io::Reactor::get_Current().stop(); });
+
+		pReactor->run();
+
+		verify_test(pCl[0].m_bClosed);
+		verify_test(pCl[0].m_sResponse.find("200 OK") != std::string::npos);
+		verify_test(pCl[0].m_sResponse.find("node.height") != std::string::npos);
+
+		verify_test(pCl[1].m_bClosed);
+		verify_test(pCl[1].m_sResponse.empty());
+		verify_test(GetTime_ms() - t0_ms < 5000);
+	}
+
+	void TestBlockStats()
+	{
+		const uint32_t nWindowMax = 8;
+
+		Node::BlockStats bs;
+		bs.Reset();
+		verify_test(1 == bs.m_Window);
+
+		// a slow delivery of the first block can't shrink it further
+		bs.OnDelivered(500, 100, nWindowMax);
+		verify_test(2 == bs.m_Window);
+		verify_test(500 == bs.m_Avg_ms);
+
+		// grows with each block delivered in time, up to the max
+		for (uint32_t i = 0; i < 40; i++)
+			bs.OnDelivered(10, 100, nWindowMax);
+		verify_test(nWindowMax == bs.m_Window);
+		verify_test(bs.m_Avg_ms < 20);
+		verify_test(41 == bs.m_Blocks);
+		verify_test(4100 == bs.m_Bytes);
+
+		// a block that takes much longer than the average halves it
+		bs.OnDelivered(bs.m_Avg_ms * Node::BlockStats::s_SlowFactor * 2, 100, nWindowMax);
+		verify_test(nWindowMax / 2 == bs.m_Window);
+
+		// and the later one within the normal range doesn't
+		bs.OnDelivered(bs.m_Avg_ms, 100, nWindowMax);
+		verify_test(nWindowMax / 2 + 1 == bs.m_Window);
+
+		// a peer that keeps slowing down ends up with a single request at a time
+		for (uint32_t i = 0; i < 10; i++)
+			bs.OnDelivered(bs.m_Avg_ms * Node::BlockStats::s_SlowFactor * 2, 100, nWindowMax);
+		verify_test(1 == bs.m_Window);
+	}
+
 	void TestChainworkProof()
 	{
 		ChainContext cc;
@@ -1407,8 +1904,15 @@ namespace beam
 
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+	bool bBenchmark = beam::helpers::IsBenchmarkRequested(argc, argv);
+
+#ifndef WIN32
+	// as in the node app: a peer dropped mid-write must not kill the process
+	signal(SIGPIPE, SIG_IGN);
+#endif // WIN32
+
 	//auto logger = beam::Logger::create(LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG);
 
 	beam::Rules::get().AllowPublicUtxos = true;
@@ -1416,6 +1920,7 @@ int main()
 	beam::Rules::get().UpdateChecksum();
 
 	beam::TestChainworkProof();
+	beam::TestBlockStats();
 
 	// Make sure this test doesn't run in parallel. We have the following potential collisions for Nodes:
 	//	.db files
@@ -1431,6 +1936,11 @@ int main()
 	beam::TestNodeDB();
 	DeleteFileA(beam::g_sz);
 
+	printf("BbsStore test...\n");
+	fflush(stdout);
+
+	beam::TestBbsStore();
+
 	{
 		printf("NodeProcessor test1...\n");
 		fflush(stdout);
@@ -1441,6 +1951,16 @@ int main()
 		DeleteFileA(beam::g_sz);
 		DeleteFileA(beam::g_sz2);
 
+		if (bBenchmark)
+		{
+			printf("Macroblock import benchmark...\n");
+			fflush(stdout);
+
+			beam::BenchmarkMacroblockImport(blockChain);
+			DeleteFileA(beam::g_sz);
+			DeleteFileA(beam::g_sz2);
+		}
+
 		printf("NodeProcessor test2...\n");
 		fflush(stdout);
 
@@ -1462,5 +1982,11 @@ int main()
 	DeleteFileA(beam::g_sz);
 	DeleteFileA(beam::g_sz2);
 
+	printf("Metrics endpoint test...\n");
+	fflush(stdout);
+
+	beam::TestMetricsEndpoint();
+	DeleteFileA(beam::g_sz);
+
 	return g_TestsFailed ? -1 : 0;
 }
@@ -77,12 +77,12 @@ namespace beam
 
 #define CMP_MEMBER_PTR(member) CMP_PTRS(member, v.member)
 
-	template <typename T>
-	void ClonePtr(std::unique_ptr<T>& trg, const std::unique_ptr<T>& src)
+	template <typename T, typename D>
+	void ClonePtr(std::unique_ptr<T, D>& trg, const std::unique_ptr<T, D>& src)
 	{
 		if (src)
 		{
-			trg.reset(new T);
+			trg = std::unique_ptr<T, D>(new T); // with a fresh deleter, the target might have been arena-backed
 			*trg = *src;
 		}
 		else
@@ -553,6 +553,98 @@ namespace beam
 		PushVectorPtr(m_Txv.m_vKernelsOutput, v);
 	}
 
+	/////////////
+	// TxVectorsFlat
+	void* TxVectorsFlat::Arena::Allocate(size_t n)
+	{
+		const size_t nAlign = sizeof(uint64_t) * 2;
+		n = (n + nAlign - 1) & ~(nAlign - 1);
+
+		if (n > m_nRemaining)
+		{
+			size_t nPage = std::max(n, s_PageSize);
+			m_vPages.emplace_back(new uint8_t[nPage]);
+
+			m_pPos = m_vPages.back().get();
+			m_nRemaining = nPage;
+		}
+
+		void* pRet = m_pPos;
+		m_pPos += n;
+		m_nRemaining -= n;
+
+		return pRet;
+	}
+
+	void TxVectorsFlat::Arena::Clear()
+	{
+		m_vPages.clear();
+		m_pPos = NULL;
+		m_nRemaining = 0;
+	}
+
+	void TxVectorsFlat::Clear()
+	{
+		// All the objects reside in the arena, only the destructors should be called.
+		// Inputs are trivially destructible, the proofs of the outputs are arena-backed (their deleter doesn't free them), kernels may own nested objects on the heap.
+		m_vInputs.clear();
+
+		for (size_t i = 0; i < m_vOutputs.size(); i++)
+			m_vOutputs[i]->~Output();
+		m_vOutputs.clear();
+
+		for (size_t i = 0; i < m_vKernelsInput.size(); i++)
+			m_vKernelsInput[i]->~TxKernel();
+		m_vKernelsInput.clear();
+
+		for (size_t i = 0; i < m_vKernelsOutput.size(); i++)
+			m_vKernelsOutput[i]->~TxKernel();
+		m_vKernelsOutput.clear();
+
+		m_Arena.Clear();
+	}
+
+	template <typename T>
+	const T* get_FromVector(const std::vector<T*>& v, size_t idx)
+	{
+		return (idx >= v.size()) ? NULL : v[idx];
+	}
+
+	void TxVectorsFlat::Reader::Clone(Ptr& pOut)
+	{
+		pOut.reset(new Reader(m_Txv));
+	}
+
+	void TxVectorsFlat::Reader::Reset()
+	{
+		ZeroObject(m_pIdx);
+
+		m_pUtxoIn = get_FromVector(m_Txv.m_vInputs, 0);
+		m_pUtxoOut = get_FromVector(m_Txv.m_vOutputs, 0);
+		m_pKernelIn = get_FromVector(m_Txv.m_vKernelsInput, 0);
+		m_pKernelOut = get_FromVector(m_Txv.m_vKernelsOutput, 0);
+	}
+
+	void TxVectorsFlat::Reader::NextUtxoIn()
+	{
+		m_pUtxoIn = get_FromVector(m_Txv.m_vInputs, ++m_pIdx[0]);
+	}
+
+	void TxVectorsFlat::Reader::NextUtxoOut()
+	{
+		m_pUtxoOut = get_FromVector(m_Txv.m_vOutputs, ++m_pIdx[1]);
+	}
+
+	void TxVectorsFlat::Reader::NextKernelIn()
+	{
+		m_pKernelIn = get_FromVector(m_Txv.m_vKernelsInput, ++m_pIdx[2]);
+	}
+
+	void TxVectorsFlat::Reader::NextKernelOut()
+	{
+		m_pKernelOut = get_FromVector(m_Txv.m_vKernelsOutput, ++m_pIdx[3]);
+	}
+
 	/////////////
 	// AmoutBig
 	void AmountBig::operator += (Amount x)
@@ -190,6 +190,24 @@ namespace beam
 
 	inline bool operator < (const Input::Ptr& a, const Input::Ptr& b) { return *a < *b; }
 
+	// Deleter of the objects that may be allocated from an arena (see TxVectorsFlat). Those are only destroyed, the memory is freed with the arena
+	template <typename T>
+	struct ArenaDelete
+	{
+		bool m_bArena = false;
+
+		void operator () (T* p) const
+		{
+			if (m_bArena)
+				p->~T();
+			else
+				delete p;
+		}
+	};
+
+	template <typename T>
+	using ArenaPtr = std::unique_ptr<T, ArenaDelete<T> >;
+
 	struct Output
 		:public CommitmentAndMaturity
 	{
@@ -207,8 +225,8 @@ namespace beam
 		static const Amount s_MinimumValue = 1;
 
 		// one of the following *must* be specified
-		std::unique_ptr<ECC::RangeProof::Confidential>	m_pConfidential;
-		std::unique_ptr<ECC::RangeProof::Public>		m_pPublic;
+		ArenaPtr<ECC::RangeProof::Confidential>	m_pConfidential;
+		ArenaPtr<ECC::RangeProof::Public>		m_pPublic;
 
 		void Create(const ECC::Scalar::Native&, Amount, bool bPublic = false);
 		bool IsValid(ECC::Point::Native& comm) const;
@@ -352,6 +370,70 @@ namespace beam
 		};
 	};
 
+	// Read-only alternative to TxVectors, suitable for deserialized blocks.
+	// All the elements (including range proofs of the outputs) are allocated contiguously from the arena, and freed at once.
+	class TxVectorsFlat
+	{
+	public:
+
+		class Arena
+		{
+			std::vector<std::unique_ptr<uint8_t[]> > m_vPages;
+			uint8_t* m_pPos;
+			size_t m_nRemaining;
+
+		public:
+			static const size_t s_PageSize = 0x40000;
+
+			Arena() :m_pPos(NULL), m_nRemaining(0) {}
+
+			void* Allocate(size_t);
+			void Clear();
+
+			template <typename T>
+			T* Create() { return new (Allocate(sizeof(T))) T; }
+
+			template <typename T>
+			void Create(ArenaPtr<T>& p)
+			{
+				p.reset(Create<T>());
+				p.get_deleter().m_bArena = true;
+			}
+		};
+
+		std::vector<Input*> m_vInputs;
+		std::vector<Output*> m_vOutputs;
+		std::vector<TxKernel*> m_vKernelsInput;
+		std::vector<TxKernel*> m_vKernelsOutput;
+		Arena m_Arena;
+
+		TxVectorsFlat() {}
+		~TxVectorsFlat() { Clear(); }
+
+		TxVectorsFlat(const TxVectorsFlat&) = delete;
+		void operator = (const TxVectorsFlat&) = delete;
+
+		void Clear();
+
+		class Reader :public TxBase::IReader {
+			size_t m_pIdx[4];
+		public:
+			const TxVectorsFlat& m_Txv;
+			Reader(const TxVectorsFlat& txv) :m_Txv(txv) {}
+			// IReader
+			virtual void Clone(Ptr&) override;
+			virtual void Reset() override;
+			virtual void NextUtxoIn() override;
+			virtual void NextUtxoOut() override;
+			virtual void NextKernelIn() override;
+			virtual void NextKernelOut() override;
+		};
+
+		Reader get_Reader() const {
+			return Reader(*this);
+		}
+	};
+
 	struct Transaction
 		:public TxBase
 		,public TxVectors
@@ -512,6 +594,17 @@ namespace beam
 			}
 		};
 
+		// same as Body, but arena-backed. Has the same serialization format
+		struct BodyFlat
+			:public BodyBase
+			,public TxVectorsFlat
+		{
+			bool IsValid(const HeightRange& hr, bool bSubsidyOpen) const
+			{
+				return BodyBase::IsValid(hr, bSubsidyOpen, get_Reader());
+			}
+		};
+
 		struct ChainWorkProof;
 	};
 
@@ -593,9 +686,17 @@ namespace beam
 
 		static const int s_Datas = 5;
 
+		// On-disk format version. Each stream starts with the signature, files of other versions are rejected on open.
+		// Elements (which are sorted) are prefix-compressed: the X coordinate of their leading point is stored as the number of bytes shared with the previous element, followed by the remaining bytes.
+		static const uint8_t s_Version = 1;
+
 	private:
 
 		std::FStream m_pS[s_Datas];
+		ECC::uintBig m_pLastX[s_Datas - 1]; // per element stream
+
+		struct PackedIn;
+		struct PackedOut;
 
 		Input::Ptr m_pGuardUtxoIn[2];
 		Output::Ptr m_pGuardUtxoOut[2];
@@ -603,10 +704,16 @@ namespace beam
 		TxKernel::Ptr m_pGuardKernelOut[2];
 
 		template <typename T>
-		static void LoadInternal(const T*& pPtr, std::FStream&, typename T::Ptr* ppGuard);
+		void LoadInternal(const T*& pPtr, int iData, typename T::Ptr* ppGuard);
+
+		template <typename T>
+		void WriteElement(const T&, int iData);
 
 		template <typename T>
 		static void WriteInternal(const T&, std::FStream&);
+
+		static void get_Signature(uint8_t*);
+		void ResetStream(int iData);
 
 	public:
 
@@ -32,6 +32,17 @@ namespace beam
 		static_assert(5 == s_Datas, "");
 	}
 
+	static const uint32_t s_SignatureSize = 4;
+
+	void Block::BodyBase::RW::get_Signature(uint8_t* p)
+	{
+		p[0] = 'B';
+		p[1] = 'R';
+		p[2] = 'W';
+		p[3] = s_Version;
+		static_assert(4 == s_SignatureSize, "");
+	}
+
 	bool Block::BodyBase::RW::Open(bool bRead)
 	{
 		using namespace std;
@@ -41,13 +52,45 @@ namespace beam
 		std::string pArr[s_Datas];
 		GetPathes(pArr);
 
+		uint8_t pSig[s_SignatureSize], pSigActual[s_SignatureSize];
+		get_Signature(pSig);
+
 		for (size_t i = 0; i < _countof(m_pS); i++)
-			if (!m_pS[i].Open(pArr[i].c_str(), bRead))
+		{
+			std::FStream& s = m_pS[i];
+			if (!s.Open(pArr[i].c_str(), bRead))
 				return false;
 
+			if (bRead)
+			{
+				if (s.get_Remaining() < s_SignatureSize)
+					return false;
+
+				s.read(pSigActual, s_SignatureSize);
+				if (memcmp(pSig, pSigActual, s_SignatureSize))
+					return false; // different format version
+			}
+			else
+				s.write(pSig, s_SignatureSize);
+		}
+
+		ZeroObject(m_pLastX);
+
 		return true;
 	}
 
+	void Block::BodyBase::RW::ResetStream(int iData)
+	{
+		std::FStream& s = m_pS[iData];
+		s.Restart();
+
+		uint8_t pSig[s_SignatureSize];
+		s.read(pSig, s_SignatureSize); // skip, it was verified on open
+
+		if (iData < s_Datas - 1) // all except headers
+			m_pLastX[iData] = Zero;
+	}
+
 	void Block::BodyBase::RW::Delete()
 	{
 		std::string pArr[s_Datas];
@@ -81,14 +124,14 @@ namespace beam
 
 	void Block::BodyBase::RW::Reset()
 	{
-		for (size_t i = 0; i < _countof(m_pS); i++)
-			m_pS[i].Restart();
+		for (int i = 0; i < s_Datas; i++)
+			ResetStream(i);
 
 		// preload
-		LoadInternal(m_pUtxoIn, m_pS[0], m_pGuardUtxoIn);
-		LoadInternal(m_pUtxoOut, m_pS[1], m_pGuardUtxoOut);
-		LoadInternal(m_pKernelIn, m_pS[2], m_pGuardKernelIn);
-		LoadInternal(m_pKernelOut, m_pS[3], m_pGuardKernelOut);
+		LoadInternal(m_pUtxoIn, 0, m_pGuardUtxoIn);
+		LoadInternal(m_pUtxoOut, 1, m_pGuardUtxoOut);
+		LoadInternal(m_pKernelIn, 2, m_pGuardKernelIn);
+		LoadInternal(m_pKernelOut, 3, m_pGuardKernelOut);
 	}
 
 	void Block::BodyBase::RW::Flush()
@@ -108,22 +151,22 @@ namespace beam
 
 	void Block::BodyBase::RW::NextUtxoIn()
 	{
-		LoadInternal(m_pUtxoIn, m_pS[0], m_pGuardUtxoIn);
+		LoadInternal(m_pUtxoIn, 0, m_pGuardUtxoIn);
 	}
 
 	void Block::BodyBase::RW::NextUtxoOut()
 	{
-		LoadInternal(m_pUtxoOut, m_pS[1], m_pGuardUtxoOut);
+		LoadInternal(m_pUtxoOut, 1, m_pGuardUtxoOut);
 	}
 
 	void Block::BodyBase::RW::NextKernelIn()
 	{
-		LoadInternal(m_pKernelIn, m_pS[2], m_pGuardKernelIn);
+		LoadInternal(m_pKernelIn, 2, m_pGuardKernelIn);
 	}
 
 	void Block::BodyBase::RW::NextKernelOut()
 	{
-		LoadInternal(m_pKernelOut, m_pS[3], m_pGuardKernelOut);
+		LoadInternal(m_pKernelOut, 3, m_pGuardKernelOut);
 	}
 
 	void Block::BodyBase::RW::get_Start(BodyBase& body, SystemState::Sequence::Prefix& prefix)
@@ -154,22 +197,22 @@ namespace beam
 
 	void Block::BodyBase::RW::WriteIn(const Input& v)
 	{
-		WriteInternal(v, m_pS[0]);
+		WriteElement(v, 0);
 	}
 
 	void Block::BodyBase::RW::WriteIn(const TxKernel& v)
 	{
-		WriteInternal(v, m_pS[2]);
+		WriteElement(v, 2);
 	}
 
 	void Block::BodyBase::RW::WriteOut(const Output& v)
 	{
-		WriteInternal(v, m_pS[1]);
+		WriteElement(v, 1);
 	}
 
 	void Block::BodyBase::RW::WriteOut(const TxKernel& v)
 	{
-		WriteInternal(v, m_pS[3]);
+		WriteElement(v, 3);
 	}
 
 	void Block::BodyBase::RW::put_Start(const BodyBase& body, const SystemState::Sequence::Prefix& prefix)
@@ -184,16 +227,122 @@ namespace beam
 		WriteInternal(elem, m_pS[4]);
 	}
 
+	// All the elements (Input, Output, TxKernel) are serialized as [flags][X of the point they're sorted by][...].
+	// The following streams substitute this X by [shared prefix len][the remaining bytes] on the fly.
+	struct Block::BodyBase::RW::PackedIn
+	{
+		std::FStream& m_S;
+		uint8_t m_pHdr[1 + ECC::uintBig::nBytes];
+		uint32_t m_nHdr;
+
+		PackedIn(std::FStream& s, ECC::uintBig& xLast)
+			:m_S(s)
+			,m_nHdr(0)
+		{
+			uint8_t nPrefix;
+			m_S.read(m_pHdr, 1);
+			m_S.read(&nPrefix, 1);
+
+			if (nPrefix > ECC::uintBig::nBytes)
+				throw std::runtime_error("corrupted");
+
+			uint8_t* pX = m_pHdr + 1;
+			memcpy(pX, xLast.m_pData, nPrefix);
+			m_S.read(pX + nPrefix, ECC::uintBig::nBytes - nPrefix);
+			memcpy(xLast.m_pData, pX, ECC::uintBig::nBytes);
+		}
+
+		size_t read(void* pPtr, size_t nSize)
+		{
+			size_t nPortion = std::min(nSize, sizeof(m_pHdr) - m_nHdr);
+			if (nPortion)
+			{
+				memcpy(pPtr, m_pHdr + m_nHdr, nPortion);
+				m_nHdr += static_cast<uint32_t>(nPortion);
+			}
+
+			if (nSize > nPortion)
+				m_S.read(((uint8_t*) pPtr) + nPortion, nSize - nPortion);
+
+			return nSize;
+		}
+
+		char getch()
+		{
+			char ch;
+			read(&ch, 1);
+			return ch;
+		}
+
+		char peekch() const { return m_S.peekch(); } // not impl
+		void ungetch(char ch) { m_S.ungetch(ch); } // not impl
+	};
+
+	struct Block::BodyBase::RW::PackedOut
+	{
+		std::FStream& m_S;
+		ECC::uintBig& m_xLast;
+		uint8_t m_pHdr[1 + ECC::uintBig::nBytes];
+		uint32_t m_nHdr;
+
+		PackedOut(std::FStream& s, ECC::uintBig& xLast)
+			:m_S(s)
+			,m_xLast(xLast)
+			,m_nHdr(0)
+		{
+		}
+
+		~PackedOut()
+		{
+			assert(sizeof(m_pHdr) == m_nHdr); // all the elements are longer
+		}
+
+		size_t write(const void* pPtr, size_t nSize)
+		{
+			size_t nPortion = std::min(nSize, sizeof(m_pHdr) - m_nHdr);
+			if (nPortion)
+			{
+				memcpy(m_pHdr + m_nHdr, pPtr, nPortion);
+				m_nHdr += static_cast<uint32_t>(nPortion);
+
+				if (sizeof(m_pHdr) == m_nHdr)
+					FlushHdr();
+			}
+
+			if (nSize > nPortion)
+				m_S.write(((const uint8_t*) pPtr) + nPortion, nSize - nPortion);
+
+			return nSize;
+		}
+
+		void FlushHdr()
+		{
+			const uint8_t* pX = m_pHdr + 1;
+
+			uint8_t nPrefix = 0;
+			while ((nPrefix < ECC::uintBig::nBytes) && (pX[nPrefix] == m_xLast.m_pData[nPrefix]))
+				nPrefix++;
+
+			m_S.write(m_pHdr, 1);
+			m_S.write(&nPrefix, 1);
+			m_S.write(pX + nPrefix, ECC::uintBig::nBytes - nPrefix);
+
+			memcpy(m_xLast.m_pData, pX, ECC::uintBig::nBytes);
+		}
+	};
+
 	template <typename T>
-	void Block::BodyBase::RW::LoadInternal(const T*& pPtr, std::FStream& s, typename T::Ptr* ppGuard)
+	void Block::BodyBase::RW::LoadInternal(const T*& pPtr, int iData, typename T::Ptr* ppGuard)
 	{
+		std::FStream& s = m_pS[iData];
 		if (s.IsDataRemaining())
 		{
 			ppGuard[0].swap(ppGuard[1]);
 			//if (!ppGuard[0])
 				ppGuard[0].reset(new T);
 
-			yas::binary_iarchive<std::FStream, SERIALIZE_OPTIONS> arc(s);
+			PackedIn ps(s, m_pLastX[iData]);
+			yas::binary_iarchive<PackedIn, SERIALIZE_OPTIONS> arc(ps);
 			arc & *ppGuard[0];
 
 			pPtr = ppGuard[0].get();
@@ -202,6 +351,14 @@ namespace beam
 			pPtr = NULL;
 	}
 
+	template <typename T>
+	void Block::BodyBase::RW::WriteElement(const T& v, int iData)
+	{
+		PackedOut ps(m_pS[iData], m_pLastX[iData]);
+		yas::binary_oarchive<PackedOut, SERIALIZE_OPTIONS> arc(ps);
+		arc & v;
+	}
+
 	template <typename T>
 	void Block::BodyBase::RW::WriteInternal(const T& v, std::FStream& s)
 	{
@@ -54,6 +54,10 @@ namespace std
 		int mode = ios_base::binary;
 		mode |= (bRead ? (ios_base::in | ios_base::ate) : (ios_base::out | ios_base::trunc));
 
+		if (!m_pBuf)
+			m_pBuf.reset(new char[s_BufSize]);
+		m_F.rdbuf()->pubsetbuf(m_pBuf.get(), s_BufSize); // must be set before open
+
 		m_F.open(sz, (ios_base::openmode) mode);
 		if (m_F.fail())
 		{
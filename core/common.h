@@ -85,9 +85,12 @@ namespace std
 	// wrapper for std::fstream, with semantics suitable for serialization
 	class FStream
 	{
+		std::unique_ptr<char[]> m_pBuf; // larger than the default, to reduce the number of syscalls on streaming (de)serialization. Must outlive m_F
 		std::fstream m_F;
 		uint64_t m_Remaining; // used in read-stream, to indicate the EOF before trying to deserialize something
 
+		static const size_t s_BufSize = 0x10000;
+
 		static void NotImpl();
 
 	public:
@@ -95,6 +98,7 @@ namespace std
 		bool Open(const char*, bool bRead, bool bStrict = false); // strict - throw exc if error
 		void Close();
 		bool IsDataRemaining() const;
+		uint64_t get_Remaining() const { return m_Remaining; }
 		void Restart(); // for read-stream - jump to the beginning of the file
 
 		// read/write always return the size requested. Exception is thrown if underflow or error
@@ -0,0 +1,131 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "iblt.h"
+
+namespace beam
+{
+
+void Iblt::Reset(uint32_t nCellsPerHash)
+{
+	Cell c;
+	ZeroObject(c);
+	m_vCells.assign(nCellsPerHash * s_Hashes, c);
+}
+
+uint32_t Iblt::get_CheckSum(const Key& key)
+{
+	// must not be linear wrt xor, otherwise the sum of several elements would look pure
+	uint64_t a, b;
+	static_assert(sizeof(key.m_pData) >= sizeof(uint32_t) * s_Hashes + sizeof(a) + sizeof(b), "");
+
+	memcpy(&a, key.m_pData + key.nBytes - sizeof(a) - sizeof(b), sizeof(a));
+	memcpy(&b, key.m_pData + key.nBytes - sizeof(b), sizeof(b));
+
+	a ^= b * 0x9e3779b97f4a7c15ULL;
+	a ^= a >> 31;
+	a *= 0xbf58476d1ce4e5b9ULL;
+	a ^= a >> 29;
+
+	return static_cast<uint32_t>(a);
+}
+
+uint32_t Iblt::get_Pos(const Key& key, uint32_t iHash) const
+{
+	uint32_t n;
+	memcpy(&n, key.m_pData + sizeof(n) * iHash, sizeof(n));
+
+	uint32_t nCellsPerHash = static_cast<uint32_t>(m_vCells.size()) / s_Hashes;
+	return nCellsPerHash * iHash + n % nCellsPerHash;
+}
+
+void Iblt::Toggle(const Key& key, uint32_t nDelta)
+{
+	uint32_t nCheckSum = get_CheckSum(key);
+
+	for (uint32_t i = 0; i < s_Hashes; i++)
+	{
+		Cell& c = m_vCells[get_Pos(key, i)];
+		c.m_Count += nDelta;
+		c.m_KeySum ^= key;
+		c.m_CheckSum ^= nCheckSum;
+	}
+}
+
+void Iblt::Add(const Key& key)
+{
+	Toggle(key, 1);
+}
+
+void Iblt::Subtract(const Iblt& x)
+{
+	assert(m_vCells.size() == x.m_vCells.size());
+
+	for (size_t i = 0; i < m_vCells.size(); i++)
+	{
+		Cell& c = m_vCells[i];
+		const Cell& c2 = x.m_vCells[i];
+
+		c.m_Count -= c2.m_Count;
+		c.m_KeySum ^= c2.m_KeySum;
+		c.m_CheckSum ^= c2.m_CheckSum;
+	}
+}
+
+bool Iblt::IsPure(const Cell& c) const
+{
+	return
+		((1 == c.m_Count) || (static_cast<uint32_t>(-1) == c.m_Count)) &&
+		(get_CheckSum(c.m_KeySum) == c.m_CheckSum);
+}
+
+bool Iblt::Decode(std::vector<Key>& vPositive, std::vector<Key>& vNegative)
+{
+	std::vector<uint32_t> vPending;
+	vPending.reserve(m_vCells.size());
+	for (uint32_t i = 0; i < m_vCells.size(); i++)
+		vPending.push_back(i);
+
+	while (!vPending.empty())
+	{
+		const Cell& c = m_vCells[vPending.back()];
+		vPending.pop_back();
+
+		if (!IsPure(c))
+			continue;
+
+		if (vPositive.size() + vNegative.size() >= m_vCells.size())
+			return false; // can't be, probably a checksum collision
+
+		Key key = c.m_KeySum;
+		uint32_t nCount = c.m_Count;
+
+		((1 == nCount) ? vPositive : vNegative).push_back(key);
+		Toggle(key, 0 - nCount);
+
+		for (uint32_t i = 0; i < s_Hashes; i++)
+			vPending.push_back(get_Pos(key, i));
+	}
+
+	for (size_t i = 0; i < m_vCells.size(); i++)
+	{
+		const Cell& c = m_vCells[i];
+		if (c.m_Count || c.m_CheckSum || !(c.m_KeySum == Zero))
+			return false;
+	}
+
+	return true;
+}
+
+} // namespace beam
@@ -0,0 +1,67 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "ecc.h"
+
+namespace beam
+{
+
+// Invertible bloom lookup table of 256-bit hashes (transaction keys, bbs message IDs).
+// The difference of 2 tables can be decoded into the elements that are present in only one of the sets,
+// so that peers reconcile their sets with the bandwidth proportional to the difference, not to the sets.
+// The elements are assumed to be uniformly distributed (hashes), their slices are used as the cell indexes.
+struct Iblt
+{
+	typedef ECC::Hash::Value Key;
+
+	static const uint32_t s_Hashes = 3; // each element is in a single cell of each sub-table
+
+	struct Cell
+	{
+		uint32_t m_Count; // wraps around on subtraction
+		Key m_KeySum; // xor
+		uint32_t m_CheckSum; // xor
+
+		template <typename Archive>
+		void serialize(Archive& ar)
+		{
+			ar
+				& m_Count
+				& m_KeySum
+				& m_CheckSum;
+		}
+	};
+
+	std::vector<Cell> m_vCells; // s_Hashes sub-tables of the same size
+
+	void Reset(uint32_t nCellsPerHash);
+	bool IsValid() const { return !m_vCells.empty() && !(m_vCells.size() % s_Hashes); }
+
+	void Add(const Key&);
+	void Subtract(const Iblt&); // must be of the same size
+
+	// Peels the table, destroys it. Returns false if it can't be decoded completely (the difference is too big).
+	// Positive are the elements present in this table only, negative - in the subtracted one.
+	bool Decode(std::vector<Key>& vPositive, std::vector<Key>& vNegative);
+
+private:
+	static uint32_t get_CheckSum(const Key&);
+	uint32_t get_Pos(const Key&, uint32_t iHash) const;
+	void Toggle(const Key&, uint32_t nDelta);
+	bool IsPure(const Cell&) const;
+};
+
+} // namespace beam
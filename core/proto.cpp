@@ -18,6 +18,7 @@
 #include "proto.h"
 #include "../utility/logger.h"
 #include "../utility/logger_checkpoints.h"
+#include "../utility/metrics.h"
 
 namespace beam {
 namespace proto {
@@ -39,6 +40,10 @@ void ProtocolPlus::ResetVars()
 
 void ProtocolPlus::Decrypt(uint8_t* p, uint32_t nSize)
 {
+	// all the incoming data passes here, regardless to the mode
+	static metrics::Counter& s_BytesIn = metrics::Registry::get().counter("net.bytes_in");
+	s_BytesIn.add(nSize);
+
 	if (Mode::Duplex == m_Mode)
 		m_CipherIn.XCrypt(m_Enc, p, nSize);
 }
@@ -75,7 +80,7 @@ void ProtocolPlus::get_HMac(ECC::Hash::Mac& hm, MacValue& res)
 	res = hv;
 }
 
-void ProtocolPlus::Encrypt(SerializedMsg& sm, MsgSerializer& ser)
+void ProtocolPlus::Finalize(SerializedMsg& sm, MsgSerializer& ser)
 {
 	MacValue hmac;
 
@@ -116,7 +121,7 @@ void ProtocolPlus::Encrypt(SerializedMsg& sm, MsgSerializer& ser)
 
 		get_HMac(hm, hmac);
 
-		// 4. Overwrite the hmac, encrypt
+		// 4. Overwrite the hmac
 		n2 = n;
 
 		for (size_t i = 0; i < sm.size(); i++)
@@ -134,8 +139,18 @@ void ProtocolPlus::Encrypt(SerializedMsg& sm, MsgSerializer& ser)
 			}
 
 			n2 -= iov.size;
+		}
+	}
+}
 
-			m_CipherOut.XCrypt(m_Enc, dst, (uint32_t) iov.size);
+void ProtocolPlus::Encrypt(SerializedMsg& sm)
+{
+	if (Mode::Plaintext != m_Mode)
+	{
+		for (size_t i = 0; i < sm.size(); i++)
+		{
+			io::IOVec& iov = sm[i];
+			m_CipherOut.XCrypt(m_Enc, (uint8_t*) iov.data, (uint32_t) iov.size);
 		}
 	}
 }
@@ -153,9 +168,8 @@ void InitCipherIV(AES::StreamCipher& c, const ECC::Hash::Value& hvSecret, const
 	c.m_nBuf = 0;
 }
 
-bool InitViaDiffieHellman(const ECC::Scalar::Native& myPrivate, const PeerID& remotePublic, AES::Encoder& enc, ECC::Hash::Mac& hmac, AES::StreamCipher* pCipherOut, AES::StreamCipher* pCipherIn)
+bool GetDiffieHellmanSecret(ECC::NoLeak<ECC::Hash::Value>& hvSecret, const ECC::Scalar::Native& myPrivate, const PeerID& remotePublic)
 {
-	// Diffie-Hellman
 	ECC::Point pt;
 	pt.m_X = remotePublic;
 	pt.m_Y = false;
@@ -167,9 +181,17 @@ bool InitViaDiffieHellman(const ECC::Scalar::Native& myPrivate, const PeerID& re
 	ECC::Point::Native ptSecret = p * myPrivate;
 
 	ECC::NoLeak<ECC::Hash::Processor> hp;
-	ECC::NoLeak<ECC::Hash::Value> hvSecret;
 	hp.V << ptSecret >> hvSecret.V;
 
+	return true;
+}
+
+bool InitViaDiffieHellman(const ECC::Scalar::Native& myPrivate, const PeerID& remotePublic, AES::Encoder& enc, ECC::Hash::Mac& hmac, AES::StreamCipher* pCipherOut, AES::StreamCipher* pCipherIn)
+{
+	ECC::NoLeak<ECC::Hash::Value> hvSecret;
+	if (!GetDiffieHellmanSecret(hvSecret, myPrivate, remotePublic))
+		return false;
+
 	static_assert(AES::s_KeyBytes == ECC::Hash::Value::nBytes, "");
 	enc.Init(hvSecret.V.m_pData);
 
@@ -205,68 +227,122 @@ void Sk2Pk(PeerID& res, ECC::Scalar::Native& sk)
 	res = pt.m_X;
 }
 
-bool BbsEncrypt(ByteBuffer& res, const PeerID& publicAddr, ECC::Scalar::Native& nonce, const void* p, uint32_t n)
+// Bbs message layout: sender nonce public | tag | mac | ciphertext
+// The tag and the mac are checked before the payload is touched, so that the recipient can reject quickly (and without side effects) messages addressed to others.
+struct BbsHdr
 {
-	PeerID myPublic;
-	Sk2Pk(myPublic, nonce);
+	PeerID m_Public;
+	uint8_t m_pTag[BbsCipher::s_TagBytes];
+	ECC::Hash::Value m_Mac;
+};
 
-	AES::Encoder enc;
-	AES::StreamCipher cOut;
-	ECC::Hash::Mac hmac;
-	if (!InitViaDiffieHellman(nonce, publicAddr, enc, hmac, &cOut, NULL))
-		return false; // bad address
+static_assert(sizeof(BbsHdr) == PeerID::nBytes + BbsCipher::s_TagBytes + ECC::Hash::Value::nBytes, "");
+
+void BbsGetTag(uint8_t* pTag, const ECC::Hash::Value& hvSecret)
+{
+	ECC::NoLeak<ECC::Hash::Value> hv;
+	ECC::Hash::Processor() << "bbs.tag" << hvSecret >> hv.V;
+	memcpy(pTag, hv.V.m_pData, BbsCipher::s_TagBytes);
+}
 
+void BbsGetMac(ECC::Hash::Value& hvMac, const ECC::Hash::Value& hvSecret, const uint8_t* p, uint32_t n)
+{
+	ECC::Hash::Mac hmac;
+	hmac.Reset(hvSecret.m_pData, hvSecret.nBytes);
 	hmac.Write(p, n);
-	ECC::Hash::Value hvMac;
 	hmac >> hvMac;
+}
+
+void BbsXCrypt(const ECC::Hash::Value& hvSecret, const PeerID& senderPublic, uint8_t* p, uint32_t n)
+{
+	static_assert(AES::s_KeyBytes == ECC::Hash::Value::nBytes, "");
+
+	AES::Encoder enc;
+	enc.Init(hvSecret.m_pData);
+
+	AES::StreamCipher c;
+	InitCipherIV(c, hvSecret, senderPublic);
+	c.XCrypt(enc, p, n);
+}
+
+bool BbsEncrypt(ByteBuffer& res, const PeerID& publicAddr, ECC::Scalar::Native& nonce, const void* p, uint32_t n)
+{
+	BbsHdr hdr;
+	Sk2Pk(hdr.m_Public, nonce);
+
+	ECC::NoLeak<ECC::Hash::Value> hvSecret;
+	if (!GetDiffieHellmanSecret(hvSecret, nonce, publicAddr))
+		return false; // bad address
 
-	res.resize(myPublic.nBytes + hvMac.nBytes + n);
+	res.resize(sizeof(hdr) + n);
 	uint8_t* pDst = &res.at(0);
 
-	memcpy(pDst, myPublic.m_pData, myPublic.nBytes);
-	memcpy(pDst + myPublic.nBytes, hvMac.m_pData, hvMac.nBytes);
-	memcpy(pDst + myPublic.nBytes + hvMac.nBytes, p, n);
+	memcpy(pDst + sizeof(hdr), p, n);
+	BbsXCrypt(hvSecret.V, hdr.m_Public, pDst + sizeof(hdr), n);
 
-	cOut.XCrypt(enc, pDst + myPublic.nBytes, hvMac.nBytes + n);
+	BbsGetTag(hdr.m_pTag, hvSecret.V);
+	BbsGetMac(hdr.m_Mac, hvSecret.V, pDst + sizeof(hdr), n);
+
+	memcpy(pDst, &hdr, sizeof(hdr));
 
 	return true;
 }
 
-bool BbsDecrypt(uint8_t*& p, uint32_t& n, ECC::Scalar::Native& privateAddr)
+bool BbsCheck(ECC::NoLeak<ECC::Hash::Value>& hvSecret, const uint8_t* p, uint32_t n, const ECC::Scalar::Native& privateAddr)
 {
-	PeerID remotePublic;
-	ECC::Hash::Value hvMac, hvMac2;
-
-	if (n < remotePublic.nBytes + hvMac.nBytes)
+	BbsHdr hdr;
+	if (n < sizeof(hdr))
 		return false;
 
-	memcpy(remotePublic.m_pData, p, remotePublic.nBytes);
+	memcpy(&hdr, p, sizeof(hdr));
 
-	AES::Encoder enc;
-	AES::StreamCipher cIn;
-	ECC::Hash::Mac hmac;
-	if (!InitViaDiffieHellman(privateAddr, remotePublic, enc, hmac, NULL, &cIn))
+	if (!GetDiffieHellmanSecret(hvSecret, privateAddr, hdr.m_Public))
 		return false; // bad address
 
-	cIn.XCrypt(enc, p + remotePublic.nBytes, n - remotePublic.nBytes);
+	uint8_t pTag[BbsCipher::s_TagBytes];
+	BbsGetTag(pTag, hvSecret.V);
+	if (memcmp(pTag, hdr.m_pTag, sizeof(pTag)))
+		return false; // most likely not for us
 
-	memcpy(hvMac.m_pData, p + remotePublic.nBytes, hvMac.nBytes);
+	ECC::Hash::Value hvMac;
+	BbsGetMac(hvMac, hvSecret.V, p + sizeof(hdr), n - sizeof(hdr));
 
-	p += remotePublic.nBytes + hvMac.nBytes;
-	n -= (remotePublic.nBytes + hvMac.nBytes);
+	return (hvMac == hdr.m_Mac);
+}
 
-	hmac.Write(p, n);
-	hmac >> hvMac2;
+bool BbsCheck(const uint8_t* p, uint32_t n, const ECC::Scalar::Native& privateAddr)
+{
+	ECC::NoLeak<ECC::Hash::Value> hvSecret;
+	return BbsCheck(hvSecret, p, n, privateAddr);
+}
+
+bool BbsDecrypt(uint8_t*& p, uint32_t& n, const ECC::Scalar::Native& privateAddr)
+{
+	ECC::NoLeak<ECC::Hash::Value> hvSecret;
+	if (!BbsCheck(hvSecret, p, n, privateAddr))
+		return false;
+
+	PeerID senderPublic;
+	memcpy(senderPublic.m_pData, p, senderPublic.nBytes);
+
+	p += sizeof(BbsHdr);
+	n -= sizeof(BbsHdr);
 
-	return (hvMac == hvMac2);
+	BbsXCrypt(hvSecret.V, senderPublic, p, n);
+	return true;
 }
 
 /////////////////////////
 // NodeConnection
 NodeConnection::NodeConnection()
-	:m_Protocol(0xAA, 0xBB, 0xCC, 100, *this, 20000)
+	:m_Protocol(0xAA, 0xBB, Version::s_Value, 100, *this, 20000)
 	,m_ConnectPending(false)
+	,m_pThreads(NULL)
+	,m_iThread(0)
 {
+	m_SendQueue.m_Count = 0;
+	ZeroObject(m_SendStats);
+
 #define THE_MACRO(code, msg) \
 	m_Protocol.add_message_handler<NodeConnection, msg##_NoInit, &NodeConnection::OnMsgInternal>(uint8_t(code), this, 0, 2000000);
 
@@ -274,6 +350,129 @@ NodeConnection::NodeConnection()
 #undef THE_MACRO
 }
 
+/////////////////////////
+// NodeConnection::Link
+// Serves the connection in a network thread. SChannel is established and the peer ID is verified here,
+// the rest is handed-off to the owner
+class NodeConnection::Link
+	:public NodeConnection
+{
+public:
+	struct Owner
+	{
+		NodeConnection* m_p; // accessed in the owner thread only
+	};
+
+	std::shared_ptr<Owner> m_pOwner;
+	Threads& m_Threads;
+
+	Link(NodeConnection& owner, Threads& threads)
+		:m_pOwner(std::make_shared<Owner>())
+		,m_Threads(threads)
+	{
+		m_pOwner->m_p = &owner;
+	}
+
+	template <typename TFunc>
+	void PostToOwner(TFunc&& func)
+	{
+		std::shared_ptr<Owner> pOwner = m_pOwner;
+		m_Threads.PostHome([pOwner, f = std::forward<TFunc>(func)]() mutable {
+			NodeConnection* p = pOwner->m_p;
+			if (!p)
+				return; // reset already
+
+			try {
+				f(*p);
+			} catch (const std::exception& e) {
+				p->OnExc(e);
+			}
+		});
+	}
+
+	template <typename T>
+	bool HandleLocally(T&) { return false; }
+
+	bool HandleLocally(SChannelInitiate& msg)
+	{
+		NodeConnection::OnMsg(std::move(msg));
+		return true;
+	}
+
+	bool HandleLocally(SChannelReady& msg)
+	{
+		NodeConnection::OnMsg(std::move(msg));
+		PostToOwner([](NodeConnection& x) { x.m_Protocol.m_Mode = ProtocolPlus::Mode::Duplex; });
+		return true;
+	}
+
+	bool HandleLocally(Authentication& msg)
+	{
+		NodeConnection::OnMsg(Authentication(msg)); // throws if invalid
+		return false;
+	}
+
+#define THE_MACRO(code, msg) \
+	virtual bool OnMsg2(msg&& v) override \
+	{ \
+		if (!HandleLocally(v)) \
+			PostToOwner([m = std::move(v)](NodeConnection& x) mutable { x.OnMsg2(std::move(m)); }); \
+		return true; \
+	}
+	BeamNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
+
+	virtual void OnConnectedSecure() override
+	{
+		PostToOwner([](NodeConnection& x) {
+			x.m_Protocol.m_Mode = ProtocolPlus::Mode::Outgoing;
+			x.OnConnectedSecure();
+		});
+	}
+
+	virtual void OnDisconnect(const DisconnectReason& r) override
+	{
+		std::string sErr; // the error message doesn't outlive this call
+		if (DisconnectReason::ProcessingExc == r.m_Type)
+			sErr = r.m_szErrorMsg;
+
+		PostToOwner([r, sErr](NodeConnection& x) {
+			DisconnectReason r2 = r;
+			if (DisconnectReason::ProcessingExc == r2.m_Type)
+				r2.m_szErrorMsg = sErr.c_str();
+			x.OnDisconnect(r2);
+		});
+	}
+};
+
+bool NodeConnection::CreateLink(const io::TcpStream* pStream)
+{
+	if (!m_pThreads || !m_pThreads->m_pPool)
+		return false;
+
+	io::ReactorPool& pool = *m_pThreads->m_pPool;
+	m_iThread = pStream ? pool.find(pStream->reactor()) : pool.get_next();
+	if (m_iThread >= pool.size())
+		return false; // not attached to the network threads
+
+	m_pLink = std::make_shared<Link>(*this, *m_pThreads);
+	m_pLink->m_SendLimits = m_SendLimits;
+	return true;
+}
+
+template <typename TFunc>
+void NodeConnection::PostToLink(TFunc&& func)
+{
+	std::shared_ptr<Link> pLink = m_pLink;
+	m_pThreads->m_pPool->post(m_iThread, [pLink, f = std::forward<TFunc>(func)]() mutable {
+		try {
+			f(*pLink);
+		} catch (const std::exception& e) {
+			pLink->OnExc(e);
+		}
+	});
+}
+
 NodeConnection::~NodeConnection()
 {
 	Reset();
@@ -281,6 +480,13 @@ NodeConnection::~NodeConnection()
 
 void NodeConnection::Reset()
 {
+	if (m_pLink)
+	{
+		m_pLink->m_pOwner->m_p = NULL; // the pending notifications are discarded
+		PostToLink([](Link& x) { x.Reset(); });
+		m_pLink = NULL; // the last reference is released in the network thread
+	}
+
 	if (m_ConnectPending)
 	{
 		io::Reactor::get_Current().cancel_tcp_connect(uint64_t(this));
@@ -291,6 +497,7 @@ void NodeConnection::Reset()
 	m_pAsyncFail = NULL;
 
 	m_Protocol.ResetVars();
+	ResetSendQueue();
 }
 
 
@@ -404,7 +611,13 @@ void NodeConnection::ThrowUnexpected(const char* sz)
 
 void NodeConnection::Connect(const io::Address& addr)
 {
-	assert(!m_Connection && !m_ConnectPending);
+	assert(!m_Connection && !m_ConnectPending && !m_pLink);
+
+	if (CreateLink(NULL))
+	{
+		PostToLink([addr](Link& x) { x.Connect(addr); });
+		return;
+	}
 
 	io::Result res = io::Reactor::get_Current().tcp_connect(
 		addr,
@@ -417,7 +630,14 @@ void NodeConnection::Connect(const io::Address& addr)
 
 void NodeConnection::Accept(io::TcpStream::Ptr&& newStream)
 {
-	assert(!m_Connection && !m_ConnectPending);
+	assert(!m_Connection && !m_ConnectPending && !m_pLink);
+
+	if (CreateLink(newStream.get()))
+	{
+		std::shared_ptr<io::TcpStream::Ptr> pStream = std::make_shared<io::TcpStream::Ptr>(std::move(newStream));
+		PostToLink([pStream](Link& x) { x.Accept(std::move(*pStream)); });
+		return;
+	}
 
 	m_Connection = std::make_unique<Connection>(
 		m_Protocol,
@@ -426,20 +646,189 @@ void NodeConnection::Accept(io::TcpStream::Ptr&& newStream)
 		100,
 		std::move(newStream)
 		);
+
+	m_Connection->set_drain_callback(m_SendLimits.m_LowWatermark, [this]() { FlushSendQueue(); });
 }
 
+namespace MsgCode
+{
+	enum Enum {
+#define THE_MACRO(code, msg) msg = code,
+		BeamNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
+	};
+}
+
+NodeConnection::SendClass::Enum NodeConnection::SendClass::get(uint8_t nCode)
+{
+	switch (nCode)
+	{
+	case MsgCode::NewTip:
+	case MsgCode::GetHdr:
+	case MsgCode::GetBody:
+	case MsgCode::GetProofState:
+	case MsgCode::GetProofKernel:
+	case MsgCode::GetProofUtxo:
+	case MsgCode::GetProofChainWork:
+	case MsgCode::GetReconcileSketch:
+	case MsgCode::GetTransaction:
+	case MsgCode::GetTransactions:
+	case MsgCode::BbsGetMsg:
+	case MsgCode::BbsGetMsgs:
+		return Headers;
+
+	// responses are kept in the same class, so that they're sent in the order of the requests
+	case MsgCode::Hdr:
+	case MsgCode::Body:
+	case MsgCode::DataMissing:
+	case MsgCode::ProofKernel:
+	case MsgCode::ProofUtxo:
+	case MsgCode::ProofState:
+	case MsgCode::ProofChainWork:
+	case MsgCode::ReconcileSketch:
+	// the requested (or subscribed) txs and bbs messages. Not dropped, the other side may be waiting for them
+	case MsgCode::NewTransaction:
+	case MsgCode::BbsMsg:
+		return Bodies;
+
+	// unsolicited announcements only, the peer may re-request anything it still misses
+	case MsgCode::HaveTransaction:
+	case MsgCode::HaveTransactions:
+	case MsgCode::PeerInfo:
+	case MsgCode::BbsHaveMsg:
+	case MsgCode::BbsHaveMsgs:
+		return Gossip;
+	}
+
+	return Control;
+}
+
+void NodeConnection::SendSerialized(uint8_t nCode)
+{
+	uint32_t nSize = 0;
+	for (size_t i = 0; i < m_SerializeCache.size(); i++)
+		nSize += (uint32_t) m_SerializeCache[i].size;
+
+	SendClass::Enum eClass = SendClass::get(nCode);
+	SendStats::PerClass& stats = m_SendStats.m_p[eClass];
+
+	// The MAC is already appended according to the current mode, hence the messages are queued only after the mode is final
+	if (!IsSecureOut() || (!m_SendQueue.m_Count && (m_Connection->unsent() < m_SendLimits.m_HighWatermark)))
+	{
+		WriteSerialized(stats, nSize);
+		return;
+	}
+
+	std::deque<SendQueue::Item>& q = m_SendQueue.m_p[eClass];
+
+	if (MsgCode::NewTip == nCode)
+	{
+		// only the most recent tip matters
+		for (size_t i = 0; i < q.size(); i++)
+		{
+			SendQueue::Item& item = q[i];
+			if (item.m_Code != nCode)
+				continue;
+
+			stats.m_QueuedBytes += nSize - item.m_Size;
+			stats.m_Coalesced++;
+
+			item.m_Msg.swap(m_SerializeCache);
+			item.m_Size = nSize;
+			m_SerializeCache.clear();
+			return;
+		}
+	}
+
+	if ((SendClass::Gossip == eClass) && (stats.m_QueuedBytes + nSize > m_SendLimits.m_MaxGossip))
+	{
+		stats.m_Dropped++;
+		m_SerializeCache.clear();
+		return;
+	}
+
+	q.emplace_back();
+	SendQueue::Item& item = q.back();
+	item.m_Msg.swap(m_SerializeCache);
+	item.m_Size = nSize;
+	item.m_Code = nCode;
+
+	stats.m_Queued++;
+	stats.m_QueuedBytes += nSize;
+	m_SendQueue.m_Count++;
+}
+
+void NodeConnection::WriteSerialized(SendStats::PerClass& stats, uint32_t nSize)
+{
+	m_Protocol.Encrypt(m_SerializeCache);
+	io::Result res = m_Connection->write_msg(m_SerializeCache);
+	m_SerializeCache.clear();
+
+	stats.m_Msgs++;
+	stats.m_Bytes += nSize;
+
+	static metrics::Counter& s_BytesOut = metrics::Registry::get().counter("net.bytes_out");
+	s_BytesOut.add(nSize);
+
+	TestIoResultAsync(res);
+}
+
+void NodeConnection::FlushSendQueue()
+{
+	while (m_SendQueue.m_Count && !m_pAsyncFail && (m_Connection->unsent() < m_SendLimits.m_HighWatermark))
+	{
+		uint32_t iClass = 0;
+		while (m_SendQueue.m_p[iClass].empty())
+			iClass++;
+
+		std::deque<SendQueue::Item>& q = m_SendQueue.m_p[iClass];
+		SendQueue::Item& item = q.front();
+		SendStats::PerClass& stats = m_SendStats.m_p[iClass];
+
+		uint32_t nSize = item.m_Size;
+		m_SerializeCache.swap(item.m_Msg);
+		q.pop_front();
+
+		m_SendQueue.m_Count--;
+		stats.m_Queued--;
+		stats.m_QueuedBytes -= nSize;
+
+		WriteSerialized(stats, nSize);
+	}
+}
+
+void NodeConnection::ResetSendQueue()
+{
+	for (uint32_t i = 0; i < SendClass::count; i++)
+	{
+		m_SendQueue.m_p[i].clear();
+		m_SendStats.m_p[i].m_Queued = 0;
+		m_SendStats.m_p[i].m_QueuedBytes = 0;
+	}
+
+	m_SendQueue.m_Count = 0;
+}
+
+// Potentially big messages. Their size (incl. the mac) is calculated in advance, so that they're serialized into a single buffer
+template <typename T> size_t get_SizeHint(const T&) { return 0; }
+size_t get_SizeHint(const Body& msg) { return get_serialized_size(msg) + ProtocolPlus::MacValue::nBytes; }
+size_t get_SizeHint(const NewTransaction& msg) { return get_serialized_size(msg) + ProtocolPlus::MacValue::nBytes; }
+size_t get_SizeHint(const BbsMsg& msg) { return get_serialized_size(msg) + ProtocolPlus::MacValue::nBytes; }
+
 #define THE_MACRO(code, msg) \
 void NodeConnection::Send(const msg& v) \
 { \
+	if (m_pLink) \
+	{ \
+		PostToLink([v](Link& x) { if (x.m_Connection) x.Send(v); }); \
+		return; \
+	} \
 	if (m_pAsyncFail) \
 		return; \
 	m_SerializeCache.clear(); \
-	MsgSerializer& ser = m_Protocol.serializeNoFinalize(m_SerializeCache, uint8_t(code), v); \
-	m_Protocol.Encrypt(m_SerializeCache, ser); \
-	io::Result res = m_Connection->write_msg(m_SerializeCache); \
-	m_SerializeCache.clear(); \
-\
-	TestIoResultAsync(res); \
+	MsgSerializer& ser = m_Protocol.serializeNoFinalize(m_SerializeCache, uint8_t(code), v, get_SizeHint(v)); \
+	m_Protocol.Finalize(m_SerializeCache, ser); \
+	SendSerialized(uint8_t(code)); \
 } \
 \
 bool NodeConnection::OnMsgInternal(uint64_t, msg##_NoInit&& v) \
@@ -485,6 +874,12 @@ void NodeConnection::GenerateSChannelNonce(ECC::Scalar::Native& sk)
 
 void NodeConnection::SecureConnect()
 {
+	if (m_pLink)
+	{
+		PostToLink([](Link& x) { if (x.m_Connection) x.SecureConnect(); });
+		return;
+	}
+
 	if (!(m_Protocol.m_MyNonce == Zero))
 		return; // already sent
 
@@ -528,6 +923,22 @@ void NodeConnection::ProveID(ECC::Scalar::Native& sk, uint8_t nIDType)
 {
 	assert(IsSecureOut());
 
+	if (m_pLink)
+	{
+		ECC::Scalar s;
+		sk.Export(s);
+
+		PostToLink([s, nIDType](Link& x) {
+			if (x.IsSecureOut())
+			{
+				ECC::Scalar::Native k;
+				k.Import(s);
+				x.ProveID(k, nIDType);
+			}
+		});
+		return;
+	}
+
 	// confirm our ID
 	ECC::Hash::Value hv;
 	ECC::Hash::Processor() << m_Protocol.m_RemoteNonce >> hv;
@@ -552,6 +963,9 @@ bool NodeConnection::IsSecureOut() const
 
 void NodeConnection::OnMsg(Authentication&& msg)
 {
+	if (m_pLink)
+		return; // verified by the link
+
 	if (!IsSecureIn())
 		ThrowUnexpected();
 
@@ -584,9 +998,45 @@ void NodeConnection::OnMsg(Bye&& msg)
 
 /////////////////////////
 // NodeConnection::Server
-void NodeConnection::Server::Listen(const io::Address& addr)
+void NodeConnection::Server::Listen(const io::Address& addr, Threads* pThreads)
+{
+	io::Reactor::Ptr pReactor = io::Reactor::get_Current().shared_from_this();
+
+	if (pThreads && pThreads->m_pPool)
+	{
+		// invoked in a network thread. The stream stays attached to its reactor, Accept() binds the link to it
+		io::TcpServer::Callback cb = [this, pThreads](io::TcpStream::Ptr&& newStream, io::ErrorCode errorCode) {
+			std::shared_ptr<io::TcpStream::Ptr> pStream = std::make_shared<io::TcpStream::Ptr>(std::move(newStream));
+			pThreads->PostHome([this, pStream, errorCode]() { OnAccepted(std::move(*pStream), errorCode); });
+		};
+
+		m_pServer = io::TcpServer::create(pReactor, addr, std::move(cb), *pThreads->m_pPool);
+	}
+	else
+		m_pServer = io::TcpServer::create(pReactor, addr, BIND_THIS_MEMFN(OnAccepted));
+}
+
+/////////////////////////
+// NodeConnection::Threads
+void NodeConnection::Threads::Create(uint32_t nThreads)
+{
+	Destroy();
+
+	m_pRx.reset(new RX<io::ReactorPool::Task>(io::Reactor::get_Current().shared_from_this(), [](io::ReactorPool::Task&& task) { task(); }));
+	m_pTx.reset(new TX<io::ReactorPool::Task>(m_pRx->get_tx()));
+	m_pPool = io::ReactorPool::create(nThreads);
+}
+
+void NodeConnection::Threads::Destroy()
+{
+	m_pPool = NULL; // first stop the threads, they post to the owner
+	m_pTx = NULL;
+	m_pRx = NULL;
+}
+
+bool NodeConnection::Threads::PostHome(io::ReactorPool::Task&& task)
 {
-	m_pServer = io::TcpServer::create(io::Reactor::get_Current().shared_from_this(), addr, BIND_THIS_MEMFN(OnAccepted));
+	return m_pTx->send(std::move(task));
 }
 
 /////////////////////////
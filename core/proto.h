@@ -22,6 +22,7 @@
 #include "../utility/io/tcpserver.h"
 #include "aes.h"
 #include "block_crypt.h"
+#include "iblt.h"
 #include <boost/intrusive/set.hpp>
 #include <boost/intrusive/list.hpp>
 
@@ -87,7 +88,8 @@ namespace proto {
 	macro(bool, SpreadingTransactions) \
 	macro(bool, Bbs) \
 	macro(bool, SendPeers) \
-	macro(bool, AutoSendHdr) /* prefer the header in addition to the NewTip message */
+	macro(bool, AutoSendHdr) /* prefer the header in addition to the NewTip message */ \
+	macro(bool, Reconciliation) /* supports ReconcileSketch, instead of announcing the whole tx pool and bbs messages */
 
 #define BeamNodeMsg_Ping(macro)
 #define BeamNodeMsg_Pong(macro)
@@ -101,6 +103,21 @@ namespace proto {
 #define BeamNodeMsg_GetTransaction(macro) \
 	macro(Transaction::KeyType, ID)
 
+#define BeamNodeMsg_HaveTransactions(macro) \
+	macro(std::vector<Transaction::KeyType>, IDs)
+
+#define BeamNodeMsg_GetTransactions(macro) \
+	macro(std::vector<Transaction::KeyType>, IDs)
+
+#define BeamNodeMsg_ReconcileSketch(macro) \
+	macro(uint8_t, SetType) \
+	macro(uint32_t, SetSize) \
+	macro(std::vector<Iblt::Cell>, Cells)
+
+#define BeamNodeMsg_GetReconcileSketch(macro) \
+	macro(uint8_t, SetType) \
+	macro(uint32_t, CellsPerHash) /* 0 - announce the whole set instead */
+
 #define BeamNodeMsg_Bye(macro) \
 	macro(uint8_t, Reason)
 
@@ -132,6 +149,12 @@ namespace proto {
 #define BeamNodeMsg_BbsGetMsg(macro) \
 	macro(BbsMsgID, Key)
 
+#define BeamNodeMsg_BbsHaveMsgs(macro) \
+	macro(std::vector<BbsMsgID>, Keys)
+
+#define BeamNodeMsg_BbsGetMsgs(macro) \
+	macro(std::vector<BbsMsgID>, Keys)
+
 #define BeamNodeMsg_BbsSubscribe(macro) \
 	macro(BbsChannel, Channel) \
 	macro(Timestamp, TimeFrom) \
@@ -176,6 +199,8 @@ namespace proto {
 	macro(23, NewTransaction) \
 	macro(24, HaveTransaction) \
 	macro(25, GetTransaction) \
+	macro(26, HaveTransactions) /* batched inventory, up to Inventory::s_EntriesMax */ \
+	macro(27, GetTransactions) \
 	macro(29, Bye) \
 	macro(31, PeerInfoSelf) \
 	macro(32, PeerInfo) \
@@ -183,9 +208,13 @@ namespace proto {
 	macro(34, Time) \
 	macro(35, GetExternalAddr) \
 	macro(36, ExternalAddr) \
+	macro(37, ReconcileSketch) \
+	macro(38, GetReconcileSketch) \
 	macro(40, BbsMsg) \
 	macro(41, BbsHaveMsg) \
 	macro(42, BbsGetMsg) \
+	macro(46, BbsHaveMsgs) \
+	macro(47, BbsGetMsgs) \
 	macro(43, BbsSubscribe) \
 	macro(44, BbsPickChannel) \
 	macro(45, BbsPickChannelRes) \
@@ -212,6 +241,41 @@ namespace proto {
 		static const uint32_t s_EntriesMax = 200; // if this is the size of the vector - the result is probably trunacted
 	};
 
+	// The last byte of the message header signature. Messages are deserialized strictly (the layout must match exactly),
+	// hence any change to an existing message (such as a new Config field) is incompatible, and the version must be bumped.
+	// Then the peers of different versions reject each other at the first message header.
+	//	0xCC - initial
+	//	0xCD - Config.Reconciliation, batched inventory, reconciliation sketches
+	struct Version
+	{
+		static const uint8_t s_Value = 0xCD;
+	};
+
+	struct Inventory
+	{
+		static const uint32_t s_EntriesMax = 1000; // max IDs in a single batched announcement or request
+	};
+
+	// Peers exchange the IBLTs of their sets on connection, and request the elements they miss.
+	// If the difference can't be decoded - a bigger table is requested, up to the limit, then the whole set.
+	struct Reconciliation
+	{
+		struct SetType
+		{
+			static const uint8_t Transactions	= 0;
+			static const uint8_t Bbs			= 1;
+		};
+
+		static const uint32_t s_CellsPerHashMin = 32;
+		static const uint32_t s_CellsPerHashMax = 1024;
+	};
+
+	struct BbsCipher
+	{
+		// short per-recipient tag, derived from the DH secret. Lets the recipient skip messages for others without computing the mac
+		static const uint32_t s_TagBytes = 4;
+	};
+
 	struct IDType
 	{
 		static const uint8_t Node		= 'N';
@@ -300,12 +364,14 @@ namespace proto {
 		virtual uint32_t get_MacSize() override;
 		virtual bool VerifyMsg(const uint8_t*, uint32_t nSize) override;
 
-		void Encrypt(SerializedMsg&, MsgSerializer&);
+		void Finalize(SerializedMsg&, MsgSerializer&); // appends the mac (if needed)
+		void Encrypt(SerializedMsg&); // must be called in the same order the messages are sent
 	};
 
 	void Sk2Pk(PeerID&, ECC::Scalar::Native&); // will negate the scalar iff necessary
 	bool BbsEncrypt(ByteBuffer& res, const PeerID& publicAddr, ECC::Scalar::Native& nonce, const void*, uint32_t); // will fail iff addr is invalid
-	bool BbsDecrypt(uint8_t*& p, uint32_t& n, ECC::Scalar::Native& privateAddr);
+	bool BbsDecrypt(uint8_t*& p, uint32_t& n, const ECC::Scalar::Native& privateAddr); // the buffer is modified only on success
+	bool BbsCheck(const uint8_t* p, uint32_t n, const ECC::Scalar::Native& privateAddr); // checks tag and mac without decrypting, thread-safe
 
 	struct INodeMsgHandler
 		:public IErrorHandler
@@ -351,6 +417,102 @@ namespace proto {
 		virtual ~NodeConnection();
 		void Reset();
 
+		// Network threads. If assigned to the connection (before it's connected or accepted), its I/O, encryption and (de)serialization
+		// are performed by one of those threads. Messages are handed-off via queues, all the handlers are still invoked in the owner thread.
+		struct Threads
+		{
+			io::ReactorPool::Ptr m_pPool;
+			std::unique_ptr<RX<io::ReactorPool::Task> > m_pRx;
+			std::unique_ptr<TX<io::ReactorPool::Task> > m_pTx;
+
+			~Threads() { Destroy(); }
+
+			void Create(uint32_t nThreads); // must be called in the owner thread
+			void Destroy();
+
+			bool PostHome(io::ReactorPool::Task&&);
+		};
+
+		void set_Threads(Threads* p) { m_pThreads = p; }
+
+	private:
+
+		Threads* m_pThreads;
+		uint32_t m_iThread;
+
+		class Link;
+		std::shared_ptr<Link> m_pLink; // set if the connection is served by a network thread
+
+		bool CreateLink(const io::TcpStream*);
+		template <typename TFunc> void PostToLink(TFunc&&);
+
+	public:
+
+		struct SendClass
+		{
+			enum Enum {
+				Control,	// secure channel, config, ping, small requests/responses
+				Headers,	// tips, data requests (incl. tx/bbs)
+				Bodies,		// data responses (headers, blocks, proofs, txs, bbs), their order is preserved
+				Gossip,		// tx/bbs announcements, peers. May be dropped if the peer is too slow
+				count
+			};
+
+			static Enum get(uint8_t nCode);
+		};
+
+		// Messages are written to the socket directly unless it's congested (the unsent data reached the high watermark).
+		// Then they're queued per class, and written in the priority order once the socket drains to the low watermark.
+		// Queued messages are already serialized, the cipher is applied when they're written.
+		struct SendLimits
+		{
+			uint32_t m_HighWatermark = 4 * 1024 * 1024;
+			uint32_t m_LowWatermark = 1024 * 1024;
+			uint32_t m_MaxGossip = 2 * 1024 * 1024; // queued gossip beyond this is dropped
+		} m_SendLimits; // should be set before connecting
+
+		struct SendStats
+		{
+			struct PerClass
+			{
+				uint64_t m_Msgs; // written to the socket
+				uint64_t m_Bytes;
+				uint32_t m_Queued; // currently
+				uint32_t m_QueuedBytes;
+				uint64_t m_Dropped;
+				uint64_t m_Coalesced; // replaced by a newer one while queued
+			};
+
+			PerClass m_p[SendClass::count];
+		};
+
+		// For connections served by a network thread the stats are maintained by its link
+		const SendStats& get_SendStats() const { return m_SendStats; }
+
+	private:
+
+		struct SendQueue
+		{
+			struct Item
+			{
+				SerializedMsg m_Msg;
+				uint32_t m_Size;
+				uint8_t m_Code;
+			};
+
+			std::deque<Item> m_p[SendClass::count];
+			uint32_t m_Count;
+		} m_SendQueue;
+
+		SendStats m_SendStats;
+
+		void SendSerialized(uint8_t nCode);
+		void WriteSerialized(SendStats::PerClass&, uint32_t nSize);
+		void FlushSendQueue();
+		void ResetSendQueue();
+
+	public:
+
 		static void ThrowUnexpected(const char* = NULL);
 
 		void Connect(const io::Address& addr);
@@ -416,7 +578,7 @@ namespace proto {
 		struct Server
 		{
 			io::TcpServer::Ptr m_pServer; // just delete it to stop listening
-			void Listen(const io::Address& addr);
+			void Listen(const io::Address& addr, Threads* = NULL); // if threads are specified - accepted in network threads, handed-off to the owner
 
 			virtual void OnAccepted(io::TcpStream::Ptr&&, int errorCode) = 0;
 		};
@@ -14,6 +14,7 @@
 
 #include "radixtree.h"
 #include "ecc_native.h"
+#include <thread>
 
 namespace beam {
 
@@ -185,6 +186,167 @@ RadixTree::Leaf* RadixTree::Find(CursorBase& cu, const uint8_t* pKey, uint32_t n
 	if (!bCreate)
 		return NULL;
 
+	return Insert(cu, pKey, nBits);
+}
+
+RadixTree::Leaf* RadixTree::Append(CursorBase& cu, const uint8_t* pKey, uint32_t nBits, bool& bCreate)
+{
+	if (!m_pRoot)
+		return Find(cu, pKey, nBits, bCreate);
+
+	const uint8_t* pKeyMax = GetLeafKey(cu.get_Leaf());
+
+	uint32_t nBit = get_DiffBit(pKey, pKeyMax, nBits);
+	if (nBit == nBits)
+	{
+		bCreate = false;
+		return &cu.get_Leaf();
+	}
+
+	if (!(1 & CursorBase::get_BitRawStat(pKey, nBit)))
+		throw std::runtime_error("incorrect order"); // Find would leave the cursor off the rightmost path
+
+	// The max element is the rightmost, hence the difference must be within one of the nodes on its path (not at the joint branching bit).
+	uint32_t nBitsNode = 0;
+	for (cu.m_nPtrs = 1; ; cu.m_nPtrs++)
+	{
+		const Node* p = cu.m_pp[cu.m_nPtrs - 1];
+
+		uint32_t nBitsNext = nBitsNode + p->get_Bits();
+		if (nBit < nBitsNext)
+			break;
+
+		assert(nBit > nBitsNext);
+		nBitsNode = nBitsNext + 1;
+	}
+
+	cu.m_nBits = nBit;
+	cu.m_nPosInLastNode = nBit - nBitsNode;
+
+	if (!bCreate)
+		return NULL;
+
+	return Insert(cu, pKey, nBits);
+}
+
+uint32_t RadixTree::get_DiffBit(const uint8_t* pKey0, const uint8_t* pKey1, uint32_t nBits)
+{
+	uint32_t nBit = 0;
+	while ((nBit + 8 <= nBits) && (pKey0[nBit >> 3] == pKey1[nBit >> 3]))
+		nBit += 8;
+
+	for ( ; nBit < nBits; nBit++)
+		if (1 & (CursorBase::get_BitRawStat(pKey0, nBit) ^ CursorBase::get_BitRawStat(pKey1, nBit)))
+			break;
+
+	return nBit;
+}
+
+struct RadixTree::BulkCtx
+{
+	RadixTree& m_Tree;
+	std::vector<Leaf*> m_vLeafs;
+	std::vector<Joint*> m_vJoints; // joint i splits leafs i and i+1
+	std::vector<uint32_t> m_vDiff; // the 1st differing bit of leafs i and i+1
+	uint32_t m_nBits;
+
+	static const size_t s_MinParallel = 0x1000;
+
+	BulkCtx(RadixTree& t) :m_Tree(t) {}
+
+	~BulkCtx()
+	{
+		// not empty only on exc
+		for (size_t i = 0; i < m_vLeafs.size(); i++)
+			m_Tree.DeleteLeaf(m_vLeafs[i]);
+		for (size_t i = 0; i < m_vJoints.size(); i++)
+			m_Tree.DeleteJoint(m_vJoints[i]);
+	}
+
+	Node* Build(size_t i0, size_t i1, uint32_t nBit0, uint32_t nThreads)
+	{
+		assert(i1 > i0);
+		if (i0 + 1 == i1)
+		{
+			Leaf* p = m_vLeafs[i0];
+			p->m_Bits = static_cast<uint16_t>(m_nBits - nBit0) | Node::s_Leaf;
+			return p;
+		}
+
+		// split where the common prefix of the range ends. Since keys are sorted - there's exactly one such a position
+		size_t iMid = i0;
+		for (size_t i = i0 + 1; i + 1 < i1; i++)
+			if (m_vDiff[i] < m_vDiff[iMid])
+				iMid = i;
+
+		uint32_t nBit = m_vDiff[iMid];
+		assert(nBit >= nBit0);
+
+		Joint* pJ = m_vJoints[iMid];
+		pJ->m_Bits = static_cast<uint16_t>(nBit - nBit0);
+		pJ->m_pKeyPtr = m_Tree.GetLeafKey(*m_vLeafs[iMid]);
+
+		if ((nThreads > 1) && (i1 - i0 >= s_MinParallel))
+		{
+			uint32_t nThreads0 = nThreads >> 1;
+			std::thread t([this, pJ, i0, iMid, nBit, nThreads0]() {
+				pJ->m_ppC[0] = Build(i0, iMid + 1, nBit + 1, nThreads0);
+			});
+
+			pJ->m_ppC[1] = Build(iMid + 1, i1, nBit + 1, nThreads - nThreads0);
+			t.join();
+		}
+		else
+		{
+			pJ->m_ppC[0] = Build(i0, iMid + 1, nBit + 1, 1);
+			pJ->m_ppC[1] = Build(iMid + 1, i1, nBit + 1, 1);
+		}
+
+		return pJ;
+	}
+};
+
+void RadixTree::BuildSorted(ILeafInit& li, size_t nCount, uint32_t nBits, uint32_t nThreads)
+{
+	assert(!m_pRoot);
+	if (!nCount)
+		return;
+
+	BulkCtx bc(*this);
+	bc.m_nBits = nBits;
+
+	bc.m_vLeafs.reserve(nCount);
+	bc.m_vJoints.reserve(nCount - 1);
+	bc.m_vDiff.resize(nCount - 1);
+
+	for (size_t i = 0; i < nCount; i++)
+	{
+		bc.m_vLeafs.push_back(CreateLeaf());
+		li.InitLeaf(*bc.m_vLeafs.back(), i);
+
+		if (i)
+		{
+			const uint8_t* pKey0 = GetLeafKey(*bc.m_vLeafs[i - 1]);
+			const uint8_t* pKey1 = GetLeafKey(*bc.m_vLeafs[i]);
+
+			uint32_t nBit = get_DiffBit(pKey0, pKey1, nBits);
+			if ((nBit == nBits) || (1 & CursorBase::get_BitRawStat(pKey0, nBit)))
+				throw std::runtime_error("incorrect order");
+
+			bc.m_vDiff[i - 1] = nBit;
+			bc.m_vJoints.push_back(CreateJoint());
+		}
+	}
+
+	m_pRoot = bc.Build(0, nCount, 0, nThreads);
+
+	// dismiss
+	bc.m_vLeafs.clear();
+	bc.m_vJoints.clear();
+}
+
+RadixTree::Leaf* RadixTree::Insert(CursorBase& cu, const uint8_t* pKey, uint32_t nBits)
+{
 	Leaf* pN = CreateLeaf();
 
 	// Guard the allocated leaf. In case exc will be thrown (during possible allocation of a new joint)
@@ -504,8 +666,37 @@ void RadixHashTree::get_Proof(Merkle::Proof& proof, const CursorBase& cu)
 	assert(proof.size() == nOut);
 }
 
+/////////////////////////////
+// RadixHashOnlyTree
+void RadixHashOnlyTree::BuildSorted(const Merkle::Hash* pKey, size_t nCount, uint32_t nThreads)
+{
+	struct Init :public ILeafInit {
+		const Merkle::Hash* m_pKey;
+		virtual void InitLeaf(Leaf& x, size_t i) override {
+			((MyLeaf&) x).m_Hash = m_pKey[i];
+		}
+	} li;
+	li.m_pKey = pKey;
+
+	RadixTree::BuildSorted(li, nCount, ECC::nBits, nThreads);
+}
+
 /////////////////////////////
 // UtxoTree
+void UtxoTree::BuildSorted(const Entry* pE, size_t nCount, uint32_t nThreads)
+{
+	struct Init :public ILeafInit {
+		const Entry* m_pE;
+		virtual void InitLeaf(Leaf& x, size_t i) override {
+			((MyLeaf&) x).m_Key = m_pE[i].m_Key;
+			((MyLeaf&) x).m_Value = m_pE[i].m_Value;
+		}
+	} li;
+	li.m_pE = pE;
+
+	RadixTree::BuildSorted(li, nCount, Key::s_Bits, nThreads);
+}
+
 void UtxoTree::Value::get_Hash(Merkle::Hash& hv, const Key& key) const
 {
 	ECC::Hash::Processor hp;
@@ -564,6 +755,7 @@ void UtxoTree::LoadIntenral(ISerializer& s)
 	s.Process(n);
 
 	Key pKey[2];
+	Cursor cu;
 
 	for (uint32_t i = 0; i < n; i++)
 	{
@@ -579,9 +771,8 @@ void UtxoTree::LoadIntenral(ISerializer& s)
 				throw std::runtime_error("incorrect order");
 		}
 
-		Cursor cu;
 		bool bCreate = true;
-		MyLeaf* p = Find(cu, key, bCreate);
+		MyLeaf* p = Append(cu, key, bCreate);
 
 		p->m_Value.m_Count = 0;
 		s.Process(p->m_Value);
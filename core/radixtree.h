@@ -47,6 +47,14 @@ protected:
 	Node* get_Root() const { return m_pRoot; }
 	const uint8_t* get_NodeKey(const Node&) const;
 
+	struct ILeafInit {
+		virtual void InitLeaf(Leaf&, size_t i) = 0; // set the key (and the value, if any)
+	};
+
+	// Bulk construction of the empty tree, bottom-up in a single pass. Leaves are initialized in order, their keys must be strictly ascending.
+	// All the nodes are allocated beforehand, then the top-level subtrees are linked in parallel (if nThreads > 1).
+	void BuildSorted(ILeafInit&, size_t nCount, uint32_t nBits, uint32_t nThreads);
+
 	virtual Joint* CreateJoint() = 0;
 	virtual Leaf* CreateLeaf() = 0;
 	virtual uint8_t* GetLeafKey(const Leaf&) const = 0;
@@ -98,6 +106,10 @@ public:
 
 	Leaf* Find(CursorBase& cu, const uint8_t* pKey, uint32_t nBits, bool& bCreate);
 
+	// Optimized for sorted insertion. The key must not be less than the max key in the tree, and the cursor must point to that max element
+	// (as left by the previous Append, or Find). The descent from the root is skipped. Throws if the key is less than the max.
+	Leaf* Append(CursorBase& cu, const uint8_t* pKey, uint32_t nBits, bool& bCreate);
+
 	void Delete(CursorBase& cu);
 
 	struct ITraveler
@@ -126,8 +138,12 @@ private:
 
 	void DeleteNode(Node*);
 	void ReplaceTip(CursorBase& cu, Node* pNew);
+	Leaf* Insert(CursorBase& cu, const uint8_t* pKey, uint32_t nBits);
+
+	struct BulkCtx;
 	bool Traverse(const Node&, ITraveler&) const;
 
+	static uint32_t get_DiffBit(const uint8_t* pKey0, const uint8_t* pKey1, uint32_t nBits); // nBits if equal
 	static int Cmp(const uint8_t* pKey, const uint8_t* pThreshold, uint32_t n0, uint32_t dn);
 	static int Cmp1(uint8_t, const uint8_t* pThreshold, uint32_t n0);
 };
@@ -174,6 +190,8 @@ public:
 		return (MyLeaf*) RadixTree::Find(cu, key.m_pData, ECC::nBits, bCreate);
 	}
 
+	void BuildSorted(const Merkle::Hash* pKey, size_t nCount, uint32_t nThreads = 1); // the tree must be empty, keys must be strictly ascending
+
 	~RadixHashOnlyTree() { Clear(); }
 
 protected:
@@ -233,6 +251,19 @@ public:
 		return (MyLeaf*) RadixTree::Find(cu, key.m_pArr, key.s_Bits, bCreate);
 	}
 
+	MyLeaf* Append(CursorBase& cu, const Key& key, bool& bCreate)
+	{
+		return (MyLeaf*) RadixTree::Append(cu, key.m_pArr, key.s_Bits, bCreate);
+	}
+
+	struct Entry
+	{
+		Key m_Key;
+		Value m_Value;
+	};
+
+	void BuildSorted(const Entry*, size_t nCount, uint32_t nThreads = 1); // the tree must be empty, keys must be strictly ascending
+
 	~UtxoTree() { Clear(); }
 
     template<typename Archive>
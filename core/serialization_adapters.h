@@ -420,6 +420,12 @@ namespace detail
 
         template<typename Archive>
         static Archive& load(Archive& ar, beam::Output& output)
+        {
+			return load_Output(ar, output, nullptr);
+        }
+
+        template<typename Archive>
+        static Archive& load_Output(Archive& ar, beam::Output& output, beam::TxVectorsFlat::Arena* pArena)
         {
 			uint8_t nFlags;
 			ar
@@ -431,13 +437,19 @@ namespace detail
 
 			if (4 & nFlags)
 			{
-				output.m_pConfidential = std::make_unique<ECC::RangeProof::Confidential>();
+				if (pArena)
+					pArena->Create(output.m_pConfidential);
+				else
+					output.m_pConfidential.reset(new ECC::RangeProof::Confidential);
 				ar & *output.m_pConfidential;
 			}
 
 			if (8 & nFlags)
 			{
-				output.m_pPublic = std::make_unique<ECC::RangeProof::Public>();
+				if (pArena)
+					pArena->Create(output.m_pPublic);
+				else
+					output.m_pPublic.reset(new ECC::RangeProof::Public);
 				ar & *output.m_pPublic;
 			}
 
@@ -616,6 +628,85 @@ namespace detail
             return ar;
         }
 
+		// TxVectorsFlat has the same format as TxVectors (vectors of non-NULL pointers)
+		template<typename Archive, typename TElement>
+		static void save_Flat(Archive& ar, const std::vector<TElement*>& v)
+		{
+			ar.write_seq_size(v.size());
+
+			for (size_t i = 0; i < v.size(); i++)
+			{
+				ar & true;
+				ar & *v[i];
+			}
+		}
+
+		template<typename Archive>
+		static void load_FlatPtr(Archive& ar)
+		{
+			bool b;
+			ar & b;
+			if (!b)
+				throw std::runtime_error("invalid NULL ptr");
+		}
+
+		template<typename Archive>
+		static void load_Flat(Archive& ar, std::vector<beam::Input*>& v, beam::TxVectorsFlat::Arena& a)
+		{
+			for (auto n = ar.read_seq_size(); n; n--)
+			{
+				load_FlatPtr(ar);
+				v.push_back(a.Create<beam::Input>());
+				ar & *v.back();
+			}
+		}
+
+		template<typename Archive>
+		static void load_Flat(Archive& ar, std::vector<beam::Output*>& v, beam::TxVectorsFlat::Arena& a)
+		{
+			for (auto n = ar.read_seq_size(); n; n--)
+			{
+				load_FlatPtr(ar);
+				v.push_back(a.Create<beam::Output>());
+				load_Output(ar, *v.back(), &a);
+			}
+		}
+
+		template<typename Archive>
+		static void load_Flat(Archive& ar, std::vector<beam::TxKernel*>& v, beam::TxVectorsFlat::Arena& a)
+		{
+			for (auto n = ar.read_seq_size(); n; n--)
+			{
+				load_FlatPtr(ar);
+				v.push_back(a.Create<beam::TxKernel>());
+				ar & *v.back();
+			}
+		}
+
+		template<typename Archive>
+		static Archive& save(Archive& ar, const beam::TxVectorsFlat& txv)
+		{
+			save_Flat(ar, txv.m_vInputs);
+			save_Flat(ar, txv.m_vOutputs);
+			save_Flat(ar, txv.m_vKernelsInput);
+			save_Flat(ar, txv.m_vKernelsOutput);
+
+			return ar;
+		}
+
+		template<typename Archive>
+		static Archive& load(Archive& ar, beam::TxVectorsFlat& txv)
+		{
+			txv.Clear();
+
+			load_Flat(ar, txv.m_vInputs, txv.m_Arena);
+			load_Flat(ar, txv.m_vOutputs, txv.m_Arena);
+			load_Flat(ar, txv.m_vKernelsInput, txv.m_Arena);
+			load_Flat(ar, txv.m_vKernelsOutput, txv.m_Arena);
+
+			return ar;
+		}
+
         template<typename Archive>
         static Archive& save(Archive& ar, const beam::Transaction& tx)
         {
@@ -793,6 +884,24 @@ namespace detail
 
 			return ar;
 		}
+
+		template<typename Archive>
+		static Archive& save(Archive& ar, const beam::Block::BodyFlat& bb)
+		{
+			ar & (const beam::Block::BodyBase&) bb;
+			ar & (const beam::TxVectorsFlat&) bb;
+
+			return ar;
+		}
+
+		template<typename Archive>
+		static Archive& load(Archive& ar, beam::Block::BodyFlat& bb)
+		{
+			ar & (beam::Block::BodyBase&) bb;
+			ar & (beam::TxVectorsFlat&) bb;
+
+			return ar;
+		}
 	};
 }
 }
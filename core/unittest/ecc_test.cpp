@@ -725,6 +725,39 @@ void TestTransaction()
 	beam::TxBase::Context ctx;
 	verify_test(tm.m_Trans.IsValid(ctx));
 	verify_test(!ctx.m_Fee.Hi && (ctx.m_Fee.Lo == fee1 + fee2));
+
+	// same via the flat (arena-backed) representation
+	beam::Serializer ser;
+	ser & (const beam::TxVectors&) tm.m_Trans;
+
+	beam::SerializeBuffer sb = ser.buffer();
+
+	beam::TxVectorsFlat txvf;
+	beam::Deserializer der;
+	der.reset(sb.first, sb.second);
+	der & txvf;
+
+	verify_test(txvf.m_vInputs.size() == tm.m_Trans.m_vInputs.size());
+	verify_test(txvf.m_vOutputs.size() == tm.m_Trans.m_vOutputs.size());
+	verify_test(txvf.m_vKernelsOutput.size() == tm.m_Trans.m_vKernelsOutput.size());
+
+	beam::TxBase::Context ctx2;
+	verify_test(ctx2.ValidateAndSummarize(tm.m_Trans, txvf.get_Reader()) && ctx2.IsValidTransaction());
+	verify_test(!ctx2.m_Fee.Hi && (ctx2.m_Fee.Lo == fee1 + fee2));
+
+	// the same format
+	beam::Serializer ser2;
+	ser2 & txvf;
+	beam::SerializeBuffer sb2 = ser2.buffer();
+	verify_test((sb.second == sb2.second) && !memcmp(sb.first, sb2.first, sb.second));
+
+	// truncated stream
+	der.reset(sb.first, sb.second - 1);
+	try {
+		der & txvf;
+		verify_test(false);
+	} catch (const std::exception&) {
+	}
 }
 
 void TestTransactionKernelConsuming()
@@ -850,6 +883,36 @@ void TestBbs()
 	n = buf.size();
 
 	verify_test(!beam::proto::BbsDecrypt(p, n, privateAddr));
+
+	// failed attempt must not damage the message, so that it can be tried with other keys
+	SetRandom(privateAddr);
+	beam::PeerID publicAddr2;
+	beam::proto::Sk2Pk(publicAddr2, privateAddr);
+
+	verify_test(beam::proto::BbsEncrypt(buf, publicAddr2, nonce, szMsg, sizeof(szMsg)));
+	beam::ByteBuffer buf2 = buf;
+
+	Scalar::Native privateAddrWrong;
+	SetRandom(privateAddrWrong);
+
+	p = &buf.at(0);
+	n = buf.size();
+	verify_test(!beam::proto::BbsCheck(p, n, privateAddrWrong));
+	verify_test(!beam::proto::BbsDecrypt(p, n, privateAddrWrong));
+	verify_test(buf == buf2);
+
+	verify_test(beam::proto::BbsCheck(p, n, privateAddr));
+	verify_test(buf == buf2);
+
+	// tampered payload
+	buf.back() ^= 1;
+	verify_test(!beam::proto::BbsCheck(p, n, privateAddr));
+	verify_test(!beam::proto::BbsDecrypt(p, n, privateAddr));
+	buf.back() ^= 1;
+
+	verify_test(beam::proto::BbsDecrypt(p, n, privateAddr));
+	verify_test(n == sizeof(szMsg));
+	verify_test(!memcmp(p, szMsg, n));
 }
 
 void TestDifficulty()
@@ -1028,6 +1091,27 @@ struct BenchmarkMeter
 	}
 };
 
+uintBig TraverseBody(beam::TxBase::IReader&& r)
+{
+	uintBig x = Zero;
+	r.Reset();
+
+	for (; r.m_pUtxoIn; r.NextUtxoIn())
+		x ^= r.m_pUtxoIn->m_Commitment.m_X;
+
+	for (; r.m_pUtxoOut; r.NextUtxoOut())
+	{
+		x ^= r.m_pUtxoOut->m_Commitment.m_X;
+		if (r.m_pUtxoOut->m_pConfidential)
+			x ^= r.m_pUtxoOut->m_pConfidential->m_Mu.m_Value;
+	}
+
+	for (; r.m_pKernelOut; r.NextKernelOut())
+		x ^= r.m_pKernelOut->m_Excess.m_X;
+
+	return x;
+}
+
 void RunBenchmark()
 {
 	Scalar::Native k1, k2;
@@ -1367,6 +1451,95 @@ void RunBenchmark()
 		} while (bm.ShouldContinue());
 	}
 
+	{
+		// block body deserialization: heap-allocated vs arena-backed
+		beam::Block::Body body;
+		body.ZeroInit();
+
+		beam::Output outp;
+		outp.Create(k1, v);
+
+		for (uint32_t i = 0; i < 1000; i++)
+		{
+			body.m_vInputs.emplace_back(new beam::Input);
+			body.m_vInputs.back()->m_Commitment.m_X = i;
+			body.m_vInputs.back()->m_Commitment.m_Y = false;
+
+			body.m_vOutputs.emplace_back(new beam::Output);
+			*body.m_vOutputs.back() = outp;
+			body.m_vOutputs.back()->m_Commitment.m_X = i;
+
+			body.m_vKernelsOutput.emplace_back(new beam::TxKernel);
+			body.m_vKernelsOutput.back()->m_Excess.m_X = i;
+			body.m_vKernelsOutput.back()->m_Excess.m_Y = false;
+		}
+
+		beam::Serializer ser;
+		ser & body;
+		beam::SerializeBuffer sb = ser.buffer();
+
+		beam::Deserializer der;
+
+		{
+			BenchmarkMeter bm("Body.Deserialize");
+			bm.N = 10;
+			do
+			{
+				for (uint32_t i = 0; i < bm.N; i++)
+				{
+					beam::Block::Body b2;
+					der.reset(sb.first, sb.second);
+					der & b2;
+				}
+
+			} while (bm.ShouldContinue());
+		}
+
+		{
+			BenchmarkMeter bm("Body.Deserialize.Flat");
+			bm.N = 10;
+			do
+			{
+				for (uint32_t i = 0; i < bm.N; i++)
+				{
+					beam::Block::BodyFlat b2;
+					der.reset(sb.first, sb.second);
+					der & b2;
+				}
+
+			} while (bm.ShouldContinue());
+		}
+
+		beam::Block::Body b2;
+		der.reset(sb.first, sb.second);
+		der & b2;
+
+		beam::Block::BodyFlat b3;
+		der.reset(sb.first, sb.second);
+		der & b3;
+
+		// traverse all the elements via IReader (the validation itself is dominated by the range proofs, which is the same for both)
+		{
+			BenchmarkMeter bm("Body.Traverse");
+			do
+			{
+				for (uint32_t i = 0; i < bm.N; i++)
+					TraverseBody(b2.get_Reader());
+
+			} while (bm.ShouldContinue());
+		}
+
+		{
+			BenchmarkMeter bm("Body.Traverse.Flat");
+			do
+			{
+				for (uint32_t i = 0; i < bm.N; i++)
+					TraverseBody(b3.get_Reader());
+
+			} while (bm.ShouldContinue());
+		}
+	}
+
 	{
 		AES::Encoder enc;
 		enc.Init(hv.m_pData);
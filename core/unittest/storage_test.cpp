@@ -15,7 +15,10 @@
 #include <iostream>
 #include "../radixtree.h"
 #include "../navigator.h"
+#include "../iblt.h"
+#include "../block_crypt.h"
 #include "../../utility/serialize.h"
+#include "../serialization_adapters.h"
 
 #ifndef WIN32
 #	include <unistd.h>
@@ -362,6 +365,81 @@ namespace beam
 		t2.m_pBound[0] = t2.m_Min.m_pArr;
 		t2.m_pBound[1] = t2.m_Max.m_pArr;
 		t.Traverse(t2);
+
+		// sorted insertion
+		std::vector<uint32_t> vIdx(vKeys.size());
+		for (uint32_t i = 0; i < vIdx.size(); i++)
+			vIdx[i] = i;
+
+		std::sort(vIdx.begin(), vIdx.end(), [&vKeys](uint32_t a, uint32_t b) { return vKeys[a] < vKeys[b]; });
+
+		UtxoTree t3;
+		UtxoTree::Cursor cu3;
+
+		for (uint32_t i = 0; i < vIdx.size(); i++)
+		{
+			bool bCreate = true;
+			UtxoTree::MyLeaf* p = t3.Append(cu3, vKeys[vIdx[i]], bCreate);
+
+			verify_test(p && bCreate);
+			p->m_Value.m_Count = vIdx[i];
+
+			bCreate = true;
+			verify_test(t3.Append(cu3, vKeys[vIdx[i]], bCreate) == p); // duplicate
+			verify_test(!bCreate);
+
+			if (!(i % 23))
+				t3.get_Hash(hv2); // try to confuse clean/dirty
+		}
+
+		t3.get_Hash(hv2);
+		verify_test(hv2 == hv1);
+
+		try {
+			bool bCreate = true;
+			t3.Append(cu3, vKeys[vIdx[0]], bCreate);
+			verify_test(false); // less than the max key
+		} catch (const std::exception&) {
+		}
+
+		// bulk construction
+		std::vector<UtxoTree::Entry> vEntries(vIdx.size());
+		for (uint32_t i = 0; i < vIdx.size(); i++)
+		{
+			vEntries[i].m_Key = vKeys[vIdx[i]];
+			vEntries[i].m_Value.m_Count = vIdx[i];
+		}
+
+		for (uint32_t nThreads = 1; nThreads <= 4; nThreads <<= 1)
+		{
+			UtxoTree t4;
+			t4.BuildSorted(&vEntries.front(), vEntries.size(), nThreads);
+			t4.get_Hash(hv2);
+			verify_test(hv2 == hv1);
+
+			// must be a valid tree
+			UtxoTree::Cursor cu4;
+			bool bCreate = false;
+			UtxoTree::MyLeaf* p = t4.Find(cu4, vKeys[0], bCreate);
+			verify_test(p && (p->m_Value.m_Count == 0));
+			t4.Delete(cu4);
+
+			bCreate = true;
+			t4.Find(cu4, vKeys[0], bCreate)->m_Value.m_Count = 0;
+			verify_test(bCreate);
+
+			t4.get_Hash(hv2);
+			verify_test(hv2 == hv1);
+		}
+
+		std::swap(vEntries[0], vEntries[1]);
+
+		UtxoTree t5;
+		try {
+			t5.BuildSorted(&vEntries.front(), vEntries.size());
+			verify_test(false); // unsorted keys must be rejected
+		} catch (const std::exception&) {
+		}
 	}
 
 	struct MyMmr
@@ -559,6 +637,212 @@ namespace beam
 		}
 	}
 
+	void TestIblt()
+	{
+		const uint32_t nCommon = 10000, nOnly1 = 40, nOnly2 = 30;
+
+		std::vector<Iblt::Key> vKeys;
+		for (uint32_t i = 0; i < nCommon + nOnly1 + nOnly2; i++)
+		{
+			Iblt::Key key;
+			ECC::Hash::Processor() << i >> key;
+			vKeys.push_back(key);
+		}
+
+		for (uint32_t nCellsPerHash = 8; nCellsPerHash <= 64; nCellsPerHash <<= 1)
+		{
+			Iblt t1, t2;
+			t1.Reset(nCellsPerHash);
+			t2.Reset(nCellsPerHash);
+
+			for (uint32_t i = 0; i < nCommon + nOnly1; i++)
+				t1.Add(vKeys[i]);
+
+			for (uint32_t i = 0; i < nCommon; i++)
+				t2.Add(vKeys[i]);
+			for (uint32_t i = 0; i < nOnly2; i++)
+				t2.Add(vKeys[nCommon + nOnly1 + i]);
+
+			// transfer
+			Serializer ser;
+			ser & t2.m_vCells;
+
+			Iblt t3;
+			Deserializer der;
+			der.reset(ser.buffer().first, ser.buffer().second);
+			der & t3.m_vCells;
+			verify_test(t3.IsValid());
+
+			t1.Subtract(t3);
+
+			std::vector<Iblt::Key> vPos, vNeg;
+			bool bDecoded = t1.Decode(vPos, vNeg);
+
+			if (nCellsPerHash < (nOnly1 + nOnly2) / Iblt::s_Hashes)
+				verify_test(!bDecoded); // too small for the difference
+			if (nCellsPerHash == 64)
+				verify_test(bDecoded); // load below 0.4, should practically always succeed
+
+			if (!bDecoded)
+				continue;
+
+			verify_test(vPos.size() == nOnly1);
+			verify_test(vNeg.size() == nOnly2);
+
+			std::sort(vPos.begin(), vPos.end());
+			std::sort(vNeg.begin(), vNeg.end());
+
+			for (uint32_t i = 0; i < nOnly1; i++)
+				verify_test(std::binary_search(vPos.begin(), vPos.end(), vKeys[nCommon + i]));
+			for (uint32_t i = 0; i < nOnly2; i++)
+				verify_test(std::binary_search(vNeg.begin(), vNeg.end(), vKeys[nCommon + nOnly1 + i]));
+		}
+	}
+
+	template <typename T>
+	bool IsSameSerialized(const T& a, const T& b)
+	{
+		Serializer ser1, ser2;
+		ser1 & a;
+		ser2 & b;
+
+		SerializeBuffer sb1 = ser1.buffer(), sb2 = ser2.buffer();
+		return (sb1.second == sb2.second) && !memcmp(sb1.first, sb2.first, sb1.second);
+	}
+
+	void SetBodyRWVersion(const Block::BodyBase::RW& rw, uint8_t nVersion)
+	{
+		std::string pArr[Block::BodyBase::RW::s_Datas];
+		rw.GetPathes(pArr);
+
+		FILE* pFile = fopen(pArr[0].c_str(), "r+b");
+		verify_test(pFile);
+		if (pFile)
+		{
+			fseek(pFile, 3, SEEK_SET); // the version byte of the signature
+			fwrite(&nVersion, 1, 1, pFile);
+			fclose(pFile);
+		}
+	}
+
+	void TestBodyRW()
+	{
+		TxVectors txv;
+
+		// elements sorted by their X, some share a long prefix with the previous one, some are equal to it
+		for (uint32_t i = 0; i < 20; i++)
+		{
+			Input::Ptr pInp(new Input);
+			ECC::Hash::Processor() << (i / 3) >> pInp->m_Commitment.m_X;
+			pInp->m_Commitment.m_X.m_pData[ECC::uintBig::nBytes - 1] = (uint8_t) (i % 3 ? i : 0);
+			pInp->m_Commitment.m_Y = (i & 1) != 0;
+			txv.m_vInputs.push_back(std::move(pInp));
+		}
+
+		for (uint32_t i = 0; i < 5; i++)
+		{
+			ECC::Scalar::Native sk;
+			sk = i + 1;
+
+			Output::Ptr pOut(new Output);
+			pOut->m_Coinbase = !i;
+			pOut->m_Incubation = i;
+			pOut->Create(sk, 100 * (i + 1), !i);
+			txv.m_vOutputs.push_back(std::move(pOut));
+		}
+
+		for (uint32_t i = 0; i < 7; i++)
+		{
+			TxKernel::Ptr pKrn(new TxKernel);
+			ECC::Hash::Processor() << i >> pKrn->m_Excess.m_X;
+			pKrn->m_Fee = i;
+			pKrn->m_Height.m_Min = i;
+			txv.m_vKernelsOutput.push_back(std::move(pKrn));
+		}
+
+		txv.Sort();
+
+		Block::BodyBase body;
+		body.ZeroInit();
+		body.m_Subsidy.Lo = 2500;
+		body.m_Offset.m_Value = 11U;
+
+		Block::SystemState::Sequence::Prefix prefix;
+		ZeroObject(prefix);
+		prefix.m_Height = 10;
+		ECC::Hash::Processor() << "prev" >> prefix.m_Prev;
+
+		std::vector<Block::SystemState::Sequence::Element> vElem(3);
+		for (uint32_t i = 0; i < vElem.size(); i++)
+		{
+			ZeroObject(vElem[i]);
+			ECC::Hash::Processor() << i >> vElem[i].m_Definition;
+			vElem[i].m_TimeStamp = 1000 + i;
+		}
+
+		Block::BodyBase::RW rw;
+#ifdef WIN32
+		rw.m_sPath = "mytest_rw_";
+#else // WIN32
+		rw.m_sPath = "/tmp/mytest_rw_";
+#endif // WIN32
+		rw.m_bAutoDelete = true;
+
+		verify_test(rw.Open(false));
+		rw.put_Start(body, prefix);
+		for (uint32_t i = 0; i < vElem.size(); i++)
+			rw.put_NextHdr(vElem[i]);
+		rw.Dump(txv.get_Reader());
+		rw.Close();
+
+		// read back
+		verify_test(rw.Open(true));
+		rw.Reset();
+
+		Block::BodyBase body2;
+		Block::SystemState::Sequence::Prefix prefix2;
+		rw.get_Start(body2, prefix2);
+		verify_test(IsSameSerialized(body, body2));
+		verify_test(IsSameSerialized(prefix, prefix2));
+
+		Block::SystemState::Sequence::Element elem;
+		for (uint32_t i = 0; i < vElem.size(); i++)
+		{
+			verify_test(rw.get_NextHdr(elem));
+			verify_test(IsSameSerialized(vElem[i], elem));
+		}
+		verify_test(!rw.get_NextHdr(elem));
+
+		for (size_t i = 0; i < txv.m_vInputs.size(); i++, rw.NextUtxoIn())
+			verify_test(rw.m_pUtxoIn && IsSameSerialized(*txv.m_vInputs[i], *rw.m_pUtxoIn));
+		verify_test(!rw.m_pUtxoIn);
+
+		for (size_t i = 0; i < txv.m_vOutputs.size(); i++, rw.NextUtxoOut())
+			verify_test(rw.m_pUtxoOut && IsSameSerialized(*txv.m_vOutputs[i], *rw.m_pUtxoOut));
+		verify_test(!rw.m_pUtxoOut);
+
+		verify_test(!rw.m_pKernelIn);
+
+		for (size_t i = 0; i < txv.m_vKernelsOutput.size(); i++, rw.NextKernelOut())
+			verify_test(rw.m_pKernelOut && IsSameSerialized(*txv.m_vKernelsOutput[i], *rw.m_pKernelOut));
+		verify_test(!rw.m_pKernelOut);
+
+		rw.Close();
+
+		// other format versions are rejected, the data is treated as missing
+		SetBodyRWVersion(rw, Block::BodyBase::RW::s_Version - 1);
+		verify_test(!rw.Open(true));
+		rw.Close();
+
+		SetBodyRWVersion(rw, Block::BodyBase::RW::s_Version + 1);
+		verify_test(!rw.Open(true));
+		rw.Close();
+
+		SetBodyRWVersion(rw, Block::BodyBase::RW::s_Version);
+		verify_test(rw.Open(true));
+		rw.Close();
+	}
+
 } // namespace beam
 
 int main()
@@ -566,6 +850,8 @@ int main()
 	beam::TestNavigator();
 	beam::TestUtxoTree();
 	beam::TestMmr();
+	beam::TestIblt();
+	beam::TestBodyRW();
 
 	return g_TestsFailed ? -1 : 0;
 }
@@ -55,6 +55,14 @@ public:
     /// Shutdowns write side, waits for pending write requests to complete, but on reactor's side
     void shutdown();
 
+    /// Bytes written but not sent yet
+    size_t unsent() const { return _stream->state().unsent; }
+
+    /// Sets the callback invoked whenever some data is sent and no more than the threshold is left unsent
+    void set_drain_callback(size_t threshold, io::TcpStream::DrainCallback&& callback) {
+        _stream->set_drain_callback(threshold, std::move(callback));
+    }
+
     /// Returns socket address (non-null if connected)
     io::Address address() const;
 
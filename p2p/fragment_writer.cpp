@@ -46,7 +46,7 @@ void* FragmentWriter::write(const void *ptr, size_t size) {
         where = 0;
     }
     while (sz > 0) {
-        new_fragment();
+        new_fragment(_fragmentSize);
         size_t n = _remaining < sz ? _remaining : sz;
         memcpy(_cursor, p, n);
         p += n;
@@ -58,6 +58,12 @@ void* FragmentWriter::write(const void *ptr, size_t size) {
     return where;
 }
 
+void FragmentWriter::reserve(size_t size) {
+    if (size > _remaining) {
+        new_fragment(size > _fragmentSize ? size : _fragmentSize);
+    }
+}
+
 void FragmentWriter::finalize() {
     call();
     _msgBase = _cursor;
@@ -69,11 +75,11 @@ void FragmentWriter::call() {
     }
 }
 
-void FragmentWriter::new_fragment() {
+void FragmentWriter::new_fragment(size_t size) {
     call();
-    _fragment.reset(malloc(_fragmentSize), [](void* p) { free(p); });
+    _fragment.reset(malloc(size), [](void* p) { free(p); });
     _msgBase = _cursor = (char*)_fragment.get();
-    _remaining = _fragmentSize;
+    _remaining = size;
 }
 
 } //namespace
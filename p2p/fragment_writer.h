@@ -32,6 +32,9 @@ public:
     /// Writes new data into fragments. Invokes callback if current fragment gets full
     void* write(const void *ptr, size_t size);
 
+    /// Makes sure the next size bytes are written into a single fragment, allocates a bigger one if needed
+    void reserve(size_t size);
+
     /// Finalizes current message: invokes callback
     void finalize();
 
@@ -40,7 +43,7 @@ private:
     void call();
 
     /// Creates a new fragment
-    void new_fragment();
+    void new_fragment(size_t size);
 
     /// Fixed fragment size in bytes
     const size_t _fragmentSize;
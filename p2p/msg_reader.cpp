@@ -68,26 +68,103 @@ void MsgReader::disable_all_msg_types() {
     _expectedMsgTypes.reset();
 }
 
+void MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, void* data, size_t size) {
+    process(connectionStatus, (uint8_t*)data, size, true);
+}
+
 void MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, const void* data, size_t size) {
+    // the data is only read in this mode
+    process(connectionStatus, (uint8_t*)data, size, false);
+}
+
+bool MsgReader::on_header(const MsgHeader& header, volatile const bool& bAlive) {
+    if (!_protocol.approve_msg_header(_streamId, header))
+        // at this moment, the *this* may be deleted
+        return false;
+
+    if (!bAlive)
+        return false;
+
+    if (!_expectedMsgTypes.test(header.type)) {
+        _protocol.on_unexpected_msg(_streamId, header.type);
+        // at this moment, the *this* may be deleted
+        return false;
+    }
+
+    return bAlive;
+}
+
+bool MsgReader::on_message(const MsgHeader& header, const uint8_t* p, volatile const bool& bAlive) {
+    // whole message, including the header
+    if (!_protocol.VerifyMsg(p, (uint32_t) (MsgHeader::SIZE + header.size)))
+    {
+        _protocol.on_corrupt_msg(_streamId);
+        return false;
+    }
+
+    if (!_protocol.on_new_message(_streamId, header.type, p + MsgHeader::SIZE, header.size - _protocol.get_MacSize())) {
+        // at this moment, the *this* may be deleted
+        if (bAlive) {
+            reset();
+        }
+        return false;
+    }
+
+    return bAlive;
+}
+
+void MsgReader::process(io::ErrorCode connectionStatus, uint8_t* p, size_t sz, bool bInPlace) {
     if (connectionStatus != 0) {
         _protocol.on_connection_error(_streamId, connectionStatus);
         return;
     }
 
-    if (!data || !size) {
+    if (!p || !sz) {
         return;
     }
 
 	std::shared_ptr<bool> pAlive(_pAlive);
 	volatile const bool& bAlive = *pAlive;
 
-    const uint8_t* p = (const uint8_t*)data;
-    size_t sz = size;
-
 	while (sz >= _bytesLeft)
 	{
+		if (bInPlace && (_state == reading_header) && (_cursor == _msgBuffer.data()))
+		{
+			// the whole header is in the buffer. Decrypt it in-place, and the message too if it's there
+			_protocol.Decrypt(p, MsgHeader::SIZE);
+			MsgHeader header(p);
+
+			if (!on_header(header, bAlive))
+				return;
+
+			size_t nMsgSize = MsgHeader::SIZE + header.size;
+			if (sz >= nMsgSize)
+			{
+				_protocol.Decrypt(p + MsgHeader::SIZE, (uint32_t) header.size);
+				_stats.inPlace += nMsgSize;
+
+				if (!on_message(header, p, bAlive))
+					return;
+
+				sz -= nMsgSize;
+				p += nMsgSize;
+				continue;
+			}
+
+			// split across reads, fall back to the accumulation
+			memcpy(_msgBuffer.data(), p, MsgHeader::SIZE);
+			_stats.copied += MsgHeader::SIZE;
+
+			sz -= MsgHeader::SIZE;
+			p += MsgHeader::SIZE;
+
+			begin_message(header);
+			continue;
+		}
+
 		memcpy(_cursor, p, _bytesLeft);
 		_protocol.Decrypt(_cursor, (uint32_t) _bytesLeft); // decrypt as much as we expect, no more (because cipher may change)
+		_stats.copied += _bytesLeft;
 
 		sz -= _bytesLeft;
 		p += _bytesLeft;
@@ -97,48 +174,15 @@ void MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, const void*
 		if (_state == reading_header)
 		{
 			// header has just been read
-			if (!_protocol.approve_msg_header(_streamId, header))
-				// at this moment, the *this* may be deleted
-				return;
-
-			if (!bAlive)
-				return;
-
-			if (!_expectedMsgTypes.test(header.type)) {
-				_protocol.on_unexpected_msg(_streamId, header.type);
-				// at this moment, the *this* may be deleted
-				return;
-			}
-
-			if (!bAlive)
+			if (!on_header(header, bAlive))
 				return;
 
 			// header deserialized successfully
-			_bytesLeft = header.size;
-			_msgBuffer.resize(MsgHeader::SIZE + _bytesLeft);
-			_cursor = _msgBuffer.data() + MsgHeader::SIZE;
-
-			_state = reading_message;
-
+			begin_message(header);
 		}
 		else
 		{
-			// whole message has been read
-			if (!_protocol.VerifyMsg(_msgBuffer.data(), _msgBuffer.size()))
-			{
-				_protocol.on_corrupt_msg(_streamId);
-				return;
-			}
-
-            if (!_protocol.on_new_message(_streamId, header.type, _msgBuffer.data() + MsgHeader::SIZE, header.size - _protocol.get_MacSize())) {
-                // at this moment, the *this* may be deleted
-                if (bAlive) {
-                    reset();
-                }
-                return;
-            }
-
-			if (!bAlive)
+			if (!on_message(header, _msgBuffer.data(), bAlive))
 				return;
 
 			if (_msgBuffer.size() > 2 * _defaultSize) {
@@ -160,11 +204,20 @@ void MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, const void*
 	{
 		memcpy(_cursor, p, sz);
 		_protocol.Decrypt(_cursor, (uint32_t) sz);
+		_stats.copied += sz;
 
 		_cursor += sz;
 		_bytesLeft -= sz;
 	}
 }
 
+void MsgReader::begin_message(const MsgHeader& header) {
+    _bytesLeft = header.size;
+    _msgBuffer.resize(MsgHeader::SIZE + _bytesLeft);
+    _cursor = _msgBuffer.data() + MsgHeader::SIZE;
+
+    _state = reading_message;
+}
+
 
 } //namespace
@@ -30,9 +30,20 @@ public:
     void change_id(uint64_t newStreamId);
 
     /// Called from the stream on new data.
-    /// Calls the callback whenever a new protocol message is exctracted or on errors
+    /// Calls the callback whenever a new protocol message is exctracted or on errors.
+    /// The data may be modified: messages that are whole in it are decrypted and deserialized in-place
+    void new_data_from_stream(io::ErrorCode connectionStatus, void* data, size_t size);
+
+    /// Same for read-only data, everything is copied into the message buffer
     void new_data_from_stream(io::ErrorCode connectionStatus, const void* data, size_t size);
 
+    struct Stats {
+        uint64_t copied=0; // bytes accumulated in the message buffer
+        uint64_t inPlace=0; // bytes of messages processed directly in the stream data
+    };
+
+    const Stats& stats() const { return _stats; }
+
     /// Allows receiving messages of given type
     void enable_msg_type(MsgType type);
 
@@ -52,6 +63,11 @@ private:
     /// 2 states of the reader
     enum State { reading_header, reading_message };
 
+    void process(io::ErrorCode connectionStatus, uint8_t* p, size_t sz, bool bInPlace);
+    bool on_header(const MsgHeader& header, volatile const bool& bAlive);
+    bool on_message(const MsgHeader& header, const uint8_t* p, volatile const bool& bAlive);
+    void begin_message(const MsgHeader& header);
+
     /// Callbacks
     ProtocolBase& _protocol;
 
@@ -77,6 +93,8 @@ private:
     std::bitset<256> _expectedMsgTypes;
 
 	std::shared_ptr<bool> _pAlive;
+
+    Stats _stats;
 };
 
 } //namespace
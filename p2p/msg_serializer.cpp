@@ -29,8 +29,9 @@ MsgSerializeOstream::MsgSerializeOstream(size_t fragmentSize, MsgHeader defaultH
     _currentHeader(defaultHeader)
 {}
 
-void MsgSerializeOstream::new_message(MsgType type) {
+void MsgSerializeOstream::new_message(MsgType type, size_t sizeHint) {
     assert(_currentMsgSize == 0 && _currentHeaderPtr == 0);
+    if (sizeHint) _writer.reserve(MsgHeader::SIZE + sizeHint);
     _currentHeader.type = type;
     _currentHeaderPtr = _writer.write(&_currentHeader, MsgHeader::SIZE);
 }
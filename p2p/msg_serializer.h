@@ -27,7 +27,7 @@ public:
     explicit MsgSerializeOstream(size_t fragmentSize, MsgHeader defaultHeader);
 
     /// Called by msg serializer on new message
-    void new_message(MsgType type);
+    void new_message(MsgType type, size_t sizeHint);
 
     /// Called by yas serializeron new data
     size_t write(const void *ptr, size_t size);
@@ -63,9 +63,9 @@ public:
         _oa(_os)
     {}
 
-    /// Begins a new message
-    void new_message(MsgType type) {
-        _os.new_message(type);
+    /// Begins a new message. If the size (w/o header) is known in advance the message is written into a single fragment
+    void new_message(MsgType type, size_t sizeHint=0) {
+        _os.new_message(type, sizeHint);
     }
 
     /// Serializes whatever in message
@@ -99,8 +99,8 @@ public:
         _ser.finalize(out);
     }
 
-	template <typename MsgObject> MsgSerializer& serializeNoFinalize(SerializedMsg& out, MsgType type, const MsgObject& obj) {
-		_ser.new_message(type);
+	template <typename MsgObject> MsgSerializer& serializeNoFinalize(SerializedMsg& out, MsgType type, const MsgObject& obj, size_t sizeHint=0) {
+		_ser.new_message(type, sizeHint);
 		_ser & obj;
 		return _ser;
 	}
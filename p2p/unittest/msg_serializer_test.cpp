@@ -16,7 +16,9 @@
 #include "p2p/msg_reader.h"
 #include "p2p/protocol.h"
 #include "utility/helpers.h"
+#include "utility/test_helpers.h"
 #include <iostream>
+#include <chrono>
 #include <assert.h>
 
 using namespace beam;
@@ -181,10 +183,137 @@ void msg_serializer_test_2() {
     }
 
     assert(msg == handler.receivedObj);
+    assert(reader.stats().inPlace == 0);
+
+    // writable data: 2 whole messages are processed in-place, the 3rd one is split and accumulated
+    std::vector<uint8_t> data;
+    for (int i=0; i<3; ++i) {
+        for (const auto& f: fragments) {
+            data.insert(data.end(), f.data, f.data + f.size);
+        }
+    }
+    size_t msgSize = data.size() / 3;
+    size_t splitAt = msgSize * 2 + msgSize / 2;
+
+    handler.receivedObj = SomeObject();
+    reader.new_data_from_stream(io::EC_OK, (void*) data.data(), splitAt);
+    assert(msg == handler.receivedObj);
+    assert(reader.stats().inPlace == msgSize * 2);
+
+    handler.receivedObj = SomeObject();
+    reader.new_data_from_stream(io::EC_OK, (void*) (data.data() + splitAt), data.size() - splitAt);
+    assert(msg == handler.receivedObj);
+    assert(reader.stats().inPlace == msgSize * 2);
+    assert(reader.stats().copied == msgSize * 2);
 }
 
-int main() {
+// Like block body: the size is obtained w/o traversing the data
+struct BlobObject {
+    int i=0;
+    std::vector<uint8_t> blob;
+
+    SERIALIZE(i,blob);
+};
+
+int size_hint_test() {
+    MsgType type = 33;
+    int nErrors = 0;
+
+    BlobObject msg;
+    msg.i = 5;
+    msg.blob.resize(1024*1024);
+    for (size_t i=0; i<msg.blob.size(); ++i) msg.blob[i] = uint8_t(i * 7919);
+
+    size_t size = get_serialized_size(msg);
+
+    MsgSerializer ser(4096, MsgHeader(0xAA, 0xBB, 0xCC));
+    std::vector<io::SharedBuffer> fragments, fragmentsHinted;
+
+    ser.new_message(type);
+    ser & msg;
+    ser.finalize(fragments);
+
+    ser.new_message(type, size);
+    ser & msg;
+    ser.finalize(fragmentsHinted);
+
+    io::SharedBuffer whole = io::normalize(fragments, false);
+    if (fragmentsHinted.size() != 1 || whole.size != MsgHeader::SIZE + size ||
+        fragmentsHinted[0].size != whole.size || memcmp(fragmentsHinted[0].data, whole.data, whole.size) != 0)
+    {
+        cout << "size hint: " << fragmentsHinted.size() << " fragments, " << fragments.size() << " w/o hint" << endl;
+        ++nErrors;
+    }
+
+    // the same with the reserved buffer
+    Serializer s, sHinted;
+    s & msg;
+    sHinted.reserve(size);
+    sHinted & msg;
+    auto buf = s.buffer();
+    auto bufHinted = sHinted.buffer();
+    if (bufHinted.second != size || buf.second != size || memcmp(buf.first, bufHinted.first, size) != 0) {
+        cout << "reserved buffer: " << bufHinted.second << " bytes, " << buf.second << " w/o reserve" << endl;
+        ++nErrors;
+    }
+
+    return nErrors;
+}
+
+// Opt-in: encode throughput of a big object, with and w/o the size pre-computed
+void size_hint_benchmark() {
+    MsgType type = 33;
+
+    BlobObject msg;
+    msg.i = 5;
+    msg.blob.resize(1024*1024);
+    for (size_t i=0; i<msg.blob.size(); ++i) msg.blob[i] = uint8_t(i * 7919);
+
+    size_t size = get_serialized_size(msg);
+
+    MsgSerializer ser(4096, MsgHeader(0xAA, 0xBB, 0xCC));
+    std::vector<io::SharedBuffer> fragments;
+
+    static const int N = 200;
+    using Clock = std::chrono::steady_clock;
+
+    auto run = [&](const char* name, auto&& fn) {
+        auto start = Clock::now();
+        for (int i=0; i<N; ++i) fn();
+        double sec = std::chrono::duration<double>(Clock::now() - start).count();
+        cout << name << ": " << uint64_t(N * size / (sec * 1024 * 1024 + 1e-9)) << " MB/sec" << endl;
+    };
+
+    run("fragments", [&] {
+        ser.new_message(type);
+        ser & msg;
+        ser.finalize(fragments);
+    });
+    run("fragments, size hint", [&] {
+        ser.new_message(type, get_serialized_size(msg));
+        ser & msg;
+        ser.finalize(fragments);
+    });
+    run("buffer", [&] {
+        Serializer s;
+        s & msg;
+    });
+    run("buffer, size hint", [&] {
+        Serializer s;
+        s.reserve(get_serialized_size(msg));
+        s & msg;
+    });
+}
+
+int main(int argc, char* argv[]) {
     fragment_writer_test();
     msg_serializer_test_1();
     msg_serializer_test_2();
+    int ret = size_hint_test();
+
+    if (helpers::IsBenchmarkRequested(argc, argv)) {
+        size_hint_benchmark();
+    }
+
+    return ret;
 }
@@ -170,6 +170,7 @@ WalletModel::WalletModel(IKeyChain::Ptr keychain, IKeyStore::Ptr keystore, const
 {
     qRegisterMetaType<WalletStatus>("WalletStatus");
     qRegisterMetaType<vector<TxDescription>>("std::vector<beam::TxDescription>");
+    qRegisterMetaType<ChangeAction>("beam::ChangeAction");
     qRegisterMetaType<vector<TxPeer>>("std::vector<beam::TxPeer>");
     qRegisterMetaType<Amount>("beam::Amount");
     qRegisterMetaType<vector<Coin>>("std::vector<beam::Coin>");
@@ -296,9 +297,9 @@ void WalletModel::onKeychainChanged()
     onStatusChanged();
 }
 
-void WalletModel::onTransactionChanged()
+void WalletModel::onTransactionChanged(ChangeAction action, const std::vector<TxDescription>& items)
 {
-    emit onTxStatus(_keychain->getTxHistory());
+    emit onTxChanged(action, items);
     onStatusChanged();
 }
 
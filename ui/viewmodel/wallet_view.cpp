@@ -145,6 +145,9 @@ WalletViewModel::WalletViewModel()
     connect(&_model, SIGNAL(onTxStatus(const std::vector<beam::TxDescription>&)), 
         SLOT(onTxStatus(const std::vector<beam::TxDescription>&)));
 
+    connect(&_model, SIGNAL(onTxChanged(beam::ChangeAction, const std::vector<beam::TxDescription>&)),
+        SLOT(onTxChanged(beam::ChangeAction, const std::vector<beam::TxDescription>&)));
+
     connect(&_model, SIGNAL(onTxPeerUpdated(const std::vector<beam::TxPeer>&)),
         SLOT(onTxPeerUpdated(const std::vector<beam::TxPeer>&)));
 
@@ -284,6 +287,58 @@ void WalletViewModel::onTxStatus(const std::vector<TxDescription>& history)
     }
 }
 
+void WalletViewModel::onTxChanged(beam::ChangeAction action, const std::vector<TxDescription>& items)
+{
+    // patch the list in place, only the modified rows come
+    if (action == ChangeAction::Reset)
+    {
+        for (auto* tx : _tx)
+        {
+            tx->deleteLater();
+        }
+        _tx.clear();
+        emit txChanged();
+        return;
+    }
+
+    bool added = false;
+    for (const auto& item : items)
+    {
+        auto it = std::find_if(_tx.begin(), _tx.end(), [&item](const auto* tx) { return tx->_tx.m_txId == item.m_txId; });
+        if (action == ChangeAction::Removed)
+        {
+            if (it != _tx.end())
+            {
+                (*it)->deleteLater();
+                _tx.erase(it);
+            }
+            continue;
+        }
+
+        auto* tx = new TxObject(item);
+        if (it != _tx.end())
+        {
+            tx->setUserName((*it)->userName());
+            tx->setDisplayName((*it)->displayName());
+            (*it)->deleteLater(); // QML may still hold it until the list is re-read
+            *it = tx;
+            continue;
+        }
+
+        // the newest first
+        auto pos = std::find_if(_tx.begin(), _tx.end(), [&item](const auto* tx) { return tx->_tx.m_createTime < item.m_createTime; });
+        _tx.insert(pos, tx);
+        added = true;
+    }
+
+    emit txChanged();
+
+    if (added && _model.async)
+    {
+        _model.async->getAddresses(false);
+    }
+}
+
 void WalletViewModel::onTxPeerUpdated(const std::vector<beam::TxPeer>& peers)
 {
     _addrList = peers;
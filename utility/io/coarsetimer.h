@@ -13,14 +13,12 @@
 // limitations under the License.
 
 #pragma once
-#include "timer.h"
-#include <map>
-#include <vector>
-#include <limits>
+#include "timerwheel.h"
+#include <unordered_map>
 
 namespace beam { namespace io {
     
-/// Coarse timer helper, for connect/reconnect timers
+/// Coarse timer helper, for connect/reconnect timers. Timeouts are set on the reactor's timer wheel
 class CoarseTimer {
 public:
     using ID = uint64_t;
@@ -42,16 +40,19 @@ public:
     ~CoarseTimer();
                 
 private:
-    CoarseTimer(unsigned resolutionMsec, const Callback& cb, Timer::Ptr&& timer);
+    struct Entry : TimerWheel::Entry {
+        CoarseTimer* owner=0;
+        ID id=0;
+
+        void on_timer() override;
+    };
+
+    CoarseTimer(unsigned resolutionMsec, const Callback& cb, TimerWheel& wheel);
     
     /// Internal callback
-    void on_timer();
+    void on_timer(ID id);
     
-    /// abs. time
-    using Clock = uint64_t;
-    static constexpr Clock NEVER = std::numeric_limits<Clock>::max();
-   
-    /// Flag that prevents from updating timer too often
+    /// Flag that prevents from deleting this from inside the callback
     bool _insideCallback=false;
     
     /// Coarse msec resolution
@@ -60,17 +61,11 @@ private:
     /// External callback
     Callback _callback;
     
-    /// Timers queue
-    std::multimap<Clock, ID> _queue;
-    
-    /// Valid Ids
-    std::map<ID, Clock> _validIds;
+    /// Pending timeouts
+    std::unordered_map<ID, Entry> _entries;
   
-    /// Next time to wake
-    Clock _timerSetTo=NEVER;
-    
-    /// Timer object
-    Timer::Ptr _timer;
+    /// Reactor's timer wheel
+    TimerWheel& _wheel;
 };
     
 }} //namespaces
@@ -16,6 +16,7 @@
 #include <vector>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 namespace beam { namespace io {
 
@@ -60,5 +61,88 @@ private:
     size_t _maxSize;
 };
 
+/// Data buffers of size classes (powers of 2, the largest one is capped by the max size).
+/// Released buffers are cached for reuse, up to maxCached per class
+class BufferPool {
+public:
+    static const size_t MIN_SIZE = 4096;
+
+    BufferPool(size_t maxSize, size_t maxCached) :
+        _maxSize(maxSize),
+        _maxCached(maxCached)
+    {
+        _classes.resize(class_idx(maxSize) + 1);
+    }
+
+    ~BufferPool() {
+        for (const Class& c : _classes) {
+            for (char* p : c) {
+                free(p);
+            }
+        }
+    }
+
+    /// Rounds the size up to its class
+    size_t class_size(size_t size) const {
+        size_t s = MIN_SIZE;
+        while ((s < size) && (s < _maxSize)) s <<= 1;
+        return (s < _maxSize) ? s : _maxSize;
+    }
+
+    /// Size must be a class size. Returns 0 if out of memory
+    char* alloc(size_t size) {
+        Class& c = _classes[class_idx(size)];
+        char* p = 0;
+        if (!c.empty()) {
+            p = c.back();
+            c.pop_back();
+            _cached -= size;
+        } else {
+            p = (char*)malloc(size);
+            if (!p) return 0;
+            _allocated += size;
+        }
+        _inUse += size;
+        return p;
+    }
+
+    void release(char* p, size_t size) {
+        _inUse -= size;
+        Class& c = _classes[class_idx(size)];
+        if (c.size() < _maxCached) {
+            c.push_back(p);
+            _cached += size;
+        } else {
+            free(p);
+            _allocated -= size;
+        }
+    }
+
+    /// Bytes allocated, including the cached buffers
+    size_t allocated() const { return _allocated; }
+
+    /// Bytes currently lent out
+    size_t in_use() const { return _inUse; }
+
+    /// Bytes kept for reuse
+    size_t cached() const { return _cached; }
+
+private:
+    using Class = std::vector<char*>;
+
+    size_t class_idx(size_t size) const {
+        size_t i = 0;
+        for (size_t s = MIN_SIZE; (s < size) && (s < _maxSize); s <<= 1) i++;
+        return i;
+    }
+
+    std::vector<Class> _classes;
+    size_t _maxSize;
+    size_t _maxCached;
+    size_t _allocated=0;
+    size_t _inUse=0;
+    size_t _cached=0;
+};
+
 }} //namespaces
 
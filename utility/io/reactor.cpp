@@ -15,6 +15,7 @@
 #include "reactor.h"
 #include "tcpstream.h"
 #include "coarsetimer.h"
+#include "timerwheel.h"
 #include "utility/config.h"
 #include "utility/helpers.h"
 #include <assert.h>
@@ -22,6 +23,8 @@
 
 #ifndef WIN32
 #	include <signal.h>
+#	include <unistd.h>
+#	include <errno.h>
 #endif // WIN32
 
 #define LOG_VERBOSE_ENABLED 1
@@ -41,7 +44,11 @@ Reactor::Reactor() :
     _handlePool(config().get_int("io.handle_pool_size", 256, 0, 65536)),
     _connectRequestsPool(config().get_int("io.connect_pool_size", 16, 0, 512)),
     _writeRequestsPool(config().get_int("io.write_pool_size", 256, 0, 65536)),
-    _shutdownRequestsPool(config().get_int("io.shutdown_pool_size", 16, 0, 512))
+    _shutdownRequestsPool(config().get_int("io.shutdown_pool_size", 16, 0, 512)),
+    _readBuffers(
+        config().get_int("io.stream_read_buffer_size", 256*1024, 2048, 1024*1024*16),
+        config().get_int("io.read_buffer_pool_size", 16, 0, 1024)
+    )
 {
     memset(&_loop,0,sizeof(uv_loop_t));
     memset(&_stopEvent, 0, sizeof(uv_async_t));
@@ -66,6 +73,8 @@ ErrorCode Reactor::initialize() {
     }
     _stopEvent.data = this;
 
+    _timerWheel = TimerWheel::create(shared_from_this());
+
     _connectTimer = CoarseTimer::create(
         shared_from_this(),
         config().get_int("io.connect_timer_resolution", 1000, 1, 60000),
@@ -88,6 +97,7 @@ Reactor::~Reactor() {
         uv_close((uv_handle_t*)&_stopEvent, 0);
 
     _connectTimer.reset();
+    _timerWheel.reset();
 
     for (auto& cr : _connectRequests) {
         uv_handle_t* h = (uv_handle_t*)(cr.second.request->handle);
@@ -250,6 +260,54 @@ ErrorCode Reactor::accept_tcpstream(Object* acceptor, Object* newConnection) {
     return errorCode;
 }
 
+ErrorCode Reactor::detach_tcpstream(Object* o, uv_os_sock_t& sock) {
+    assert(o->_handle);
+
+    uv_os_fd_t fd;
+    ErrorCode errorCode = (ErrorCode)uv_fileno(o->_handle, &fd);
+    if (errorCode != 0) {
+        return errorCode;
+    }
+
+    // the handle is closed by its loop, the duplicate is what survives it
+#ifdef WIN32
+    WSAPROTOCOL_INFOW info;
+    if (WSADuplicateSocketW((SOCKET)fd, GetCurrentProcessId(), &info)) {
+        return (ErrorCode)uv_translate_sys_error(WSAGetLastError());
+    }
+    sock = WSASocketW(FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, &info, 0, WSA_FLAG_OVERLAPPED);
+    if (INVALID_SOCKET == sock) {
+        return (ErrorCode)uv_translate_sys_error(WSAGetLastError());
+    }
+#else // WIN32
+    sock = dup(fd);
+    if (sock < 0) {
+        return (ErrorCode)uv_translate_sys_error(errno);
+    }
+#endif // WIN32
+
+    o->async_close();
+    return EC_OK;
+}
+
+ErrorCode Reactor::open_tcpstream(Object* o, uv_os_sock_t sock) {
+    ErrorCode errorCode = init_tcpstream(o);
+    if (errorCode == 0) {
+        errorCode = (ErrorCode)uv_tcp_open((uv_tcp_t*)o->_handle, sock);
+        if (errorCode == 0) {
+            return EC_OK;
+        }
+        o->async_close();
+    }
+
+#ifdef WIN32
+    closesocket(sock);
+#else // WIN32
+    ::close(sock);
+#endif // WIN32
+    return errorCode;
+}
+
 void Reactor::shutdown_tcpstream(Object* o, BufferChain&& unsent) {
     assert(o);
     uv_handle_t* h = o->_handle;
@@ -26,6 +26,7 @@ namespace beam { namespace io {
 
 class TcpStream;
 class CoarseTimer;
+class TimerWheel;
 
 class Reactor : public std::enable_shared_from_this<Reactor> {
 public:
@@ -64,6 +65,12 @@ public:
 	static Reactor& get_Current();
 	uv_loop_t& get_UvLoop() { return _loop; }
 
+    /// Read buffers shared by the reactor's streams. Each stream borrows one for a single read only
+    const BufferPool& read_buffers() const { return _readBuffers; }
+
+    /// Timeouts of this reactor's thread, see TimerWheel
+    TimerWheel& timer_wheel() { return *_timerWheel; }
+
 	class GracefulIntHandler
 	{
 		static Reactor* s_pAppReactor;
@@ -150,6 +157,8 @@ private:
     ErrorCode init_tcpserver(Object* o, Address bindAddress, uv_connection_cb cb);
     ErrorCode init_tcpstream(Object* o);
     ErrorCode accept_tcpstream(Object* acceptor, Object* newConnection);
+    ErrorCode detach_tcpstream(Object* o, uv_os_sock_t& sock);
+    ErrorCode open_tcpstream(Object* o, uv_os_sock_t sock);
     void shutdown_tcpstream(Object* o, BufferChain&& unsent);
 
     ErrorCode init_object(ErrorCode errorCode, Object* o, uv_handle_t* h);
@@ -175,10 +184,12 @@ private:
     MemPool<uv_connect_t, sizeof(uv_connect_t)> _connectRequestsPool;
     MemPool<WriteRequest, sizeof(WriteRequest)> _writeRequestsPool;
     MemPool<uv_shutdown_t, sizeof(uv_shutdown_t)> _shutdownRequestsPool;
+    BufferPool _readBuffers;
     std::unordered_map<uint64_t, ConnectContext> _connectRequests;
     std::unordered_set<uv_shutdown_t*> _shutdownRequests;
     std::unordered_map<uv_shutdown_t*, BufferChain> _unsent;
     std::unordered_set<uv_connect_t*> _cancelledConnectRequests;
+    std::unique_ptr<TimerWheel> _timerWheel;
     std::unique_ptr<CoarseTimer> _connectTimer;
     bool _creatingInternalObjects=false;
 
@@ -0,0 +1,96 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "reactorpool.h"
+#include "utility/helpers.h"
+#include <assert.h>
+
+namespace beam { namespace io {
+
+ReactorPool::Ptr ReactorPool::create(uint32_t nThreads) {
+    assert(nThreads);
+
+    if (!nThreads)
+        IO_EXCEPTION(EC_EINVAL);
+
+    Ptr pool(new ReactorPool());
+    pool->_next = 0;
+    pool->_workers.resize(nThreads);
+
+    for (uint32_t i = 0; i < nThreads; i++) {
+        std::unique_ptr<Worker>& w = pool->_workers[i];
+        w.reset(new Worker());
+
+        w->reactor = Reactor::create();
+        // the queue is attached to the reactor before its thread starts
+        w->rx.reset(new RX<Task>(w->reactor, [](Task&& task) { task(); }));
+        w->tx.reset(new TX<Task>(w->rx->get_tx()));
+    }
+
+    for (uint32_t i = 0; i < nThreads; i++) {
+        Worker& w = *pool->_workers[i];
+        w.thread = std::thread(&Worker::run, &w);
+    }
+
+    return pool;
+}
+
+void ReactorPool::Worker::run() {
+    // signals (incl. SIGPIPE on writes to closed sockets) are handled by the app thread
+    block_signals_in_this_thread();
+
+    Reactor::Scope scope(*reactor);
+    reactor->run();
+}
+
+ReactorPool::~ReactorPool() {
+    for (const auto& w : _workers) {
+        if (!w->thread.joinable())
+            continue;
+
+        // queued after the pending tasks, hence they're executed before the reactor stops
+        Reactor::Ptr reactor = w->reactor;
+        if (!w->tx->send([reactor]() { reactor->stop(); }))
+            reactor->stop();
+    }
+
+    for (const auto& w : _workers) {
+        if (w->thread.joinable())
+            w->thread.join();
+
+        // the reactor's loop runs until its handles are closed
+        w->tx.reset();
+        w->rx.reset();
+        w->reactor.reset();
+    }
+}
+
+uint32_t ReactorPool::get_next() {
+    return _next.fetch_add(1) % size();
+}
+
+uint32_t ReactorPool::find(const Reactor* reactor) const {
+    uint32_t i = 0;
+    for (; i < size(); i++)
+        if (_workers[i]->reactor.get() == reactor)
+            break;
+    return i;
+}
+
+bool ReactorPool::post(uint32_t idx, Task&& task) {
+    assert(idx < size());
+    return _workers[idx]->tx->send(std::move(task));
+}
+
+}} //namespaces
@@ -0,0 +1,67 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "reactor.h"
+#include "utility/message_queue.h"
+#include <thread>
+#include <atomic>
+#include <vector>
+
+namespace beam { namespace io {
+
+/// Set of reactors, each one runs in its own thread.
+/// Tasks posted to a reactor are executed in its thread in the order they were posted
+class ReactorPool {
+public:
+    ReactorPool(const ReactorPool&) = delete;
+    ReactorPool& operator=(const ReactorPool&) = delete;
+
+    using Ptr = std::unique_ptr<ReactorPool>;
+    using Task = std::function<void()>;
+
+    /// Creates the reactors and starts their threads. Throws on errors
+    static Ptr create(uint32_t nThreads);
+
+    /// Executes the tasks posted so far, then stops the reactors and joins the threads
+    ~ReactorPool();
+
+    uint32_t size() const { return (uint32_t) _workers.size(); }
+
+    /// Returns the next reactor index, round-robin. Can be called from any thread
+    uint32_t get_next();
+
+    /// Returns the index of the given reactor, or size() if it doesn't belong to the pool
+    uint32_t find(const Reactor*) const;
+
+    /// Posts the task to the given reactor. Can be called from any thread
+    bool post(uint32_t idx, Task&& task);
+
+private:
+    ReactorPool() = default;
+
+    struct Worker {
+        Reactor::Ptr reactor;
+        std::unique_ptr<RX<Task>> rx;
+        std::unique_ptr<TX<Task>> tx;
+        std::thread thread;
+
+        void run();
+    };
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::atomic<uint32_t> _next;
+};
+
+}} //namespaces
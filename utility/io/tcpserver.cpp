@@ -15,6 +15,10 @@
 #include "tcpserver.h"
 #include <assert.h>
 
+#ifndef WIN32
+#	include <unistd.h>
+#endif // WIN32
+
 namespace beam { namespace io {
 
 TcpServer::Ptr TcpServer::create(const Reactor::Ptr& reactor, Address bindAddress, Callback&& callback) {
@@ -38,6 +42,12 @@ TcpServer::Ptr TcpServer::create(const Reactor::Ptr& reactor, Address bindAddres
     return server;
 }
 
+TcpServer::Ptr TcpServer::create(const Reactor::Ptr& reactor, Address bindAddress, Callback&& callback, ReactorPool& pool) {
+    Ptr server = create(reactor, bindAddress, std::move(callback));
+    server->_pool = &pool;
+    return server;
+}
+
 TcpServer::TcpServer(Callback&& callback) :
     _callback(std::move(callback))
 {}
@@ -49,8 +59,39 @@ void TcpServer::on_accept(ErrorCode errorCode) {
     }
     TcpStream::Ptr stream(new TcpStream());
     errorCode = _reactor->accept_tcpstream(this, stream.get());
+    if (_pool && !errorCode) {
+        on_accept_pooled(std::move(stream));
+        return;
+    }
     _callback(std::move(stream), errorCode);
 }
 
+void TcpServer::on_accept_pooled(TcpStream::Ptr&& stream) {
+    // The socket is re-opened in the target reactor's loop
+    uv_os_sock_t sock;
+    ErrorCode errorCode = _reactor->detach_tcpstream(stream.get(), sock);
+    if (errorCode != 0) {
+        _callback(TcpStream::Ptr(), errorCode);
+        return;
+    }
+
+    Callback callback = _callback;
+    bool posted = _pool->post(_pool->get_next(), [sock, callback]() {
+        TcpStream::Ptr newStream(new TcpStream());
+        ErrorCode errorCode = Reactor::get_Current().open_tcpstream(newStream.get(), sock);
+        callback(errorCode ? TcpStream::Ptr() : std::move(newStream), errorCode);
+    });
+
+    if (!posted) {
+        // the pool is shutting down, nobody else owns the duplicate
+#ifdef WIN32
+        closesocket(sock);
+#else // WIN32
+        ::close(sock);
+#endif // WIN32
+        _callback(TcpStream::Ptr(), EC_ECANCELED);
+    }
+}
+
 }} //namespaces
 
@@ -15,6 +15,7 @@
 #pragma once
 #include "tcpstream.h"
 #include "address.h"
+#include "reactorpool.h"
 
 namespace beam { namespace io {
 
@@ -28,12 +29,19 @@ public:
     // TODO simplified API, will add more as soon as needed
     static Ptr create(const Reactor::Ptr& reactor, Address bindAddress, Callback&& callback);
 
+    // Accepted streams are distributed across the pool's reactors (round-robin).
+    // The callback is invoked in the thread of the reactor the new stream is attached to.
+    // The pool must outlive the server
+    static Ptr create(const Reactor::Ptr& reactor, Address bindAddress, Callback&& callback, ReactorPool& pool);
+
 private:
     TcpServer(Callback&& callback);
 
     void on_accept(ErrorCode errorCode);
+    void on_accept_pooled(TcpStream::Ptr&& stream);
 
     Callback _callback;
+    ReactorPool* _pool=0;
 };
 
 }} //namespaces
@@ -13,7 +13,6 @@
 // limitations under the License.
 
 #include "tcpstream.h"
-#include "utility/config.h"
 #include <assert.h>
 
 #define LOG_VERBOSE_ENABLED 1
@@ -31,21 +30,16 @@ TcpStream::~TcpStream() {
     LOG_VERBOSE() << ".";
 }
 
-void TcpStream::alloc_read_buffer() {
-    if (!_readBuffer.base) {
-        if (_readBuffer.len == 0) {
-            _readBuffer.len = config().get_int("io.stream_read_buffer_size", 256*1024, 2048, 1024*1024*16);
-        }
-        _readBuffer.base = (char*)malloc(_readBuffer.len);
+void TcpStream::on_read_size(size_t nread, size_t bufferSize) {
+    const BufferPool& pool = _reactor->_readBuffers;
+    if (nread == bufferSize) {
+        // more data is likely pending
+        _state.readBuffer = pool.class_size(bufferSize * 2);
+    } else if (nread <= bufferSize / 4) {
+        _state.readBuffer = pool.class_size(bufferSize / 2);
     }
 }
 
-void TcpStream::free_read_buffer() {
-    if (_readBuffer.base) free(_readBuffer.base);
-    _readBuffer.base = 0;
-    _readBuffer.len = 0;
-}
-
 Result TcpStream::enable_read(const TcpStream::Callback& callback) {
     assert(callback);
 
@@ -53,23 +47,26 @@ Result TcpStream::enable_read(const TcpStream::Callback& callback) {
         return make_unexpected(EC_ENOTCONN);
     }
 
-    alloc_read_buffer();
+    if (!_state.readBuffer) {
+        _state.readBuffer = _reactor->_readBuffers.class_size(0);
+    }
 
     static uv_alloc_cb read_alloc_cb = [](
         uv_handle_t* handle,
         size_t /*suggested_size*/,
         uv_buf_t* buf
     ) {
+        // borrowed from the reactor, returned in on_read()
+        BufferPool& pool = reinterpret_cast<Reactor*>(handle->loop->data)->_readBuffers;
         TcpStream* self = reinterpret_cast<TcpStream*>(handle->data);
-        if (self) {
-            *buf = self->_readBuffer;
-        }
+        size_t size = self ? self->_state.readBuffer : pool.class_size(0);
+        buf->base = pool.alloc(size);
+        buf->len = buf->base ? size : 0;
     };
 
     ErrorCode errorCode = (ErrorCode)uv_read_start((uv_stream_t*)_handle, read_alloc_cb, on_read);
     if (errorCode != 0) {
         _callback = Callback();
-        free_read_buffer();
         return make_unexpected(errorCode);
     }
 
@@ -85,7 +82,6 @@ void TcpStream::disable_read() {
             LOG_DEBUG() << "uv_read_stop failed,code=" << errorCode;
         }
     }
-    free_read_buffer();
 }
 
 Result TcpStream::write(const SharedBuffer& buf) {
@@ -149,8 +145,6 @@ Result TcpStream::send_write_request() {
             (uv_buf_t*)_writeBuffer.fragments(), _writeBuffer.num_fragments(), write_cb
         );
 
-        _state.unsent += wr->n;
-
         if (errorCode != 0) {
             return make_unexpected(errorCode);
         }
@@ -174,9 +168,17 @@ void TcpStream::on_data_written(ErrorCode errorCode, size_t n) {
         if (!_writeBuffer.empty()) {
             send_write_request();
         }
+        if (_drainCallback && _state.unsent <= _drainThreshold) {
+            _drainCallback();
+        }
     }
 }
 
+void TcpStream::set_drain_callback(size_t threshold, DrainCallback&& callback) {
+    _drainThreshold = threshold;
+    _drainCallback = std::move(callback);
+}
+
 bool TcpStream::is_connected() const {
     return _handle != 0;
 }
@@ -201,17 +203,24 @@ void TcpStream::on_read(uv_stream_t* handle, ssize_t nread, const uv_buf_t* buf)
     LOG_VERBOSE() << TRACE(handle) << TRACE(nread) << TRACE(handle->data);
 
     TcpStream* self = reinterpret_cast<TcpStream*>(handle->data);
+    Reactor* reactor = reinterpret_cast<Reactor*>(handle->loop->data);
 
     // self becomes null after async close
 
     if (self && self->_callback) {
         if (nread > 0) {
             self->_state.received += nread;
+            self->on_read_size((size_t)nread, buf->len);
             self->_callback(EC_OK, buf->base, (size_t)nread);
         } else if (nread < 0) {
             self->_callback((ErrorCode)nread, 0, 0);
         }
     }
+
+    // the data is consumed by the callback, the buffer is reused by the next read of any stream
+    if (buf->base) {
+        reactor->_readBuffers.release(buf->base, buf->len);
+    }
 }
 
 }} //namespaces
@@ -31,10 +31,14 @@ public:
     // errorCode==0 on new data
     using Callback = std::function<void(ErrorCode errorCode, void* data, size_t size)>;
 
+    // called after a write request completes
+    using DrainCallback = std::function<void()>;
+
     struct State {
         uint64_t received=0;
         uint64_t sent=0;
         size_t unsent=0; // == _writeBuffer.size()
+        size_t readBuffer=0; // size of the read buffer borrowed from the reactor per read, adapts to the traffic
     };
 
     ~TcpStream();
@@ -63,6 +67,9 @@ public:
     /// Shutdowns write side, waits for pending write requests to complete, but on reactor's side
     void shutdown();
 
+    /// Sets the callback invoked whenever some data is sent and no more than the threshold is left unsent
+    void set_drain_callback(size_t threshold, DrainCallback&& callback);
+
     bool is_connected() const;
 
     void close();
@@ -77,6 +84,11 @@ public:
     /// Returns peer address (non-null if connected)
     Address peer_address() const;
 
+    /// Returns the reactor the stream is attached to
+    Reactor* reactor() const {
+        return _reactor.get();
+    }
+
 private:
     static void on_read(uv_stream_t* handle, ssize_t nread, const uv_buf_t* buf);
 
@@ -85,8 +97,8 @@ private:
 
     TcpStream() = default;
 
-    void alloc_read_buffer();
-    void free_read_buffer();
+    // adjusts the read buffer size for the next read
+    void on_read_size(size_t nread, size_t bufferSize);
 
     // sends async write request
     Result send_write_request();
@@ -99,9 +111,10 @@ private:
 
     void connected(uv_stream_t* handle);
 
-    uv_buf_t _readBuffer={0, 0};
     BufferChain _writeBuffer;
     Callback _callback;
+    DrainCallback _drainCallback;
+    size_t _drainThreshold=0;
     State _state;
     bool _writeRequestSent=false;
 };
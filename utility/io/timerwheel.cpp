@@ -0,0 +1,236 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "timerwheel.h"
+#include "utility/helpers.h"
+#include <assert.h>
+
+#include "utility/logger.h"
+
+namespace beam { namespace io {
+
+static inline uint64_t mono_clock() {
+    return uv_hrtime() / 1000000; //nsec->msec, monotonic clock
+}
+
+void TimerWheel::Entry::cancel() {
+    if (_wheel) _wheel->cancel(*this);
+}
+
+TimerWheel::Ptr TimerWheel::create(const Reactor::Ptr& reactor) {
+    assert(reactor);
+    if (!reactor) IO_EXCEPTION(EC_EINVAL);
+
+    return TimerWheel::Ptr(new TimerWheel(Timer::create(reactor)));
+}
+
+TimerWheel::TimerWheel(Timer::Ptr&& timer) :
+    _now(mono_clock()),
+    _timer(std::move(timer))
+{
+    auto result = _timer->start(unsigned(-1), false, BIND_THIS_MEMFN(on_timer));
+    if (!result) IO_EXCEPTION(result.error());
+}
+
+TimerWheel::~TimerWheel() {
+    assert(!_insideCallback && "attempt to delete timer wheel from inside its callback");
+
+    for (unsigned level=0; level<LEVELS; ++level) {
+        for (unsigned i=0; i<SLOTS; ++i) {
+            Slot& slot = _slots[level][i];
+            while (slot.first) {
+                Entry& entry = *slot.first;
+                unlink(entry);
+                entry._wheel = 0;
+            }
+        }
+    }
+}
+
+void TimerWheel::link(Slot& slot, Entry& entry) {
+    entry._slot = &slot;
+    entry._prev = 0;
+    entry._next = slot.first;
+    if (slot.first) slot.first->_prev = &entry;
+    slot.first = &entry;
+}
+
+void TimerWheel::unlink(Entry& entry) {
+    assert(entry._slot);
+    if (entry._prev) {
+        entry._prev->_next = entry._next;
+    } else {
+        assert(entry._slot->first == &entry);
+        entry._slot->first = entry._next;
+    }
+    if (entry._next) entry._next->_prev = entry._prev;
+    entry._prev = entry._next = 0;
+    entry._slot = 0;
+}
+
+void TimerWheel::insert(Entry& entry) {
+    Clock delta = (entry._expires > _now) ? (entry._expires - _now) : 0;
+
+    unsigned level = 0;
+    while ((level + 1 < LEVELS) && (delta >> (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+
+    link(_slots[level][(entry._expires >> (SLOT_BITS * level)) & MASK], entry);
+}
+
+void TimerWheel::set(Entry& entry, unsigned intervalMsec) {
+    if (entry._wheel) {
+        cancel(entry);
+    }
+
+    Clock now = mono_clock();
+    if (!_size && !_insideCallback && now > _now) {
+        // nothing was processed while idle, don't walk through the elapsed slots later
+        _now = now;
+    }
+
+    Clock clock = now + intervalMsec;
+    if (clock <= _now) clock = _now + 1; // the current tick is already processed
+    if (clock - _now >= (Clock(1) << (SLOT_BITS * LEVELS))) clock = _now + (Clock(1) << (SLOT_BITS * LEVELS)) - 1;
+
+    entry._expires = clock;
+    entry._wheel = this;
+    insert(entry);
+    ++_size;
+
+    if (!_insideCallback && _timerSetTo > clock) {
+        restart_timer();
+    }
+}
+
+void TimerWheel::cancel(Entry& entry) {
+    if (entry._wheel != this) return;
+
+    unlink(entry);
+    entry._wheel = 0;
+    assert(_size);
+    --_size;
+
+    if (!_size && !_insideCallback && _timerSetTo != NEVER) {
+        stop_timer();
+    }
+}
+
+void TimerWheel::cascade(unsigned level) {
+    unsigned index = unsigned(_now >> (SLOT_BITS * level)) & MASK;
+    if (!index && (level + 1 < LEVELS)) {
+        cascade(level + 1);
+    }
+
+    Slot& slot = _slots[level][index];
+    Entry* entry = slot.first;
+    slot.first = 0;
+
+    while (entry) {
+        Entry* next = entry->_next;
+        insert(*entry);
+        entry = next;
+    }
+}
+
+void TimerWheel::advance(Clock to) {
+    while (_now < to) {
+        // next occupied slot of the lowest level within the current round, or the end of the round (cascade)
+        Clock t = (_now | MASK) + 1;
+        for (Clock x = _now + 1; x < t; ++x) {
+            if (_slots[0][x & MASK].first) {
+                t = x;
+                break;
+            }
+        }
+
+        if (t > to) {
+            _now = to;
+            break;
+        }
+
+        _now = t;
+        if (!(t & MASK)) {
+            cascade(1);
+        }
+
+        // all the entries in this slot expire now. Entries set by the callbacks never get here
+        Slot& expired = _slots[0][t & MASK];
+        while (expired.first) {
+            Entry& entry = *expired.first;
+            unlink(entry);
+            entry._wheel = 0;
+            --_size;
+            entry.on_timer();
+        }
+    }
+}
+
+TimerWheel::Clock TimerWheel::next_wake() const {
+    if (!_size) return NEVER;
+
+    Clock res = NEVER;
+    for (unsigned level=0; level<LEVELS; ++level) {
+        unsigned shift = SLOT_BITS * level;
+        Clock current = _now >> shift;
+
+        // entries at the level are at the ring distance 1..SLOTS from the current slot
+        for (Clock k=1; k<=SLOTS; ++k) {
+            if (_slots[level][(current + k) & MASK].first) {
+                Clock t = (current + k) << shift;
+                if (res > t) res = t;
+                break;
+            }
+        }
+    }
+    return res;
+}
+
+void TimerWheel::restart_timer() {
+    Clock next = next_wake();
+    if (next == NEVER) {
+        if (_timerSetTo != NEVER) {
+            stop_timer();
+        }
+        return;
+    }
+
+    Clock now = mono_clock();
+    unsigned intervalMsec = (next > now) ? unsigned(next - now) : 0;
+    // Timer::cancel() resets the callback, so it's set again
+    Result res = _timer->start(intervalMsec, false, BIND_THIS_MEMFN(on_timer));
+    if (!res) {
+        LOG_ERROR() << "cannot restart timer, code=" << res.error();
+        _timerSetTo = NEVER;
+    } else {
+        _timerSetTo = next;
+    }
+}
+
+void TimerWheel::stop_timer() {
+    _timer->cancel();
+    _timerSetTo = NEVER;
+}
+
+void TimerWheel::on_timer() {
+    _timerSetTo = NEVER;
+    _insideCallback = true;
+    advance(mono_clock());
+    _insideCallback = false;
+
+    restart_timer();
+}
+
+}} //namespaces
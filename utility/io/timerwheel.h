@@ -0,0 +1,126 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "timer.h"
+#include <limits>
+
+namespace beam { namespace io {
+
+/// Hierarchical hashed timer wheel: O(1) set/cancel of timeouts, all driven by a single uv timer.
+/// 4 levels of 256 slots each, 1 msec tick, so that intervals up to 2^32 msec are covered.
+/// Each reactor has one, see Reactor::timer_wheel()
+class TimerWheel {
+    struct Slot;
+public:
+    using Ptr = std::unique_ptr<TimerWheel>;
+
+    /// Timeout, embedded into the user object. Cancelled on destruction
+    class Entry {
+    public:
+        Entry() = default;
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+
+        virtual ~Entry() { cancel(); }
+
+        bool is_set() const { return _wheel != 0; }
+
+        void cancel();
+
+    protected:
+        /// Called on expiration, the entry is not set anymore. May set/cancel timeouts, and delete this entry
+        virtual void on_timer() = 0;
+
+    private:
+        friend class TimerWheel;
+
+        Entry* _prev=0;
+        Entry* _next=0;
+        Slot* _slot=0;
+        uint64_t _expires=0;
+        TimerWheel* _wheel=0;
+    };
+
+    /// Creates timer wheel, throws on errors
+    static Ptr create(const Reactor::Ptr& reactor);
+
+    /// (Re)sets the entry to expire after the interval
+    void set(Entry& entry, unsigned intervalMsec);
+
+    /// Cancels the entry if it's set
+    void cancel(Entry& entry);
+
+    /// Number of entries set
+    size_t size() const { return _size; }
+
+    /// Cancels all the entries
+    ~TimerWheel();
+
+private:
+    static constexpr unsigned LEVELS = 4;
+    static constexpr unsigned SLOT_BITS = 8;
+    static constexpr unsigned SLOTS = 1 << SLOT_BITS;
+    static constexpr uint64_t MASK = SLOTS - 1;
+
+    /// abs. time
+    using Clock = uint64_t;
+    static constexpr Clock NEVER = std::numeric_limits<Clock>::max();
+
+    /// Slot list head
+    struct Slot {
+        Entry* first=0;
+    };
+
+    explicit TimerWheel(Timer::Ptr&& timer);
+
+    static void link(Slot& slot, Entry& entry);
+    static void unlink(Entry& entry);
+
+    /// Places the entry according to its expiration time relative to the current one
+    void insert(Entry& entry);
+
+    /// Moves the current slot of the level (and of the upper levels, if they wrap) to the lower levels
+    void cascade(unsigned level);
+
+    /// Processes expired entries up to the given time
+    void advance(Clock to);
+
+    /// Earliest time when something should be done (expiration or cascade)
+    Clock next_wake() const;
+
+    void on_timer();
+    void restart_timer();
+    void stop_timer();
+
+    /// Slots
+    Slot _slots[LEVELS][SLOTS];
+
+    /// Time (msec ticks) processed so far
+    Clock _now;
+
+    /// Entries set
+    size_t _size=0;
+
+    /// Flag that prevents from updating timer too often
+    bool _insideCallback=false;
+
+    /// Next time to wake
+    Clock _timerSetTo=NEVER;
+
+    /// The only uv timer
+    Timer::Ptr _timer;
+};
+
+}} //namespaces
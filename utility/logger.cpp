@@ -21,6 +21,9 @@
 #include <iostream>
 #include <fstream>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
 #include <algorithm>
 
 namespace beam {
@@ -30,8 +33,10 @@ using namespace std;
 Logger* Logger::g_logger = 0;
 
 class LoggerImpl : public Logger {
-    mutex _mutex;
+    friend class AsyncLogger;
 protected:
+    mutex _mutex;
+
     static const size_t MAX_HEADER_SIZE = 256;
     static const size_t MAX_TIMESTAMP_SIZE = 80;
 
@@ -53,12 +58,6 @@ protected:
         if (minLevel <= 0) throw runtime_error("logger: minimal level out of range");
     }
 
-    virtual ~LoggerImpl() {
-        if (this == g_logger) {
-            g_logger = 0;
-        }
-    }
-
     void set_header_formatter(LogMessageHeaderFormatter formatter) override {
         if (formatter) _headerFormatter = formatter;
     }
@@ -86,6 +85,12 @@ protected:
     }
 
 public:
+    virtual ~LoggerImpl() {
+        if (this == g_logger) {
+            g_logger = 0;
+        }
+    }
+
     bool level_accepted(int level) override {
         return level >= _minLevel;
     }
@@ -97,6 +102,12 @@ public:
         fwrite(msg, 1, size, _sink);
         if (level >= _flushLevel) fflush(_sink);
     }
+
+    virtual void flush() {
+        if (!_sink) return;
+        lock_guard<mutex> lock(_mutex);
+        fflush(_sink);
+    }
 };
 
 class ConsoleLogger : public LoggerImpl {
@@ -121,7 +132,12 @@ public:
 
     void rotate() override {
         try {
-            open_new_file();
+            FILE* prev = _sink;
+            {
+                lock_guard<mutex> lock(_mutex);
+                open_new_file();
+            }
+            if (prev && prev != _sink) fclose(prev);
         } catch (const std::exception& e) {
             fprintf(stderr, "log error, %s\n", e.what());
         }
@@ -135,6 +151,7 @@ private:
         string fileName(_fileNamePrefix);
         fileName += format_timestamp("%y_%m_%d_%H_%M_%S", local_timestamp_msec(), false);
         fileName += ".log";
+        FILE* sink = 0;
         if (!_dstPath.empty())
         {
             boost::filesystem::path path{ _dstPath };
@@ -145,13 +162,14 @@ private:
             }
 
             path /= fileName;
-            _sink = fopen(path.string().c_str(), "ab");
+            sink = fopen(path.string().c_str(), "ab");
         }
         else
         {
-            _sink = fopen(fileName.c_str(), "ab");
+            sink = fopen(fileName.c_str(), "ab");
         }
-        if (!_sink) throw runtime_error(string("cannot open file ") + fileName);
+        if (!sink) throw runtime_error(string("cannot open file ") + fileName);
+        _sink = sink;
     }
 
     std::string _fileNamePrefix;
@@ -189,6 +207,179 @@ public:
     void rotate() override {
         _fileSink.rotate();
     }
+
+    void flush() override {
+        _consoleSink.flush();
+        _fileSink.flush();
+    }
+};
+
+/// Async mode: the calling thread only copies the formatted message into a lock-free ring (D.Vyukov's bounded queue),
+/// the header formatting and writes are performed by the writer thread, which flushes the sink once per batch
+class AsyncLogger : public Logger {
+public:
+    AsyncLogger(std::unique_ptr<LoggerImpl>&& sink, int flushLevel, size_t queueSize) :
+        _sink(std::move(sink)),
+        _flushLevel(flushLevel)
+    {
+        size_t n = 2;
+        while (n < queueSize) n <<= 1;
+        _mask = n - 1;
+        _records.reset(new Record[n]);
+        for (size_t i=0; i<n; ++i) {
+            _records[i].seq.store(i, memory_order_relaxed);
+        }
+
+        _thread = std::thread(&AsyncLogger::run, this);
+    }
+
+    ~AsyncLogger() {
+        if (this == g_logger) {
+            g_logger = 0;
+        }
+        {
+            lock_guard<mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cv.notify_one();
+        _thread.join();
+    }
+
+    void set_header_formatter(LogMessageHeaderFormatter formatter) override {
+        _sink->set_header_formatter(formatter);
+    }
+
+    void set_time_format(const char* format, bool printMilliseconds) override {
+        _sink->set_time_format(format, printMilliseconds);
+    }
+
+    void rotate() override {
+        _rotate = true;
+        wake_writer();
+    }
+
+protected:
+    bool level_accepted(int level) override {
+        return _sink->level_accepted(level);
+    }
+
+    void write_message(const LogMessageHeader& header, const char* buf, size_t size) override {
+        Record* rec = 0;
+        size_t pos = _enqueuePos.load(memory_order_relaxed);
+        for (;;) {
+            rec = &_records[pos & _mask];
+            size_t seq = rec->seq.load(memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (!diff) {
+                if (_enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                // full
+                if (header.level < _flushLevel) {
+                    _dropped.fetch_add(1, memory_order_relaxed);
+                    return;
+                }
+                wake_writer();
+                std::this_thread::yield();
+                pos = _enqueuePos.load(memory_order_relaxed);
+            } else {
+                pos = _enqueuePos.load(memory_order_relaxed);
+            }
+        }
+
+        rec->header = header;
+        rec->text.assign(buf, size);
+        rec->seq.store(pos + 1, memory_order_release);
+
+        if (_sleeping.load(memory_order_relaxed) || header.level >= _flushLevel) {
+            wake_writer();
+        }
+    }
+
+private:
+    static const size_t MAX_RECORD_CAPACITY = 4096; // larger buffers are released after the message is written
+
+    struct Record {
+        std::atomic<size_t> seq;
+        LogMessageHeader header;
+        std::string text;
+
+        Record() : header(0, 0, 0, 0) {}
+    };
+
+    bool has_records() {
+        return _records[_dequeuePos & _mask].seq.load(memory_order_acquire) == _dequeuePos + 1;
+    }
+
+    /// Writes all the queued records, returns their count
+    size_t write_batch() {
+        size_t count = 0;
+        for (; has_records(); ++count, ++_dequeuePos) {
+            Record& rec = _records[_dequeuePos & _mask];
+            _sink->write_message(rec.header, rec.text.data(), rec.text.size());
+
+            if (rec.text.capacity() > MAX_RECORD_CAPACITY) {
+                std::string().swap(rec.text);
+            }
+            rec.seq.store(_dequeuePos + _mask + 1, memory_order_release);
+        }
+
+        size_t dropped = _dropped.exchange(0, memory_order_relaxed);
+        if (dropped) {
+            LogMessageHeader header(LOG_LEVEL_WARNING, 0, 0, 0);
+            std::string text = std::to_string(dropped) + " log messages dropped, the queue is full\n";
+            _sink->write_message(header, text.data(), text.size());
+        }
+
+        if (count || dropped) {
+            _sink->flush();
+        }
+        return count;
+    }
+
+    void wake_writer() {
+        if (_sleeping.exchange(false, memory_order_relaxed)) {
+            // the writer may be between the predicate check and the wait
+            { lock_guard<mutex> lock(_mutex); }
+            _cv.notify_one();
+        }
+    }
+
+    void run() {
+        block_signals_in_this_thread();
+
+        for (;;) {
+            while (write_batch()) {}
+
+            if (_rotate.exchange(false)) {
+                _sink->rotate();
+            }
+
+            unique_lock<mutex> lock(_mutex);
+            if (_stop) break;
+
+            _sleeping = true;
+            _cv.wait_for(lock, chrono::milliseconds(100), [this]() { return _stop || !_sleeping || has_records(); });
+            _sleeping = false;
+        }
+
+        write_batch();
+    }
+
+    std::unique_ptr<LoggerImpl> _sink;
+    int _flushLevel;
+
+    std::unique_ptr<Record[]> _records;
+    size_t _mask;
+    std::atomic<size_t> _enqueuePos{0};
+    size_t _dequeuePos=0;
+    std::atomic<size_t> _dropped{0};
+
+    std::thread _thread;
+    mutex _mutex;
+    condition_variable _cv;
+    std::atomic<bool> _sleeping{false};
+    std::atomic<bool> _rotate{false};
+    bool _stop=false;
 };
 
 std::shared_ptr<Logger> Logger::create(
@@ -196,33 +387,44 @@ std::shared_ptr<Logger> Logger::create(
     int consoleLevel,
     int fileLevel,
     const std::string& fileNamePrefix,
-    const std::string& dstPath
+    const std::string& dstPath,
+    size_t asyncQueueSize
 ) {
     if (g_logger) {
         throw runtime_error("logger already initialized");
     }
 
-    std::shared_ptr<Logger> logger;
+    std::unique_ptr<LoggerImpl> sink;
 
     int what = 0;
 
     if (consoleLevel > 0) what += 1;
     if (fileLevel > 0) what += 2;
 
+    // in async mode the writer flushes once per batch
+    int sinkFlushLevel = asyncQueueSize ? LOG_LEVEL_CRITICAL + 1 : flushLevel;
+
     switch (what) {
         case 3:
-            logger.reset(new CombinedLogger(flushLevel, consoleLevel, fileLevel, fileNamePrefix, dstPath));
+            sink.reset(new CombinedLogger(sinkFlushLevel, consoleLevel, fileLevel, fileNamePrefix, dstPath));
             break;
         case 2:
-            logger.reset(new FileLogger(flushLevel, fileLevel, fileNamePrefix, dstPath));
+            sink.reset(new FileLogger(sinkFlushLevel, fileLevel, fileNamePrefix, dstPath));
             break;
         case 1:
-            logger.reset(new ConsoleLogger(flushLevel, consoleLevel));
+            sink.reset(new ConsoleLogger(sinkFlushLevel, consoleLevel));
             break;
         default:
             throw runtime_error("no logger sink configured");
     }
 
+    std::shared_ptr<Logger> logger;
+    if (asyncQueueSize) {
+        logger.reset(new AsyncLogger(std::move(sink), flushLevel, asyncQueueSize));
+    } else {
+        logger.reset(sink.release());
+    }
+
     g_logger = logger.get();
     return logger;
 }
@@ -143,7 +143,12 @@ public:
         const std::string& fileNamePrefix = std::string(),
 
         // path to log file
-        const std::string& dstPath = std::string()
+        const std::string& dstPath = std::string(),
+
+        // async mode if non-zero: messages are queued into a ring of this many records (rounded up to a power of 2)
+        // and written by a background thread, in batches. When the ring is full - messages below flushLevel are dropped,
+        // others wait for free space
+        size_t asyncQueueSize = 0
     );
 
     virtual ~Logger() {}
@@ -154,7 +159,7 @@ public:
     /// Sets custom timestamp formatter as for strftime(), default is "%Y-%m-%d.%T" and milliseconds are printed
     virtual void set_time_format(const char* format, bool printMilliseconds) = 0;
 
-    /// Rotates file name, called externally
+    /// Rotates file name, called externally. In async mode performed by the writer thread
     virtual void rotate() = 0;
 
     static bool will_log(int level) {
@@ -168,6 +173,7 @@ public:
 
 protected:
     friend class LogMessage;
+    friend class AsyncLogger;
 
     virtual bool level_accepted(int level) = 0;
 
@@ -16,12 +16,12 @@
 #include "io/asyncevent.h"
 #include <mutex>
 #include <deque>
+#include <atomic>
 #include <assert.h>
 
 namespace beam {
 
-/// Inter-thread message queue, backend for RX and TX sides (see below)
-/// Current impl (may be changed if performance bottleneck detected):
+/// Inter-thread message queue, may be used as a backend for RX and TX sides (see below)
 /// 1) unlimited size - should be controlled by channel sides explicitly;
 /// 2) std::deque and std::mutex inside
 /// Message type (class T) requirement: default constructible + callable *or* movable (see send() functions)
@@ -71,11 +71,188 @@ private:
     std::deque<T> _queue;
 
     bool _rxClosed=false;
-    // TODO consider atomic flag
+};
+
+/// Lock-free multiple producers/single consumer queue, the default backend for RX and TX sides.
+/// 1) linked list of nodes (D.Vyukov's MPSC algorithm): a producer links its node with a single atomic exchange,
+/// the consumer never blocks producers. The last consumed node serves as a stub;
+/// 2) consumed nodes are recycled (see NodePool), so that a message doesn't cost an allocation;
+/// 3) same semantics as MessageQueue: unlimited size, same message type requirements, plus move-assignable.
+/// A message being sent concurrently may be not visible to receive() yet - this is ok for RX, since
+/// the sender triggers the async event after send() returns.
+template <class T> class LockFreeMessageQueue {
+public:
+    LockFreeMessageQueue() {
+        _tail = new Node;
+        _head.store(_tail, std::memory_order_relaxed);
+    }
+
+    ~LockFreeMessageQueue() {
+        NodePool::free_batch(_tail);
+        NodePool::free_batch(_released);
+    }
+
+    /// Called from sender threads via TX object
+    bool send(const T& message) {
+        if (_rxClosed.load(std::memory_order_relaxed)) return false;
+        Node* node = NodePool::alloc();
+        node->message = message;
+        push(node);
+        return true;
+    }
+
+    /// Called from sender threads via TX object
+    bool send(T&& message) {
+        if (_rxClosed.load(std::memory_order_relaxed)) return false;
+        Node* node = NodePool::alloc();
+        node->message = std::move(message);
+        push(node);
+        return true;
+    }
+
+    /// May be called by both TX and RX, approximate if there're concurrent senders
+    size_t current_size() {
+        size_t sent = _sent.load(std::memory_order_relaxed);
+        size_t received = _received.load(std::memory_order_relaxed);
+        return (sent > received) ? (sent - received) : 0;
+    }
+
+    /// Called from receiver thread via RX object
+    bool receive(T& message) {
+        Node* next = _tail->next.load(std::memory_order_acquire);
+        if (!next) return false;
+
+        message = std::move(next->message);
+        release(_tail);
+        _tail = next;
+
+        _received.store(_received.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// Called by RX to indicate that the channel is being closed
+    void close_rx() {
+        _rxClosed.store(true, std::memory_order_relaxed);
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        Node* nextBatch=nullptr;
+        T message;
+    };
+
+    /// Free nodes, shared by all the queues of the same message type.
+    /// The consumer returns them in batches onto a shared stack, a producer takes all the available batches at once
+    /// (by a single exchange, hence no ABA problem) into its thread-local cache.
+    struct NodePool {
+        static constexpr size_t BATCH_SIZE = 64;
+        static constexpr size_t MAX_POOLED = 1024 * BATCH_SIZE; // beyond this the released nodes are freed
+
+        struct Stack {
+            std::atomic<Node*> top{nullptr};
+            std::atomic<size_t> size{0};
+        };
+
+        struct Cache {
+            Node* top=nullptr;
+            ~Cache() { free_batches(top); }
+        };
+
+        /// Deliberately never destroyed: queues owned by static objects or by threads still running
+        /// at exit may return nodes after the static destructors. The pooled nodes are bounded by MAX_POOLED
+        static Stack& shared() {
+            static Stack* s = new Stack;
+            return *s;
+        }
+
+        static Node* alloc() {
+            static thread_local Cache cache;
+
+            if (!cache.top) {
+                Stack& s = shared();
+                if (!s.top.load(std::memory_order_relaxed)) return new Node;
+                cache.top = s.top.exchange(nullptr, std::memory_order_acquire);
+                if (!cache.top) return new Node;
+                s.size.store(0, std::memory_order_relaxed); // approximate
+            }
+
+            Node* node = cache.top;
+            Node* rest = node->next.load(std::memory_order_relaxed);
+            if (rest) {
+                rest->nextBatch = node->nextBatch;
+                cache.top = rest;
+            } else {
+                cache.top = node->nextBatch;
+            }
+
+            node->next.store(nullptr, std::memory_order_relaxed);
+            node->nextBatch = nullptr;
+            return node;
+        }
+
+        static void free_batch(Node* node) {
+            while (node) {
+                Node* next = node->next.load(std::memory_order_relaxed);
+                delete node;
+                node = next;
+            }
+        }
+
+        static void free_batches(Node* node) {
+            while (node) {
+                Node* nextBatch = node->nextBatch;
+                free_batch(node);
+                node = nextBatch;
+            }
+        }
+
+        static void release_batch(Node* batch) {
+            Stack& s = shared();
+            if (s.size.fetch_add(BATCH_SIZE, std::memory_order_relaxed) >= MAX_POOLED) {
+                s.size.fetch_sub(BATCH_SIZE, std::memory_order_relaxed);
+                free_batch(batch);
+                return;
+            }
+
+            Node* top = s.top.load(std::memory_order_relaxed);
+            do {
+                batch->nextBatch = top;
+            } while (!s.top.compare_exchange_weak(top, batch, std::memory_order_release, std::memory_order_relaxed));
+        }
+    };
+
+    /// Called by the consumer, the node keeps the moved-from message
+    void release(Node* node) {
+        node->next.store(_released, std::memory_order_relaxed);
+        _released = node;
+        if (++_releasedCount == NodePool::BATCH_SIZE) {
+            NodePool::release_batch(_released);
+            _released = nullptr;
+            _releasedCount = 0;
+        }
+    }
+
+    void push(Node* node) {
+        _sent.fetch_add(1, std::memory_order_relaxed);
+        Node* prev = _head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /// Producers side
+    std::atomic<Node*> _head;
+    std::atomic<size_t> _sent{0};
+    std::atomic<bool> _rxClosed{false};
+
+    /// Consumer side, on a separate cache line
+    alignas(64) Node* _tail;
+    Node* _released=nullptr;
+    size_t _releasedCount=0;
+    std::atomic<size_t> _received{0};
 };
 
 /// Transmitter side of inter-thread channel
-template <class T> class TX {
+template <class T, class Queue = LockFreeMessageQueue<T>> class TX {
 public:
 
     bool send(const T& message) {
@@ -87,33 +264,33 @@ public:
     }
 
     size_t queue_size() {
-        return _queue.current_size();
+        return _queue->current_size();
     }
 
 private:
-    template <class> friend class RX; // friend because RX creates TX-es
+    template <class, class> friend class RX; // friend because RX creates TX-es
 
     /// Ctor called by RX, see friendship
-    TX(const std::shared_ptr<MessageQueue<T>>& queue, const io::AsyncEvent::Ptr& asyncEvent) :
+    TX(const std::shared_ptr<Queue>& queue, const io::AsyncEvent::Ptr& asyncEvent) :
         _queue(queue), _asyncEvent(asyncEvent)
     {}
 
     /// Queue
-    std::shared_ptr<MessageQueue<T>> _queue;
+    std::shared_ptr<Queue> _queue;
 
     /// io::Reactor event that can be called from another thread
     io::AsyncEvent::Trigger _asyncEvent;
 };
 
 /// Receiver side of inter=thread channel
-template <class T> class RX {
+template <class T, class Queue = LockFreeMessageQueue<T>> class RX {
 public:
     /// Message callback, called from reactor thread
     using Callback = std::function<void(T&& message)>;
 
     /// Ctor called by receiver side
     explicit RX(const io::Reactor::Ptr& reactor, Callback&& callback) :
-        _queue(std::make_shared<MessageQueue<T>>()),
+        _queue(std::make_shared<Queue>()),
         _asyncEvent(io::AsyncEvent::create(reactor, [this]() { on_receive(); } )),
         _callback(std::move(callback))
     {
@@ -127,12 +304,12 @@ public:
     }
 
     /// RX creates TXes
-    TX<T> get_tx() {
-        return TX<T>(_queue, _asyncEvent);
+    TX<T, Queue> get_tx() {
+        return TX<T, Queue>(_queue, _asyncEvent);
     }
 
     size_t queue_size() {
-        return _queue.current_size();
+        return _queue->current_size();
     }
 
     void close() {
@@ -146,7 +323,7 @@ private:
         }
     }
 
-    std::shared_ptr<MessageQueue<T>> _queue;
+    std::shared_ptr<Queue> _queue;
     io::AsyncEvent::Ptr _asyncEvent;
     Callback _callback;
 
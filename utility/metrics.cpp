@@ -0,0 +1,168 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "metrics.h"
+#include "nlohmann/json.hpp"
+#include <iterator>
+#include <sstream>
+
+namespace beam { namespace metrics {
+
+static inline unsigned most_significant_bit(uint64_t value) {
+    unsigned res = 0;
+    while (value >>= 1) ++res;
+    return res;
+}
+
+unsigned Histogram::bucket_index(uint64_t value) {
+    if (value < SUB_BUCKETS) return unsigned(value);
+
+    unsigned msb = most_significant_bit(value);
+    if (msb >= MAX_BITS) return BUCKETS - 1;
+
+    // the top SUB_BITS+1 bits select the bucket
+    unsigned shift = msb - SUB_BITS;
+    return (shift + 1) * SUB_BUCKETS + unsigned(value >> shift) - SUB_BUCKETS;
+}
+
+uint64_t Histogram::bucket_upper_bound(unsigned index) {
+    if (index < SUB_BUCKETS) return index;
+
+    unsigned shift = index / SUB_BUCKETS - 1;
+    uint64_t sub = index % SUB_BUCKETS + SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+void Histogram::record(uint64_t usec) {
+    _buckets[bucket_index(usec)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(usec, std::memory_order_relaxed);
+
+    uint64_t max = _max.load(std::memory_order_relaxed);
+    while (usec > max && !_max.compare_exchange_weak(max, usec, std::memory_order_relaxed)) {}
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot s;
+
+    // concurrent updates may be partially visible, the buckets are the source of truth for the count
+    uint64_t buckets[BUCKETS];
+    for (unsigned i=0; i<BUCKETS; ++i) {
+        buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+        s.count += buckets[i];
+    }
+    s.sum = _sum.load(std::memory_order_relaxed);
+    s.max = _max.load(std::memory_order_relaxed);
+
+    if (!s.count) return s;
+
+    struct Percentile {
+        uint64_t Snapshot::* value;
+        uint64_t rank;
+    };
+    Percentile percentiles[] = {
+        { &Snapshot::p50, (s.count * 500 + 999) / 1000 },
+        { &Snapshot::p90, (s.count * 900 + 999) / 1000 },
+        { &Snapshot::p99, (s.count * 990 + 999) / 1000 },
+        { &Snapshot::p999, (s.count * 999 + 999) / 1000 }
+    };
+
+    uint64_t seen = 0;
+    size_t next = 0;
+    for (unsigned i=0; i<BUCKETS && next < std::size(percentiles); ++i) {
+        seen += buckets[i];
+        while (next < std::size(percentiles) && seen >= percentiles[next].rank) {
+            uint64_t bound = bucket_upper_bound(i);
+            s.*(percentiles[next].value) = (bound < s.max) ? bound : s.max;
+            ++next;
+        }
+    }
+    return s;
+}
+
+Registry& Registry::get() {
+    static Registry registry;
+    return registry;
+}
+
+template <typename T> static T& get_or_create(std::map<std::string, std::unique_ptr<T>>& m, const std::string& name) {
+    auto& p = m[name];
+    if (!p) p.reset(new T());
+    return *p;
+}
+
+Counter& Registry::counter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return get_or_create(_counters, name);
+}
+
+Gauge& Registry::gauge(const std::string& name) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return get_or_create(_gauges, name);
+}
+
+Histogram& Registry::histogram(const std::string& name) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return get_or_create(_histograms, name);
+}
+
+std::string Registry::to_text() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::ostringstream os;
+
+    for (const auto& [name, p] : _counters) {
+        os << name << " " << p->get() << '\n';
+    }
+    for (const auto& [name, p] : _gauges) {
+        os << name << " " << p->get() << '\n';
+    }
+    for (const auto& [name, p] : _histograms) {
+        Histogram::Snapshot s = p->snapshot();
+        if (!s.count) continue;
+        os << name << " count=" << s.count << " avg=" << s.sum / s.count << " p50=" << s.p50 << " p90=" << s.p90
+           << " p99=" << s.p99 << " p999=" << s.p999 << " max=" << s.max << '\n';
+    }
+    return os.str();
+}
+
+std::string Registry::to_json() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    nlohmann::json res = {
+        { "counters", nlohmann::json::object() },
+        { "gauges", nlohmann::json::object() },
+        { "histograms", nlohmann::json::object() }
+    };
+
+    for (const auto& [name, p] : _counters) {
+        res["counters"][name] = p->get();
+    }
+    for (const auto& [name, p] : _gauges) {
+        res["gauges"][name] = p->get();
+    }
+    for (const auto& [name, p] : _histograms) {
+        Histogram::Snapshot s = p->snapshot();
+        res["histograms"][name] = {
+            { "count", s.count },
+            { "sum", s.sum },
+            { "max", s.max },
+            { "p50", s.p50 },
+            { "p90", s.p90 },
+            { "p99", s.p99 },
+            { "p999", s.p999 }
+        };
+    }
+    return res.dump();
+}
+
+}} //namespaces
@@ -0,0 +1,125 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+
+namespace beam { namespace metrics {
+
+/// Monotonic counter. Updates are lock-free, from any thread
+class Counter {
+public:
+    void add(uint64_t n=1) { _value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t get() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> _value{0};
+};
+
+/// Current value of something (queue size etc.)
+class Gauge {
+public:
+    void set(int64_t value) { _value.store(value, std::memory_order_relaxed); }
+    int64_t get() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> _value{0};
+};
+
+/// Latency histogram, values are in microseconds. Buckets are log-linear (HDR-style): each power of 2 range
+/// is split into 16 sub-buckets, so that the relative error of percentiles is below 1/16.
+/// Recording is lock-free, from any thread
+class Histogram {
+public:
+    struct Snapshot {
+        uint64_t count=0;
+        uint64_t sum=0;
+        uint64_t max=0;
+        uint64_t p50=0;
+        uint64_t p90=0;
+        uint64_t p99=0;
+        uint64_t p999=0;
+    };
+
+    void record(uint64_t usec);
+
+    /// Percentiles are approximated by the upper bounds of the buckets
+    Snapshot snapshot() const;
+
+    static unsigned bucket_index(uint64_t value);
+    static uint64_t bucket_upper_bound(unsigned index);
+
+    static constexpr unsigned SUB_BITS = 4;
+    static constexpr unsigned SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr unsigned MAX_BITS = 40; // ~12 days in usec, bigger values are saturated
+    static constexpr unsigned BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+private:
+    std::atomic<uint64_t> _buckets[BUCKETS] = {};
+    std::atomic<uint64_t> _count{0};
+    std::atomic<uint64_t> _sum{0};
+    std::atomic<uint64_t> _max{0};
+};
+
+/// Records the time elapsed from construction to destruction
+class LatencyTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit LatencyTimer(Histogram& histogram) :
+        _histogram(histogram),
+        _start(Clock::now())
+    {}
+
+    ~LatencyTimer() {
+        _histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - _start).count());
+    }
+
+private:
+    Histogram& _histogram;
+    Clock::time_point _start;
+};
+
+/// Named metrics of the process. Lookups take a lock, hence they're supposed to be done once,
+/// the returned objects live as long as the process
+class Registry {
+public:
+    static Registry& get();
+
+    Counter& counter(const std::string& name);
+    Gauge& gauge(const std::string& name);
+    Histogram& histogram(const std::string& name);
+
+    /// One metric per line, histograms with count, sum, max and percentiles
+    std::string to_text() const;
+
+    /// {"counters":{...},"gauges":{...},"histograms":{"name":{"count":..,"p50":..}}}
+    std::string to_json() const;
+
+private:
+    Registry() = default;
+
+    mutable std::mutex _mutex;
+    std::map<std::string, std::unique_ptr<Counter>> _counters;
+    std::map<std::string, std::unique_ptr<Gauge>> _gauges;
+    std::map<std::string, std::unique_ptr<Histogram>> _histograms;
+};
+
+}} //namespaces
@@ -40,6 +40,8 @@ namespace beam
         const char* VERIFICATION_THREADS = "verification_threads";
         const char* MINER_ID = "miner_id";
         const char* NODE_PEER = "peer";
+        const char* METRICS_PORT = "metrics_port";
+        const char* METRICS_PERIOD = "metrics_period";
         const char* PASS = "pass";
         const char* AMOUNT = "amount";
         const char* AMOUNT_FULL = "amount,a";
@@ -109,6 +111,8 @@ namespace beam
             (cli::VERIFICATION_THREADS, po::value<int>()->default_value(-1), "number of threads for cryptographic verifications (0 = single thread, -1 = auto)")
             (cli::MINER_ID, po::value<uint32_t>()->default_value(0), "seed for miner nonce generation")
             (cli::NODE_PEER, po::value<vector<string>>()->multitoken(), "nodes to connect to")
+            (cli::METRICS_PORT, po::value<uint16_t>()->default_value(0), "localhost port to serve the node metrics on (0 = disabled)")
+            (cli::METRICS_PERIOD, po::value<uint32_t>()->default_value(0), "period of the metrics log dump, in seconds (0 = disabled)")
             (cli::IMPORT, po::value<Height>()->default_value(0), "Specify the blockchain height to import. The compressed history is asumed to be downloaded the the specified directory")
             ;
 
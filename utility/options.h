@@ -38,6 +38,8 @@ namespace beam
         extern const char* VERIFICATION_THREADS;
         extern const char* MINER_ID;
         extern const char* NODE_PEER;
+        extern const char* METRICS_PORT;
+        extern const char* METRICS_PERIOD;
         extern const char* PASS;
         extern const char* AMOUNT;
         extern const char* AMOUNT_FULL;
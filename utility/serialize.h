@@ -99,6 +99,11 @@ public:
         return buffer();
     }
 
+    /// Reserves the buffer for size bytes more, so that they're serialized w/o reallocations
+    void reserve(size_t size) {
+        _os.reserve(_os.m_vec.size() + size);
+    }
+
     void swap_buf(std::vector<uint8_t>& v) { _os.m_vec.swap(v); }
 
 private:
@@ -138,6 +143,13 @@ struct SerializerSizeCounter
 	}
 };
 
+/// Size of the serialized object, w/o serializing it
+template <typename T> size_t get_serialized_size(const T& object) {
+    SerializerSizeCounter ssc;
+    ssc & object;
+    return ssc.m_Counter.m_Value;
+}
+
 /// Deserializer from static buffer
 class Deserializer {
 public:
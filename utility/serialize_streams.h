@@ -24,9 +24,8 @@ namespace beam { namespace detail {
 struct SerializeOstream {
     size_t write(const void *ptr, const size_t size) {
         if (size > 0) {
-            size_t n = m_vec.size();
-            m_vec.resize(n + size);
-            memcpy(&m_vec.at(n), ptr, size);
+            const uint8_t* p = (const uint8_t*)ptr;
+            m_vec.insert(m_vec.end(), p, p + size);
         }
         return size;
     }
@@ -35,6 +34,10 @@ struct SerializeOstream {
         m_vec.clear();
     }
 
+    void reserve(size_t size) {
+        m_vec.reserve(size);
+    }
+
     std::vector<uint8_t> m_vec;
 };
 
@@ -16,6 +16,7 @@
 #include <chrono>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #ifndef WIN32
 #	include <unistd.h>
@@ -54,6 +55,16 @@ private:
     uint64_t elapsed;
 };
 
+// Benchmarks in the tests are opt-in: they're run only if the test is started with --benchmark
+inline bool IsBenchmarkRequested(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+		if (!strcmp(argv[i], "--benchmark"))
+			return true;
+
+	return false;
+}
+
 // Used in tests, to prevent parallel execution of overlapping tests
 inline bool ProcessWideLock(const char* szFilePath)
 {
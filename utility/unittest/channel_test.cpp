@@ -13,8 +13,10 @@
 // limitations under the License.
 
 #include "utility/message_queue.h"
+#include "utility/test_helpers.h"
 #include <future>
 #include <iostream>
+#include <thread>
 #include <assert.h>
 
 using namespace std;
@@ -47,8 +49,8 @@ struct SomeAsyncObject {
     void wait() { f.get(); }
 };
 
-struct RXThread : SomeAsyncObject {
-    RX<Message> rx;
+template <class Queue> struct RXThread : SomeAsyncObject {
+    RX<Message, Queue> rx;
     std::vector<int> received;
 
     RXThread() :
@@ -69,9 +71,9 @@ struct RXThread : SomeAsyncObject {
     {}
 };
 
-void simplex_channel_test() {
-    RXThread remote;
-    TX<Message> tx = remote.rx.get_tx();
+template <class Queue> void simplex_channel_test() {
+    RXThread<Queue> remote;
+    TX<Message, Queue> tx = remote.rx.get_tx();
     std::vector<int> sent;
 
     remote.run();
@@ -88,7 +90,80 @@ void simplex_channel_test() {
     assert(remote.received == sent);
 }
 
-int main() {
-    simplex_channel_test();
+struct ProducerMessage {
+    uint32_t producer=0;
+    uint32_t n=0;
+};
+
+/// Several threads send to the same RX concurrently. Checks that nothing is lost or reordered per producer,
+/// and reports the throughput under contention if benchmarking
+template <class Queue> int multi_producer_channel_test(const char* name, uint32_t producers, uint32_t perProducer, bool benchmark) {
+    struct Receiver : SomeAsyncObject {
+        RX<ProducerMessage, Queue> rx;
+        std::vector<uint32_t> lastReceived;
+        uint32_t total=0;
+        uint32_t expected;
+        bool ordered=true;
+
+        Receiver(uint32_t producers, uint32_t perProducer) :
+            rx(
+                reactor,
+                [this](ProducerMessage&& msg) {
+                    uint32_t& last = lastReceived[msg.producer];
+                    if (msg.n != last + 1) ordered = false;
+                    last = msg.n;
+                    if (++total == expected) reactor->stop();
+                }
+            ),
+            lastReceived(producers, 0),
+            expected(producers * perProducer)
+        {}
+    };
+
+    Receiver remote(producers, perProducer);
+    remote.run();
+
+    beam::helpers::StopWatch sw;
+    sw.start();
+
+    std::vector<std::thread> threads;
+    for (uint32_t i=0; i<producers; ++i) {
+        TX<ProducerMessage, Queue> tx = remote.rx.get_tx();
+        threads.emplace_back([tx, i, perProducer]() mutable {
+            for (uint32_t n=1; n<=perProducer; ++n) {
+                tx.send(ProducerMessage { i, n });
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+    remote.wait();
+    sw.stop();
+
+    if (benchmark) {
+        uint64_t us = sw.microseconds();
+        cout << name << ": " << producers << " producers, " << remote.total << " messages, " << us << " us, "
+             << (us ? (uint64_t(remote.total) * 1000000 / us) : 0) << " msg/sec" << endl;
+    }
+
+    if (remote.total != producers * perProducer || !remote.ordered) {
+        cout << name << ": " << producers << " producers, messages lost or reordered" << endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    bool benchmark = beam::helpers::IsBenchmarkRequested(argc, argv);
+
+    simplex_channel_test<MessageQueue<Message>>();
+    simplex_channel_test<LockFreeMessageQueue<Message>>();
+
+    int ret = 0;
+    for (uint32_t producers : { 1, 4, 8 }) {
+        ret |= multi_producer_channel_test<MessageQueue<ProducerMessage>>("mutex", producers, 200000, benchmark);
+        ret |= multi_producer_channel_test<LockFreeMessageQueue<ProducerMessage>>("lock-free", producers, 200000, benchmark);
+    }
+    return ret;
 }
 
@@ -15,6 +15,8 @@
 #include "logger_checkpoints.h"
 #include "helpers.h"
 #include <thread>
+#include <fstream>
+#include <boost/filesystem.hpp>
 #include "wallet/secstring.h"
 
 using namespace beam;
@@ -80,6 +82,143 @@ void test_ndc_2(bool exc)
     }
 }
 
+static size_t tag_header_formatter(char* buf, size_t maxSize, const char*, const LogMessageHeader& header) {
+    return snprintf(buf, maxSize, "%c ", loglevel_tag(header.level));
+}
+
+static const char* ASYNC_LOG_DIR = "logger_test_async";
+
+/// Lines of all the log files written so far, in the order of the files' timestamps
+static std::vector<std::string> read_log_lines() {
+    std::vector<boost::filesystem::path> files;
+    for (const auto& entry : boost::filesystem::directory_iterator(ASYNC_LOG_DIR)) {
+        files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+
+    std::vector<std::string> lines;
+    for (const auto& f : files) {
+        std::ifstream in(f.string());
+        std::string line;
+        while (std::getline(in, line)) {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+/// Messages at the flush level wait for free space in the ring, none of them is lost or reordered per thread
+int test_async_logger_order() {
+    static const int THREADS = 4;
+    static const int MESSAGES = 1000;
+
+    boost::filesystem::remove_all(ASYNC_LOG_DIR);
+    {
+        auto logger = Logger::create(LOG_LEVEL_WARNING, LOG_SINK_DISABLED, LOG_LEVEL_DEBUG, "async_", ASYNC_LOG_DIR, 64);
+        logger->set_header_formatter(tag_header_formatter);
+        logger->set_time_format(nullptr, false);
+
+        std::vector<std::thread> threads;
+        for (int t=0; t<THREADS; ++t) {
+            threads.emplace_back([t]() {
+                for (int i=0; i<MESSAGES; ++i) {
+                    LOG_WARNING() << "thread " << t << " message " << i;
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+
+        // the writer flushes it without waiting for the shutdown
+        LOG_ERROR() << "flushed";
+        bool flushed = false;
+        for (int i=0; i<500 && !flushed; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            auto lines = read_log_lines();
+            flushed = !lines.empty() && lines.back() == "E flushed";
+        }
+        if (!flushed) {
+            std::cout << "async logger: the records weren't flushed" << std::endl;
+            return 1;
+        }
+    }
+
+    int next[THREADS] = { 0 };
+    for (const auto& line : read_log_lines()) {
+        int t=0, i=0;
+        if (sscanf(line.c_str(), "W thread %d message %d", &t, &i) != 2) {
+            continue;
+        }
+        if (t < 0 || t >= THREADS || i != next[t]) {
+            std::cout << "async logger: unexpected record: " << line << std::endl;
+            return 1;
+        }
+        ++next[t];
+    }
+    for (int t=0; t<THREADS; ++t) {
+        if (next[t] != MESSAGES) {
+            std::cout << "async logger: thread " << t << " has " << next[t] << " records" << std::endl;
+            return 1;
+        }
+    }
+
+    boost::filesystem::remove_all(ASYNC_LOG_DIR);
+    return 0;
+}
+
+/// When the ring is full the messages below the flush level are dropped and counted, the rest is written in order
+int test_async_logger_full() {
+    static const int THREADS = 4;
+    static const int MESSAGES = 1000;
+
+    boost::filesystem::remove_all(ASYNC_LOG_DIR);
+    {
+        auto logger = Logger::create(LOG_LEVEL_WARNING, LOG_SINK_DISABLED, LOG_LEVEL_DEBUG, "async_", ASYNC_LOG_DIR, 4);
+        logger->set_header_formatter(tag_header_formatter);
+        logger->set_time_format(nullptr, false);
+
+        std::vector<std::thread> threads;
+        for (int t=0; t<THREADS; ++t) {
+            threads.emplace_back([t]() {
+                for (int i=0; i<MESSAGES; ++i) {
+                    LOG_INFO() << "thread " << t << " message " << i;
+                }
+                LOG_WARNING() << "thread " << t << " done";
+            });
+        }
+
+        logger->rotate(); // performed by the writer thread, between the batches
+        for (auto& t : threads) t.join();
+        // the queue is drained by the logger destructor
+    }
+
+    int written = 0, dropped = 0, done = 0;
+    int last[THREADS];
+    std::fill_n(last, THREADS, -1);
+    for (const auto& line : read_log_lines()) {
+        int t=0, i=0;
+        if (sscanf(line.c_str(), "I thread %d message %d", &t, &i) == 2) {
+            if (t < 0 || t >= THREADS || i <= last[t]) {
+                std::cout << "async logger: unexpected record: " << line << std::endl;
+                return 1;
+            }
+            last[t] = i;
+            ++written;
+        } else if (sscanf(line.c_str(), "W %d log messages dropped", &i) == 1) {
+            dropped += i;
+        } else if (sscanf(line.c_str(), "W thread %d done", &t) == 1) {
+            ++done;
+        }
+    }
+
+    if (written + dropped != THREADS * MESSAGES || done != THREADS) {
+        std::cout << "async logger: " << written << " written, " << dropped << " dropped, " << done << " threads done" << std::endl;
+        return 1;
+    }
+
+    boost::filesystem::remove_all(ASYNC_LOG_DIR);
+    return 0;
+}
+
 void test_read_password() {
     SecString buf;
     read_password("Enter seed: ", buf);
@@ -87,6 +226,7 @@ void test_read_password() {
 }
 
 int main() {
+    int ret = 0;
 #if 0
     test_read_password();
 #else
@@ -97,5 +237,8 @@ int main() {
         test_ndc_2(true);
     }
     catch(...) {}
+    ret |= test_async_logger_order();
+    ret |= test_async_logger_full();
 #endif
+    return ret;
 }
@@ -0,0 +1,130 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "utility/metrics.h"
+#include "nlohmann/json.hpp"
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace beam::metrics;
+
+int buckets_test() {
+    int nErrors = 0;
+    unsigned prev = 0;
+    for (uint64_t v=0; v<(1ull << 20); v += 1 + v / 64) {
+        unsigned i = Histogram::bucket_index(v);
+        uint64_t bound = Histogram::bucket_upper_bound(i);
+        // monotonic, and the value is within its bucket with the relative error below 1/16
+        if (i < prev || bound < v || (bound - v) * Histogram::SUB_BUCKETS > v) {
+            cout << "bucket of " << v << ": " << i << ", bound " << bound << endl;
+            ++nErrors;
+        }
+        prev = i;
+    }
+    if (Histogram::bucket_index(uint64_t(-1)) != Histogram::BUCKETS - 1) {
+        cout << "huge values must be saturated" << endl;
+        ++nErrors;
+    }
+    return nErrors;
+}
+
+int histogram_test() {
+    int nErrors = 0;
+    Histogram h;
+    for (uint64_t v=1; v<=1000; ++v) h.record(v);
+
+    Histogram::Snapshot s = h.snapshot();
+    auto check = [&nErrors](const char* name, uint64_t value, uint64_t expected) {
+        if (value < expected || value > expected + expected / Histogram::SUB_BUCKETS) {
+            cout << name << "=" << value << ", expected " << expected << endl;
+            ++nErrors;
+        }
+    };
+    check("count", s.count, 1000);
+    check("sum", s.sum, 500500);
+    check("max", s.max, 1000);
+    check("p50", s.p50, 500);
+    check("p90", s.p90, 900);
+    check("p99", s.p99, 990);
+    check("p999", s.p999, 999);
+    return nErrors;
+}
+
+int registry_test() {
+    int nErrors = 0;
+    auto expect = [&nErrors](bool ok, const char* what) {
+        if (!ok) {
+            cout << "registry: " << what << endl;
+            ++nErrors;
+        }
+    };
+
+    Registry& r = Registry::get();
+    Counter& c = r.counter("test.counter");
+    expect(&c == &r.counter("test.counter"), "the same name must give the same counter");
+
+    static const int THREADS = 4;
+    static const int N = 100000;
+    Histogram& h = r.histogram("test.latency_us");
+
+    vector<thread> threads;
+    for (int i=0; i<THREADS; ++i) {
+        threads.emplace_back([&c, &h] {
+            for (int j=0; j<N; ++j) {
+                c.add();
+                h.record(j % 100);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    r.gauge("test.gauge").set(-5);
+    r.histogram("test.empty");
+
+    expect(c.get() == THREADS * N, "counter value");
+    expect(h.snapshot().count == THREADS * N, "histogram count");
+
+    // the values are 0..99, evenly
+    const uint64_t sum = uint64_t(THREADS) * N / 100 * 4950;
+
+    string text = r.to_text();
+    expect(text.find("test.counter 400000\n") != string::npos, "counter in text");
+    expect(text.find("test.gauge -5\n") != string::npos, "gauge in text");
+    expect(text.find("test.latency_us count=400000 avg=49 p50=") != string::npos, "histogram in text");
+    expect(text.find("test.empty") == string::npos, "empty histograms are omitted from text");
+
+    nlohmann::json json = nlohmann::json::parse(r.to_json());
+    expect(json["counters"]["test.counter"] == THREADS * N, "counter in json");
+    expect(json["gauges"]["test.gauge"] == -5, "gauge in json");
+
+    const auto& jh = json["histograms"]["test.latency_us"];
+    expect(jh["count"] == THREADS * N, "histogram count in json");
+    expect(jh["sum"] == sum, "histogram sum in json");
+    uint64_t max = jh["max"];
+    expect(max >= 99 && max <= 99 + 99 / Histogram::SUB_BUCKETS, "histogram max in json");
+    uint64_t p50 = jh["p50"];
+    expect(p50 >= 49 && p50 <= 49 + 49 / Histogram::SUB_BUCKETS + 1, "histogram p50 in json");
+    expect(json["histograms"]["test.empty"]["count"] == 0, "empty histogram in json");
+
+    return nErrors;
+}
+
+int main() {
+    int ret = buckets_test();
+    ret |= histogram_test();
+    ret |= registry_test();
+    return ret;
+}
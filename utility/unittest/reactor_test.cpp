@@ -54,6 +54,27 @@ void error_codes_test() {
 #undef XX
 }
 
+bool buffer_pool_test() {
+    BufferPool pool(100000, 2);
+    if (pool.class_size(0) != BufferPool::MIN_SIZE || pool.class_size(5000) != 8192 || pool.class_size(70000) != 100000) return false;
+
+    char* p1 = pool.alloc(8192);
+    char* p2 = pool.alloc(8192);
+    char* p3 = pool.alloc(8192);
+    if (!p1 || !p2 || !p3 || pool.in_use() != 3*8192 || pool.allocated() != 3*8192) return false;
+
+    pool.release(p1, 8192);
+    pool.release(p2, 8192);
+    pool.release(p3, 8192); // exceeds the cache limit
+    if (pool.in_use() != 0 || pool.cached() != 2*8192 || pool.allocated() != 2*8192) return false;
+
+    // reused
+    char* p = pool.alloc(8192);
+    bool reused = (p == p2);
+    pool.release(p, 8192);
+    return reused;
+}
+
 int main() {
     int logLevel = LOG_LEVEL_DEBUG;
 #if LOG_VERBOSE_ENABLED
@@ -62,4 +83,5 @@ int main() {
     auto logger = Logger::create(logLevel, logLevel);
     reactor_start_stop();
     error_codes_test();
+    return buffer_pool_test() ? 0 : 1;
 }
@@ -15,6 +15,7 @@
 #include "utility/io/tcpserver.h"
 #include "utility/io/timer.h"
 #include <assert.h>
+#include <atomic>
 
 #define LOG_VERBOSE_ENABLED 0
 #include "utility/logger.h"
@@ -27,6 +28,7 @@ Reactor::Ptr reactor;
 Timer::Ptr timer;
 
 bool wasAccepted=false;
+std::atomic<bool> wasAcceptedPooled(false);
 
 #ifdef __linux__
     uint32_t serverIp=0x7F222222;
@@ -76,6 +78,47 @@ void tcpserver_test() {
     }
 }
 
+void tcpserver_pool_test() {
+    try {
+        reactor = Reactor::create();
+        ReactorPool::Ptr pool = ReactorPool::create(2);
+        TcpServer::Ptr server = TcpServer::create(
+            reactor,
+            Address(serverIp, serverPort),
+            [&pool](TcpStream::Ptr&& newStream, int errorCode) {
+                // called in the pool's thread
+                if (errorCode == 0) {
+                    LOG_DEBUG() << "Stream accepted in pool, socket=" << newStream->address().str() << " peer=" << newStream->peer_address().str();
+                    assert(newStream);
+                    if ((&Reactor::get_Current() == newStream->reactor()) && (pool->find(newStream->reactor()) < pool->size()))
+                        wasAcceptedPooled = true;
+                } else {
+                    LOG_ERROR() << "Error code=" << errorCode;
+                }
+                reactor->stop();
+            },
+            *pool
+        );
+
+        timer = Timer::create(reactor);
+        timer->start(
+            200,
+            true,
+            on_timer
+        );
+
+        LOG_DEBUG() << "starting reactor...";
+        reactor->run();
+        LOG_DEBUG() << "reactor stopped";
+
+        server.reset();
+        timer.reset();
+    }
+    catch (const std::exception& e) {
+        LOG_ERROR() << e.what();
+    }
+}
+
 int main() {
     int logLevel = LOG_LEVEL_DEBUG;
 #if LOG_VERBOSE_ENABLED
@@ -83,7 +126,8 @@ int main() {
 #endif
     auto logger = Logger::create(logLevel, logLevel);
     tcpserver_test();
-    return wasAccepted ? 0 : 1;
+    tcpserver_pool_test();
+    return (wasAccepted && wasAcceptedPooled) ? 0 : 1;
 }
 
 
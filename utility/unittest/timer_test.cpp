@@ -14,6 +14,9 @@
 
 #include "utility/io/coarsetimer.h"
 #include <set>
+#include <vector>
+#include <memory>
+#include <stdlib.h>
 
 #define LOG_VERBOSE_ENABLED 1
 #include "utility/logger.h"
@@ -97,6 +100,113 @@ void coarsetimer_test() {
     LOG_DEBUG() << "Stopping";
 }
 
+struct WheelEntry : TimerWheel::Entry {
+    uint64_t expected=0;
+    uint64_t firedAt=0;
+    int fired=0;
+
+    void on_timer() override {
+        firedAt = uv_hrtime() / 1000000;
+        ++fired;
+    }
+};
+
+int timerwheel_test() {
+    reactor = Reactor::create();
+    TimerWheel& wheel = reactor->timer_wheel();
+
+    // intervals spread over 2 levels of the wheel
+    std::vector<std::unique_ptr<WheelEntry>> entries(500);
+    uint64_t start = uv_hrtime() / 1000000;
+    for (size_t i=0; i<entries.size(); ++i) {
+        entries[i].reset(new WheelEntry());
+        unsigned interval = (unsigned) (rand() % 700);
+        entries[i]->expected = start + interval;
+        wheel.set(*entries[i], interval);
+    }
+
+    // reset and cancel some
+    for (size_t i=0; i<entries.size(); i+=5) {
+        WheelEntry& e = *entries[i];
+        e.expected = start + 100;
+        wheel.set(e, 100);
+    }
+    for (size_t i=1; i<entries.size(); i+=5) {
+        entries[i]->cancel();
+    }
+    // destroyed while set
+    entries[2].reset();
+
+    // far in the future (level 2), cancelled on the reactor destruction
+    WheelEntry farEntry;
+    wheel.set(farEntry, 3600*1000);
+
+    Timer::Ptr timer = Timer::create(reactor);
+    timer->start(800, false, [] { reactor->stop(); });
+
+    reactor->run();
+
+    int nErrors = 0;
+    if (wheel.size() != 1) {
+        LOG_ERROR() << "timer wheel: unexpected size " << wheel.size();
+        ++nErrors;
+    }
+
+    for (size_t i=0; i<entries.size(); ++i) {
+        if (!entries[i]) continue;
+        const WheelEntry& e = *entries[i];
+        bool shouldFire = (i % 5 != 1);
+        if (e.fired != (shouldFire ? 1 : 0) || e.is_set()) {
+            LOG_ERROR() << "timer wheel: entry " << i << " fired " << e.fired << " times";
+            ++nErrors;
+        } else if (shouldFire && e.firedAt < e.expected) {
+            LOG_ERROR() << "timer wheel: entry " << i << " fired " << e.expected - e.firedAt << " msec too early";
+            ++nErrors;
+        }
+    }
+
+    timer.reset();
+    reactor.reset();
+    if (farEntry.is_set()) {
+        LOG_ERROR() << "timer wheel: entry is set after the wheel destruction";
+        ++nErrors;
+    }
+
+    LOG_INFO() << "timer wheel test: " << nErrors << " errors";
+    return nErrors;
+}
+
+int timerwheel_idle_test() {
+    reactor = Reactor::create();
+    TimerWheel& wheel = reactor->timer_wheel();
+
+    // the wheel gets empty by cancellation, then by expiration, and is refilled after each
+    WheelEntry cancelled, first, second;
+    wheel.set(cancelled, 100);
+    cancelled.cancel();
+    wheel.set(first, 20);
+
+    Timer::Ptr refillTimer = Timer::create(reactor);
+    refillTimer->start(100, false, [&wheel, &second] { wheel.set(second, 20); });
+    Timer::Ptr stopTimer = Timer::create(reactor);
+    stopTimer->start(300, false, [] { reactor->stop(); });
+
+    reactor->run();
+
+    int nErrors = 0;
+    if (cancelled.fired || first.fired != 1 || second.fired != 1 || wheel.size()) {
+        LOG_ERROR() << "timer wheel: fired " << cancelled.fired << " " << first.fired << " " << second.fired << " size " << wheel.size();
+        ++nErrors;
+    }
+
+    refillTimer.reset();
+    stopTimer.reset();
+    reactor.reset();
+
+    LOG_INFO() << "timer wheel idle test: " << nErrors << " errors";
+    return nErrors;
+}
+
 int main() {
     int logLevel = LOG_LEVEL_DEBUG;
 #if LOG_VERBOSE_ENABLED
@@ -105,6 +215,9 @@ int main() {
     auto logger = Logger::create(logLevel, logLevel);
     timer_test();
     coarsetimer_test();
+    int nErrors = timerwheel_test();
+    nErrors += timerwheel_idle_test();
+    return nErrors;
 }
 
 
@@ -0,0 +1,301 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "coin_index.h"
+#include <algorithm>
+
+namespace beam
+{
+    using namespace std;
+
+    CoinIndex::CoinIndex()
+        : m_matureSum{ 0 }
+        , m_height{ 0 }
+        , m_loaded{ false }
+    {
+    }
+
+    void CoinIndex::load(const vector<Coin>& unspent, Height height)
+    {
+        reset();
+        m_loaded = true;
+        m_height = height;
+        for (const auto& coin : unspent)
+        {
+            onChanged(coin);
+        }
+    }
+
+    void CoinIndex::reset()
+    {
+        m_coins.clear();
+        m_mature.clear();
+        m_immature.clear();
+        m_matureSum = 0;
+        m_height = 0;
+        m_loaded = false;
+    }
+
+    void CoinIndex::onChanged(const Coin& coin)
+    {
+        if (!m_loaded)
+        {
+            return;
+        }
+
+        auto it = m_coins.find(coin.m_id);
+        if (it != m_coins.end())
+        {
+            erase(it->second);
+            m_coins.erase(it);
+        }
+
+        if (coin.m_status == Coin::Unspent)
+        {
+            insert(m_coins.emplace(coin.m_id, coin).first->second);
+        }
+    }
+
+    void CoinIndex::onRemoved(uint64_t id)
+    {
+        auto it = m_coins.find(id);
+        if (it != m_coins.end())
+        {
+            erase(it->second);
+            m_coins.erase(it);
+        }
+    }
+
+    void CoinIndex::insert(const Coin& coin)
+    {
+        AmountKey key{ coin.m_amount, coin.m_id };
+        if (coin.m_maturity <= m_height)
+        {
+            m_mature.insert(key);
+            m_matureSum += coin.m_amount;
+        }
+        else
+        {
+            m_immature.emplace(coin.m_maturity, key);
+        }
+    }
+
+    void CoinIndex::erase(const Coin& coin)
+    {
+        AmountKey key{ coin.m_amount, coin.m_id };
+        if (m_mature.erase(key))
+        {
+            m_matureSum -= coin.m_amount;
+            return;
+        }
+
+        auto range = m_immature.equal_range(coin.m_maturity);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == key)
+            {
+                m_immature.erase(it);
+                break;
+            }
+        }
+    }
+
+    void CoinIndex::setHeight(Height height)
+    {
+        if (height < m_height)
+        {
+            // rollback, rare
+            for (auto it = m_mature.begin(); it != m_mature.end(); )
+            {
+                const Coin& coin = m_coins[it->second];
+                if (coin.m_maturity > height)
+                {
+                    m_immature.emplace(coin.m_maturity, *it);
+                    m_matureSum -= coin.m_amount;
+                    it = m_mature.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
+        m_height = height;
+
+        auto itEnd = m_immature.upper_bound(height);
+        for (auto it = m_immature.begin(); it != itEnd; ++it)
+        {
+            m_mature.insert(it->second);
+            m_matureSum += it->second.first;
+        }
+        m_immature.erase(m_immature.begin(), itEnd);
+    }
+
+    Amount CoinIndex::getAvailable(Height height)
+    {
+        setHeight(height);
+        return m_matureSum;
+    }
+
+    vector<Coin> CoinIndex::select(Amount amount, Height height)
+    {
+        vector<Coin> res;
+        if (getAvailable(height) < amount)
+        {
+            return res;
+        }
+
+        // the smallest coin that covers the amount alone
+        auto itSingle = m_mature.lower_bound(AmountKey{ amount, 0 });
+        if (itSingle != m_mature.end() && itSingle->first == amount)
+        {
+            res.push_back(m_coins[itSingle->second]);
+            return res;
+        }
+
+        // sum of the coins below the amount. Walk both sides of the split at once and stop at the shorter one,
+        // the complement is known from the total
+        Amount smallSum = 0;
+        {
+            Amount sumAbove = 0;
+            auto itAbove = itSingle;
+            auto itBelow = make_reverse_iterator(itSingle);
+            while (true)
+            {
+                if (itBelow == m_mature.rend())
+                {
+                    break;
+                }
+                if (itAbove == m_mature.end())
+                {
+                    smallSum = m_matureSum - sumAbove;
+                    break;
+                }
+                smallSum += (itBelow++)->first;
+                sumAbove += (itAbove++)->first;
+            }
+        }
+
+        if (smallSum <= amount)
+        {
+            if (smallSum < amount)
+            {
+                res.push_back(m_coins[itSingle->second]); // can't be the end, the available amount is enough
+                return res;
+            }
+            for (auto it = make_reverse_iterator(itSingle); it != m_mature.rend(); ++it)
+            {
+                res.push_back(m_coins[it->second]);
+            }
+            return res;
+        }
+
+        // branch and bound over the inclusion of the smaller coins, the larger first.
+        // They're fetched from the index as the search advances, usually it doesn't go deep
+        vector<AmountKey> candidates;
+        vector<Amount> prefix(1, 0);
+        auto itNext = make_reverse_iterator(itSingle);
+        auto fetch = [&](size_t i)
+        {
+            while (candidates.size() <= i && itNext != m_mature.rend())
+            {
+                candidates.push_back(*itNext++);
+                prefix.push_back(prefix.back() + candidates.back().first);
+            }
+            return i < candidates.size();
+        };
+
+        bool found = false;
+        Amount bestChange = 0;
+        vector<size_t> best;
+        if (itSingle != m_mature.end())
+        {
+            found = true;
+            bestChange = itSingle->first - amount;
+        }
+
+        vector<size_t> current;
+        Amount sum = 0;
+        size_t i = 0;
+        for (size_t tries = 0; tries < MaxTries; ++tries)
+        {
+            bool backtrack = false;
+            if (sum >= amount)
+            {
+                Amount change = sum - amount;
+                size_t bestCount = best.empty() ? 1 : best.size();
+                if (!found || change < bestChange || (change == bestChange && current.size() < bestCount))
+                {
+                    found = true;
+                    bestChange = change;
+                    best = current;
+                }
+                backtrack = true; // adding more coins only increases the change
+            }
+            else if (!fetch(i) || sum + smallSum - prefix[i] < amount)
+            {
+                backtrack = true; // the rest is not enough
+            }
+            else if (found && !bestChange && current.size() + 1 >= (best.empty() ? 1 : best.size()))
+            {
+                backtrack = true; // exact match with less inputs is known
+            }
+
+            if (!backtrack)
+            {
+                current.push_back(i);
+                sum += candidates[i].first;
+                ++i;
+                continue;
+            }
+
+            if (current.empty())
+            {
+                break; // all the branches are visited
+            }
+
+            // exclude the last included coin. Coins of the same amount would give the same sums, skip them
+            size_t j = current.back();
+            current.pop_back();
+            sum -= candidates[j].first;
+            for (i = j + 1; fetch(i) && candidates[i].first == candidates[j].first; ++i)
+            {
+            }
+        }
+
+        if (!found)
+        {
+            // the search was cut before any combination reached the amount. Largest first
+            for (sum = 0, i = 0; sum < amount && fetch(i); ++i)
+            {
+                best.push_back(i);
+                sum += candidates[i].first;
+            }
+        }
+
+        if (best.empty())
+        {
+            res.push_back(m_coins[itSingle->second]);
+        }
+        else
+        {
+            for (auto idx : best)
+            {
+                res.push_back(m_coins[candidates[idx].second]);
+            }
+        }
+        return res;
+    }
+}
@@ -0,0 +1,66 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "wallet/wallet_db.h"
+#include <map>
+#include <set>
+#include <unordered_map>
+
+namespace beam
+{
+    /// In-memory index of the unspent coins, ordered by amount and split by maturity.
+    /// The keychain keeps it in sync with the db, so that selecting coins doesn't scan the table
+    class CoinIndex
+    {
+    public:
+        CoinIndex();
+
+        /// The index is built lazily, from the full set of the unspent coins
+        bool isLoaded() const { return m_loaded; }
+        void load(const std::vector<Coin>& unspent, Height height);
+        void reset();
+
+        /// Coin inserted or modified. It's kept only if it's unspent
+        void onChanged(const Coin& coin);
+        void onRemoved(uint64_t id);
+
+        size_t size() const { return m_coins.size(); }
+
+        /// Sum of the coins spendable at the given height
+        Amount getAvailable(Height height);
+
+        /// Picks the coins with the least change, then with the least number of inputs.
+        /// Single coin which covers the amount competes with the combinations of the smaller ones (branch and bound).
+        /// Returns empty vector if the available amount is not enough
+        std::vector<Coin> select(Amount amount, Height height);
+
+        static constexpr size_t MaxTries = 100000; // bound of the search, the best combination found so far is used then
+
+    private:
+        using AmountKey = std::pair<Amount, uint64_t>;
+
+        void insert(const Coin& coin);
+        void erase(const Coin& coin);
+        void setHeight(Height height);
+
+        std::unordered_map<uint64_t, Coin> m_coins;
+        std::set<AmountKey> m_mature; // maturity <= m_height
+        std::multimap<Height, AmountKey> m_immature;
+        Amount m_matureSum;
+        Height m_height;
+        bool m_loaded;
+    };
+}
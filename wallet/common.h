@@ -194,6 +194,8 @@ namespace beam
             SERIALIZE(m_from, m_txId);
         };
 
+        class ProofPool;
+
         struct INegotiatorGateway
         {
             virtual ~INegotiatorGateway() {}
@@ -204,6 +206,7 @@ namespace beam
             virtual void send_tx_confirmation(const TxDescription&, ConfirmInvitation&&) = 0;
             virtual void register_tx(const TxDescription&, Transaction::Ptr) = 0;
             virtual void send_tx_registered(const TxDescription&) = 0;
+            virtual ProofPool* get_proof_pool() = 0; // may be null
         };
     }
 }
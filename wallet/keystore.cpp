@@ -1,7 +1,12 @@
 #include "keystore.h"
 #include "core/proto.h"
 #include <boost/filesystem.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 #include <stdio.h>
 
 namespace beam {
@@ -141,6 +146,94 @@ void write_keystore_file(const KeyPairs& in, const std::string& fileName, const
     boost::filesystem::rename(newFileName, fileName);
 }
 
+/// Runs the same job over [0, n) on several threads, stops at the first index the job succeeds for.
+/// Threads are spawned on first use. Not reentrant, supposed to be called from a single thread
+class TrialPool {
+public:
+    using Job = std::function<bool(size_t)>;
+
+    ~TrialPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cvJob.notify_all();
+        for (auto& t : _threads) {
+            t.join();
+        }
+    }
+
+    /// Returns the index the job succeeded for, or -1
+    int find(size_t n, const Job& job) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_threads.empty()) {
+                unsigned nThreads = std::thread::hardware_concurrency();
+                if (nThreads > MAX_THREADS) nThreads = MAX_THREADS;
+                for (unsigned i=1; i<nThreads; ++i) { // the caller is also a worker
+                    _threads.emplace_back(&TrialPool::thread_func, this);
+                }
+            }
+            _job = &job;
+            _n = n;
+            _next = 0;
+            _found = -1;
+            _running = _threads.size();
+            ++_generation;
+        }
+        _cvJob.notify_all();
+
+        work();
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cvDone.wait(lock, [this] { return !_running; });
+        _job = 0;
+        return _found;
+    }
+
+    static constexpr unsigned MAX_THREADS = 4;
+
+private:
+    void work() {
+        while (_found < 0) {
+            size_t i = _next.fetch_add(1);
+            if (i >= _n) break;
+            if ((*_job)(i)) {
+                int expected = -1;
+                _found.compare_exchange_strong(expected, int(i));
+            }
+        }
+    }
+
+    void thread_func() {
+        uint64_t generation = 0;
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            _cvJob.wait(lock, [&] { return _stop || _generation != generation; });
+            if (_stop) return;
+            generation = _generation;
+
+            lock.unlock();
+            work();
+            lock.lock();
+
+            if (!--_running) _cvDone.notify_one();
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _cvJob;
+    std::condition_variable _cvDone;
+    std::vector<std::thread> _threads;
+    const Job* _job=0;
+    size_t _n=0;
+    std::atomic<size_t> _next{0};
+    std::atomic<int> _found{-1};
+    size_t _running=0;
+    uint64_t _generation=0;
+    bool _stop=false;
+};
+
 } //namespace
 
 class LocalFileKeystore : public IKeyStore {
@@ -264,12 +357,58 @@ private:
         }
         out = &buffer.at(0);
         size = buffer.size();
-        return proto::BbsDecrypt(out, size, (PrivKey&)it->second.V);
+        return proto::BbsDecrypt(out, size, it->second.V);
+    }
+
+    int decrypt_any(uint8_t*& out, uint32_t& size, ByteBuffer& buffer, const std::vector<PubKey>& pubKeys) override {
+        if (buffer.empty()) {
+            return -1;
+        }
+
+        std::vector<std::pair<int, const PrivKey*>> candidates;
+        for (size_t i=0; i<pubKeys.size(); ++i) {
+            auto it = _keyPairs.find(pubKeys[i]);
+            if (it != _keyPairs.end()) {
+                candidates.emplace_back(int(i), &it->second.V);
+            }
+        }
+
+        // each trial costs a DH, the tag rejects the wrong keys right after it
+        if (candidates.size() < PARALLEL_TRIALS_MIN) {
+            for (const auto& c : candidates) {
+                out = &buffer.at(0);
+                size = uint32_t(buffer.size());
+                if (proto::BbsDecrypt(out, size, *c.second)) {
+                    return c.first;
+                }
+            }
+            return -1;
+        }
+
+        const uint8_t* p = &buffer.at(0);
+        uint32_t n = uint32_t(buffer.size());
+        int found = _trialPool.find(candidates.size(), [&](size_t i) {
+            return proto::BbsCheck(p, n, *candidates[i].second);
+        });
+        if (found < 0) {
+            return -1;
+        }
+
+        // the buffer is modified only here, after all the trials are over
+        out = &buffer.at(0);
+        size = n;
+        if (!proto::BbsDecrypt(out, size, *candidates[found].second)) {
+            return -1;
+        }
+        return candidates[found].first;
     }
 
+    static constexpr size_t PARALLEL_TRIALS_MIN = 4;
+
     std::string _fileName;
     KeyPairs _keyPairs;
     KeyPairs _unsaved;
+    TrialPool _trialPool;
 
     // TODO: use locked in memory secure buffer
     PasswordHash _pass;
@@ -68,6 +68,10 @@ struct IKeyStore {
     /// In-place decrypts the message given in buffer using private key associated with pubKey.
     /// Returns false if private key is missing for pubKey or decription process fails
     virtual bool decrypt(uint8_t*& out, uint32_t& size, ByteBuffer& buffer, const PubKey& pubKey) = 0;
+
+    /// Tries the keys (in parallel if there are many of them) and in-place decrypts the message with the matching one.
+    /// Returns the index of the key in pubKeys, or -1 if none fits. The buffer is left intact on failure
+    virtual int decrypt_any(uint8_t*& out, uint32_t& size, ByteBuffer& buffer, const std::vector<PubKey>& pubKeys) = 0;
 };
 
 } //namespace
@@ -15,6 +15,9 @@
 #include "negotiator.h"
 #include "core/block_crypt.h"
 #include "wallet/wallet_serialization.h"
+#include "wallet/proof_pool.h"
+#include <algorithm>
+#include <thread>
 
 namespace beam::wallet
 {
@@ -63,6 +66,7 @@ namespace beam::wallet
 
     Negotiator::FSMDefinition::FSMDefinition(Negotiator& parent)
         : m_parent{ parent }
+        , m_deferInvite{ false }
     {
         m_blindingExcess = Zero;
     }
@@ -92,10 +96,18 @@ namespace beam::wallet
         }
 
         update_tx_description(TxDescription::InProgress);
-        sendInvite();
+        if (!m_deferInvite)
+        {
+            sendInvite();
+        }
     }
 
     void Negotiator::FSMDefinition::sendInvite() const
+    {
+        sendInvite(getTxOutputs(m_parent.m_txDesc.m_txId));
+    }
+
+    void Negotiator::FSMDefinition::sendInvite(vector<Output::Ptr>&& outputs) const
     {
         bool sender = m_parent.m_txDesc.m_sender;
         Height currentHeight = m_parent.m_txDesc.m_minHeight;
@@ -108,7 +120,7 @@ namespace beam::wallet
         inviteMsg.m_height = currentHeight;
         inviteMsg.m_send = sender;
         inviteMsg.m_inputs = getTxInputs(txID);
-        inviteMsg.m_outputs = getTxOutputs(txID);
+        inviteMsg.m_outputs = move(outputs);
         inviteMsg.m_publicPeerExcess = getPublicExcess();
         inviteMsg.m_publicPeerNonce = getPublicNonce();
         inviteMsg.m_offset = m_offset;
@@ -167,7 +179,13 @@ namespace beam::wallet
         }
         else
         {
-            createOutputUtxo(m_parent.m_txDesc.m_amount, currentHeight);
+            auto coin = createOutputUtxo(m_parent.m_txDesc.m_amount, currentHeight);
+
+            // the output is needed only after the peer's confirmation, its range proof is created meanwhile
+            if (auto pool = m_parent.m_gateway.get_proof_pool())
+            {
+                pool->push(m_parent.m_txDesc.m_txId, coin.m_id, m_parent.m_keychain->calcKey(coin), coin.m_amount);
+            }
         }
 
         LOG_INFO() << "Invitation accepted";
@@ -261,6 +279,10 @@ namespace beam::wallet
     void Negotiator::FSMDefinition::rollbackTx()
     {
         LOG_INFO() << "Transaction failed. Rollback...";
+        if (auto pool = m_parent.m_gateway.get_proof_pool())
+        {
+            pool->discard(m_parent.m_txDesc.m_txId);
+        }
         m_parent.m_keychain->rollbackTx(m_parent.m_txDesc.m_txId);
     }
 
@@ -349,7 +371,7 @@ namespace beam::wallet
 		m_kernel->m_Excess = Zero;
     }
 
-    void Negotiator::FSMDefinition::createOutputUtxo(Amount amount, Height height)
+    Coin Negotiator::FSMDefinition::createOutputUtxo(Amount amount, Height height)
     {
         Coin newUtxo{ amount, Coin::Draft, height };
         newUtxo.m_createTxId = m_parent.m_txDesc.m_txId;
@@ -361,6 +383,7 @@ namespace beam::wallet
         blindingFactor = -privateExcess;
         m_blindingExcess += blindingFactor;
         m_offset += offset;
+        return newUtxo;
     }
 
     bool Negotiator::ProcessInvitation(Invite& inviteMsg)
@@ -502,21 +525,127 @@ namespace beam::wallet
 
     vector<Output::Ptr> Negotiator::FSMDefinition::getTxOutputs(const TxID& txID) const
     {
-        vector<Output::Ptr> outputs;
-        m_parent.m_keychain->visit([this, &txID, &outputs](const Coin& c)->bool
+        auto coins = getTxOutputCoins(txID);
+
+        // take the precomputed ones, if any
+        vector<Output::Ptr> precomputed;
+        if (auto pool = m_parent.m_gateway.get_proof_pool())
         {
-            if (c.m_createTxId == txID && c.m_status == Coin::Draft)
+            for (auto it = coins.begin(); it != coins.end(); )
             {
-                Output::Ptr output = make_unique<Output>();
-                output->m_Coinbase = false;
+                if (auto output = pool->pop(it->m_id))
+                {
+                    precomputed.push_back(move(output));
+                    it = coins.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
 
-                Scalar::Native blindingFactor = m_parent.m_keychain->calcKey(c);
-                output->Create(blindingFactor, c.m_amount);
+        auto outputs = Negotiator::createOutputs(*m_parent.m_keychain, coins);
+        move(precomputed.begin(), precomputed.end(), back_inserter(outputs));
+        return outputs;
+    }
+
+    vector<Coin> Negotiator::FSMDefinition::getTxOutputCoins(const TxID& txID) const
+    {
+        // looked up by the index, the batch initiation calls it for each payment
+        auto coins = m_parent.m_keychain->getCoinsCreatedByTx(txID);
+        coins.erase(remove_if(coins.begin(), coins.end(), [](const Coin& c) { return c.m_status != Coin::Draft; }), coins.end());
+        return coins;
+    }
+
+    vector<Output::Ptr> Negotiator::createOutputs(beam::IKeyChain& keychain, const vector<Coin>& coins)
+    {
+        vector<Output::Ptr> outputs(coins.size());
+        vector<Scalar::Native> blindingFactors(coins.size());
+        for (size_t i = 0; i < coins.size(); ++i)
+        {
+            blindingFactors[i] = keychain.calcKey(coins[i]);
+        }
 
-                outputs.push_back(move(output));
+        auto createRange = [&](size_t i0, size_t i1)
+        {
+            for (size_t i = i0; i < i1; ++i)
+            {
+                outputs[i] = make_unique<Output>();
+                outputs[i]->m_Coinbase = false;
+                outputs[i]->Create(blindingFactors[i], coins[i].m_amount);
             }
-            return true;
-        });
+        };
+
+        // a range proof takes milliseconds, so even a couple of them are worth a thread
+        size_t nThreads = std::min<size_t>({ std::thread::hardware_concurrency(), MaxProofThreads, coins.size() });
+        if (nThreads < 2)
+        {
+            createRange(0, coins.size());
+            return outputs;
+        }
+
+        vector<thread> threads;
+        threads.reserve(nThreads - 1);
+        size_t i0 = 0;
+        for (size_t i = 0; i < nThreads; ++i)
+        {
+            size_t i1 = coins.size() * (i + 1) / nThreads;
+            if (i + 1 < nThreads)
+            {
+                threads.emplace_back(createRange, i0, i1);
+            }
+            else
+            {
+                createRange(i0, i1); // the caller takes the last part
+            }
+            i0 = i1;
+        }
+
+        for (auto& t : threads)
+        {
+            t.join();
+        }
         return outputs;
     }
+
+    void Negotiator::initiate(const vector<Ptr>& negotiators)
+    {
+        if (negotiators.empty())
+        {
+            return;
+        }
+
+        // coins are selected one by one, so that the negotiations don't pick the same ones
+        vector<Negotiator*> invited;
+        vector<Coin> coins;
+        vector<size_t> outputsCount;
+        for (const auto& n : negotiators)
+        {
+            n->start();
+            n->m_fsm.m_deferInvite = true;
+            n->process_event(events::TxInitiated{});
+            n->m_fsm.m_deferInvite = false;
+
+            if (n->m_txDesc.m_status != TxDescription::InProgress)
+            {
+                continue; // failed, i.e. not enough funds
+            }
+
+            auto txCoins = n->m_fsm.getTxOutputCoins(n->m_txDesc.m_txId);
+            outputsCount.push_back(txCoins.size());
+            move(txCoins.begin(), txCoins.end(), back_inserter(coins));
+            invited.push_back(n.get());
+        }
+
+        auto outputs = createOutputs(*negotiators.front()->m_keychain, coins);
+
+        auto it = outputs.begin();
+        for (size_t i = 0; i < invited.size(); ++i)
+        {
+            vector<Output::Ptr> txOutputs(make_move_iterator(it), make_move_iterator(it + outputsCount[i]));
+            it += outputsCount[i];
+            invited[i]->m_fsm.sendInvite(move(txOutputs));
+        }
+    }
 }
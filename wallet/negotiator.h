@@ -72,6 +72,15 @@ namespace beam::wallet
 
 		bool ProcessInvitation(Invite& inviteMsg);
 
+        /// Starts the sender negotiations of a batch payment. Coins are selected for all of them first,
+        /// then the range proofs of all the new outputs are generated at once and the invitations are sent
+        static void initiate(const std::vector<Ptr>& negotiators);
+
+        /// Range proofs are generated on several threads, if there are many outputs
+        static std::vector<Output::Ptr> createOutputs(beam::IKeyChain& keychain, const std::vector<Coin>& coins);
+
+        static constexpr size_t MaxProofThreads = 8;
+
         void start()
         {
             m_fsm.start();
@@ -165,6 +174,7 @@ namespace beam::wallet
             void cancelTx(const events::TxCanceled&);
 
             void sendInvite() const;
+            void sendInvite(std::vector<Output::Ptr>&& outputs) const;
             void sendConfirmInvitation() const;
             void sendConfirmTransaction() const;
             void sendNewTransaction() const;
@@ -224,7 +234,7 @@ namespace beam::wallet
             }
 
             void createKernel(Amount fee, Height minHeight);
-            void createOutputUtxo(Amount amount, Height height);
+            Coin createOutputUtxo(Amount amount, Height height);
             ECC::Scalar createSignature() const;
             ECC::Scalar createSignature();
             void createSignature2(ECC::Scalar& partialSignature, ECC::Point& publicNonce, ECC::Scalar& challenge) const;
@@ -234,6 +244,7 @@ namespace beam::wallet
             bool isValidSignature(const ECC::Scalar& peerSignature, const ECC::Point& publicPeerNonce, const ECC::Point& publicPeerExcess) const;
             std::vector<Input::Ptr> getTxInputs(const TxID& txID) const;
             std::vector<Output::Ptr> getTxOutputs(const TxID& txID) const;
+            std::vector<Coin> getTxOutputCoins(const TxID& txID) const;
 			void get_NonceInternal(ECC::Signature::MultiSig&) const;
 
             Negotiator& m_parent;
@@ -245,6 +256,7 @@ namespace beam::wallet
             ECC::Point::Native m_publicPeerNonce;
             Transaction::Ptr m_transaction;
             TxKernel::Ptr m_kernel;
+            bool m_deferInvite; // batch payment, the invitation is sent once the outputs of the whole batch are ready
         };
 
     private:
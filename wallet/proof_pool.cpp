@@ -0,0 +1,142 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "proof_pool.h"
+
+namespace beam::wallet
+{
+    using namespace std;
+
+    ProofPool::ProofPool(size_t threads)
+        : m_maxThreads{ threads }
+        , m_stop{ false }
+    {
+    }
+
+    ProofPool::~ProofPool()
+    {
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cvJob.notify_all();
+        for (auto& t : m_threads)
+        {
+            t.join();
+        }
+    }
+
+    void ProofPool::push(const TxID& txID, uint64_t coinID, const ECC::Scalar::Native& blindingFactor, Amount amount)
+    {
+        auto job = make_shared<Job>();
+        job->m_txID = txID;
+        job->m_blindingFactor = blindingFactor;
+        job->m_amount = amount;
+
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_jobs[coinID] = job;
+            m_queue.push_back(job);
+            if (m_threads.size() < m_maxThreads)
+            {
+                m_threads.emplace_back(&ProofPool::thread_func, this);
+            }
+        }
+        m_cvJob.notify_one();
+    }
+
+    Output::Ptr ProofPool::pop(uint64_t coinID)
+    {
+        JobPtr job;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            auto it = m_jobs.find(coinID);
+            if (it == m_jobs.end())
+            {
+                return Output::Ptr();
+            }
+            job = move(it->second);
+            m_jobs.erase(it);
+
+            if (job->m_started)
+            {
+                m_cvDone.wait(lock, [&job] { return job->m_done; });
+                return move(job->m_output);
+            }
+            job->m_started = true; // the threads skip it
+        }
+
+        create(*job);
+        return move(job->m_output);
+    }
+
+    void ProofPool::discard(const TxID& txID)
+    {
+        // there are as many entries as the negotiations in progress, a scan is fine
+        lock_guard<mutex> lock(m_mutex);
+        for (auto it = m_jobs.begin(); it != m_jobs.end(); )
+        {
+            if (it->second->m_txID == txID)
+            {
+                it->second->m_started = true;
+                it = m_jobs.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    size_t ProofPool::size() const
+    {
+        lock_guard<mutex> lock(m_mutex);
+        return m_jobs.size();
+    }
+
+    void ProofPool::create(Job& job)
+    {
+        job.m_output = make_unique<Output>();
+        job.m_output->m_Coinbase = false;
+        job.m_output->Create(job.m_blindingFactor, job.m_amount);
+    }
+
+    void ProofPool::thread_func()
+    {
+        unique_lock<mutex> lock(m_mutex);
+        while (true)
+        {
+            m_cvJob.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_stop)
+            {
+                return;
+            }
+
+            JobPtr job = move(m_queue.front());
+            m_queue.pop_front();
+            if (job->m_started)
+            {
+                continue; // taken in place or discarded
+            }
+            job->m_started = true;
+
+            lock.unlock();
+            create(*job);
+            lock.lock();
+
+            job->m_done = true;
+            m_cvDone.notify_all();
+        }
+    }
+}
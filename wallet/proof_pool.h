@@ -0,0 +1,74 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "core/block_crypt.h"
+#include "wallet/common.h"
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace beam::wallet
+{
+    /// Creates the outputs (with range proofs) on the background threads, ahead of the time they're needed.
+    /// The receiver knows its output once the invitation is accepted, while the proof is needed only when
+    /// the transaction is assembled, after the peer's confirmation. Threads are spawned on first use
+    class ProofPool
+    {
+    public:
+        explicit ProofPool(size_t threads = DefaultThreads);
+        ~ProofPool();
+
+        void push(const TxID& txID, uint64_t coinID, const ECC::Scalar::Native& blindingFactor, Amount amount);
+
+        /// Takes the output of the coin. Waits if it's being created, or creates it in place if it's still queued.
+        /// Returns null if the coin was not pushed
+        Output::Ptr pop(uint64_t coinID);
+
+        /// The transaction is over, the outputs that weren't taken are not needed anymore
+        void discard(const TxID& txID);
+
+        size_t size() const;
+
+        static constexpr size_t DefaultThreads = 2;
+
+    private:
+        struct Job
+        {
+            TxID m_txID;
+            ECC::Scalar::Native m_blindingFactor;
+            Amount m_amount;
+            Output::Ptr m_output;
+            bool m_started = false;
+            bool m_done = false;
+        };
+        using JobPtr = std::shared_ptr<Job>;
+
+        static void create(Job& job);
+        void thread_func();
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cvJob;
+        std::condition_variable m_cvDone;
+        std::map<uint64_t, JobPtr> m_jobs;
+        std::deque<JobPtr> m_queue;
+        std::vector<std::thread> m_threads;
+        size_t m_maxThreads;
+        bool m_stop;
+    };
+}
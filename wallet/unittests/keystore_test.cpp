@@ -138,6 +138,70 @@ int keystore_test_normal() {
     return 0;
 }
 
+int keystore_test_decrypt_any() {
+    KeystoreCleanup c;
+
+    static const char DATA[] = "decrypt_any";
+
+    using namespace beam;
+
+    IKeyStore::Options options;
+    options.flags = IKeyStore::Options::local_file | IKeyStore::Options::enable_all_keys;
+    options.fileName = KEYSTORE_FILE;
+    IKeyStore::Ptr ks = IKeyStore::create(options, PASSWORD, sizeof(PASSWORD));
+
+    // enough keys to involve the worker threads
+    std::vector<PubKey> keys(20);
+    for (auto& k : keys) {
+        ks->gen_keypair(k);
+        ks->save_keypair(k, true);
+    }
+
+    PubKey unknown;
+    ks->gen_keypair(unknown);
+
+    for (size_t nKeys : { size_t(2), keys.size() }) {
+        std::vector<PubKey> tried(keys.begin(), keys.begin() + nKeys);
+        tried.insert(tried.begin(), unknown);
+
+        for (size_t i=0; i<tried.size(); ++i) {
+            ByteBuffer buf;
+            if (!ks->encrypt(buf, DATA, sizeof(DATA), tried[i])) {
+                LOG_ERROR() << "cannot encrypt";
+                return 1;
+            }
+            ByteBuffer original = buf;
+
+            uint8_t* out=0;
+            uint32_t size=0;
+            int res = ks->decrypt_any(out, size, buf, tried);
+            if (i == 0) {
+                // not saved, hence the private key is unknown
+                if (res != -1 || buf != original) {
+                    LOG_ERROR() << "decrypt_any with unknown key, res=" << res;
+                    return 1;
+                }
+                continue;
+            }
+            if (res != int(i) || size != sizeof(DATA) || memcmp(DATA, out, sizeof(DATA)) != 0) {
+                LOG_ERROR() << "decrypt_any failed, res=" << res << " expected=" << i;
+                return 1;
+            }
+
+            // not addressed to any of the keys
+            std::vector<PubKey> others(tried);
+            others.erase(others.begin() + i);
+            if (ks->decrypt_any(out, size, original, others) != -1) {
+                LOG_ERROR() << "decrypt_any with wrong keys returned success";
+                return 1;
+            }
+        }
+    }
+
+    LOG_INFO() << __FUNCTION__ << " ok";
+    return 0;
+}
+
 int main() {
     using namespace beam;
 
@@ -148,6 +212,7 @@ int main() {
 
     try {
         ret += keystore_test_normal();
+        ret += keystore_test_decrypt_any();
     } catch (const std::exception& e) {
         LOG_ERROR() << e.what();
         ret = 255;
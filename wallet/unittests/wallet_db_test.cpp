@@ -18,8 +18,10 @@
 #include "utility/test_helpers.h"
 
 #include "utility/logger.h"
+#include "sqlite/sqlite3.h"
 #include <boost/filesystem.hpp>
 #include <numeric>
+#include <random>
 
 using namespace std;
 using namespace ECC;
@@ -714,6 +716,380 @@ void TestSelect()
     }
 }
 
+void TestSelectMaturity()
+{
+    auto db = createSqliteKeychain();
+    Coin immature{ 10, Coin::Unspent, 1, 200, KeyType::Regular, 5 };
+    db->store(immature);
+    Coin mature{ 3, Coin::Unspent, 1, 10, KeyType::Regular, 5 };
+    db->store(mature);
+
+    WALLET_CHECK(db->selectCoins(5, false).empty());
+    auto coins = db->selectCoins(3, false);
+    WALLET_CHECK(coins.size() == 1 && coins[0].m_id == mature.m_id);
+
+    Block::SystemState::ID id = {};
+    id.m_Height = 200;
+    db->setSystemStateID(id);
+    coins = db->selectCoins(5, false);
+    WALLET_CHECK(coins.size() == 1 && coins[0].m_id == immature.m_id);
+
+    // back to the lower height
+    id.m_Height = 134;
+    db->setSystemStateID(id);
+    WALLET_CHECK(db->selectCoins(5, false).empty());
+
+    // locked coins leave the index
+    coins = db->selectCoins(3);
+    WALLET_CHECK(coins.size() == 1 && coins[0].m_status == Coin::Locked);
+    WALLET_CHECK(db->selectCoins(3, false).empty());
+
+    // confirmations are rolled back, nothing is spendable
+    db->rollbackConfirmedUtxo(0);
+    WALLET_CHECK(db->selectCoins(1, false).empty());
+}
+
+void TestSelectFromIndex()
+{
+    auto db = createSqliteKeychain();
+    const size_t CoinsCount = 100000;
+    vector<Coin> t;
+    t.reserve(CoinsCount);
+    std::mt19937 rnd(1);
+    for (size_t i = 0; i < CoinsCount; ++i)
+    {
+        t.emplace_back(1 + rnd() % 1000000, Coin::Unspent, 1, 10, KeyType::Regular);
+    }
+    db->store(t);
+
+    auto coins = db->selectCoins(5000000, false); // builds the index
+    WALLET_CHECK(!coins.empty());
+
+    const int SelectsCount = 100;
+    for (int i = 0; i < SelectsCount; ++i)
+    {
+        Amount amount = 1 + rnd() % 50000000;
+        coins = db->selectCoins(amount, false);
+        auto sum = accumulate(coins.begin(), coins.end(), Amount(0), [](const auto& left, const auto& right) {return left + right.m_amount; });
+        WALLET_CHECK(sum >= amount);
+    }
+}
+
+// Opt-in: the index vs. the queries the former sql path ran on each selection. Its DP selector isn't included,
+// so the sql path timing is only a lower bound
+void BenchmarkSelect()
+{
+    auto db = createSqliteKeychain();
+    const size_t CoinsCount = 100000;
+    vector<Coin> t;
+    t.reserve(CoinsCount);
+    std::mt19937 rnd(1);
+    for (size_t i = 0; i < CoinsCount; ++i)
+    {
+        t.emplace_back(1 + rnd() % 1000000, Coin::Unspent, 1, 10, KeyType::Regular);
+    }
+    db->store(t);
+
+    const int SelectsCount = 100;
+    vector<Amount> amounts(SelectsCount);
+    for (auto& amount : amounts)
+    {
+        amount = 1 + rnd() % 50000000;
+    }
+
+    helpers::StopWatch sw;
+    sw.start();
+    db->selectCoins(5000000, false); // builds the index
+    sw.stop();
+    cout << "BenchmarkSelect first select (db scan): " << sw.milliseconds() << " ms\n";
+
+    sw.start();
+    for (Amount amount : amounts)
+    {
+        db->selectCoins(amount, false);
+    }
+    sw.stop();
+    cout << "BenchmarkSelect " << SelectsCount << " selects from the index: " << sw.milliseconds() << " ms\n";
+
+    sqlite3* sql = nullptr;
+    WALLET_CHECK(sqlite3_open_v2("wallet.db", &sql, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK);
+    WALLET_CHECK(sqlite3_key(sql, "pass123", 7) == SQLITE_OK);
+
+    auto query = [sql](const char* text, Amount amount)
+    {
+        sqlite3_stmt* stm = nullptr;
+        WALLET_CHECK(sqlite3_prepare_v2(sql, text, -1, &stm, NULL) == SQLITE_OK);
+        sqlite3_bind_int64(stm, 1, Coin::Unspent);
+        sqlite3_bind_int64(stm, 2, 134);
+        if (sqlite3_bind_parameter_count(stm) > 2)
+        {
+            sqlite3_bind_int64(stm, 3, amount);
+        }
+        size_t rows = 0;
+        while (sqlite3_step(stm) == SQLITE_ROW)
+        {
+            for (int i = 0; i < sqlite3_column_count(stm); ++i)
+            {
+                sqlite3_column_blob(stm, i);
+            }
+            ++rows;
+        }
+        sqlite3_finalize(stm);
+        return rows;
+    };
+
+    sw.start();
+    for (Amount amount : amounts)
+    {
+        query("SELECT SUM(amount) FROM storage WHERE status=?1 AND maturity<=?2;", amount);
+        query("SELECT * FROM storage WHERE status=?1 AND maturity<=?2 AND amount>=?3 ORDER BY amount ASC LIMIT 1;", amount);
+        query("SELECT * FROM storage WHERE status=?1 AND maturity<=?2 AND amount<?3 ORDER BY amount DESC;", amount);
+    }
+    sw.stop();
+    cout << "BenchmarkSelect " << SelectsCount << " selects by the sql queries: " << sw.milliseconds() << " ms\n";
+
+    sqlite3_close(sql);
+}
+
+void TestBulkCoins()
+{
+    struct Observer : IKeyChainObserver
+    {
+        void onKeychainChanged() override { ++m_changes; }
+        void onTransactionChanged(ChangeAction, const vector<TxDescription>&) override {}
+        void onSystemStateChanged() override {}
+        void onTxPeerChanged() override {}
+        void onAddressChanged() override {}
+        int m_changes = 0;
+    };
+
+    auto db = createSqliteKeychain();
+    Observer observer;
+    db->subscribe(&observer);
+
+    const size_t CoinsCount = 20000;
+    vector<Coin> coins;
+    coins.reserve(CoinsCount);
+    for (size_t i = 0; i < CoinsCount; ++i)
+    {
+        coins.emplace_back(i + 1, Coin::Unconfirmed, 1, 10, KeyType::Regular);
+    }
+
+    db->store(coins);
+    WALLET_CHECK(observer.m_changes == 1);
+    for (size_t i = 0; i < CoinsCount; ++i)
+    {
+        WALLET_CHECK(coins[i].m_id == i + 1);
+    }
+
+    for (auto& coin : coins)
+    {
+        coin.m_status = Coin::Unspent;
+        coin.m_confirmHeight = 5;
+    }
+    db->update(coins);
+    WALLET_CHECK(observer.m_changes == 2);
+    WALLET_CHECK(wallet::getTotal(db, Coin::Unspent) == CoinsCount * (CoinsCount + 1) / 2);
+
+    // reward coins are still unique per height within the batch
+    vector<Coin> rewards{ Coin{ 5, Coin::Unspent, 20, 30, KeyType::Coinbase }, Coin{ 5, Coin::Unspent, 20, 30, KeyType::Coinbase } };
+    db->store(rewards);
+    WALLET_CHECK(rewards[0].m_id == CoinsCount + 1 && rewards[1].m_id == 0);
+    WALLET_CHECK(observer.m_changes == 3);
+    db->store(rewards[1]);
+    WALLET_CHECK(observer.m_changes == 3);
+
+    coins.resize(CoinsCount / 2);
+    db->remove(coins);
+    WALLET_CHECK(observer.m_changes == 4);
+
+    size_t count = 0;
+    db->visit([&count](const Coin& coin)
+    {
+        ++count;
+        return true;
+    });
+    WALLET_CHECK(count == CoinsCount / 2 + 1);
+
+    db->unsubscribe(&observer);
+}
+
+// Opt-in: the batch writes vs. the same coins written one by one, each in its own transaction
+void BenchmarkBulkCoins()
+{
+    const size_t CoinsCount = 20000;
+    for (bool batch : { false, true })
+    {
+        auto db = createSqliteKeychain();
+        const char* name = batch ? "batch" : "one by one";
+
+        vector<Coin> coins;
+        coins.reserve(CoinsCount);
+        for (size_t i = 0; i < CoinsCount; ++i)
+        {
+            coins.emplace_back(i + 1, Coin::Unconfirmed, 1, 10, KeyType::Regular);
+        }
+
+        helpers::StopWatch sw;
+        sw.start();
+        if (batch)
+        {
+            db->store(coins);
+        }
+        else
+        {
+            for (auto& coin : coins)
+            {
+                db->store(coin);
+            }
+        }
+        sw.stop();
+        cout << "BenchmarkBulkCoins " << name << ", store " << CoinsCount << " coins: " << sw.milliseconds() << " ms\n";
+
+        for (auto& coin : coins)
+        {
+            coin.m_status = Coin::Unspent;
+            coin.m_confirmHeight = 5;
+        }
+        sw.start();
+        if (batch)
+        {
+            db->update(coins);
+        }
+        else
+        {
+            for (const auto& coin : coins)
+            {
+                db->update(coin);
+            }
+        }
+        sw.stop();
+        cout << "BenchmarkBulkCoins " << name << ", update " << CoinsCount << " coins: " << sw.milliseconds() << " ms\n";
+
+        coins.resize(CoinsCount / 2);
+        sw.start();
+        if (batch)
+        {
+            db->remove(coins);
+        }
+        else
+        {
+            for (const auto& coin : coins)
+            {
+                db->remove(coin);
+            }
+        }
+        sw.stop();
+        cout << "BenchmarkBulkCoins " << name << ", remove " << coins.size() << " coins: " << sw.milliseconds() << " ms\n";
+        WALLET_CHECK(wallet::getTotal(db, Coin::Unspent) == CoinsCount * (CoinsCount + 1) / 2 - coins.size() * (coins.size() + 1) / 2);
+    }
+}
+
+void TestTxHistoryQuery()
+{
+    struct Observer : IKeyChainObserver
+    {
+        void onKeychainChanged() override {}
+        void onTransactionChanged(ChangeAction action, const vector<TxDescription>& items) override
+        {
+            m_actions.push_back(action);
+            m_items = items;
+        }
+        void onSystemStateChanged() override {}
+        void onTxPeerChanged() override {}
+        void onAddressChanged() override {}
+        vector<ChangeAction> m_actions;
+        vector<TxDescription> m_items;
+    };
+
+    auto db = createSqliteKeychain();
+    Observer observer;
+    db->subscribe(&observer);
+
+    const uint16_t TxCount = 2000;
+    const TxDescription::Status statuses[] = { TxDescription::Pending, TxDescription::InProgress, TxDescription::Completed };
+    for (uint16_t i = 0; i < TxCount; ++i)
+    {
+        TxID id = {};
+        id[0] = uint8_t(i % 3);
+        id[1] = uint8_t(i >> 8);
+        id[2] = uint8_t(i);
+        TxDescription tx{ id, 5, 1, 10, unsigned(i % 4), unsigned(42), {}, Timestamp(1000 + i / 3), true };
+        tx.m_status = statuses[i % 3];
+        db->saveTx(tx);
+    }
+    WALLET_CHECK(observer.m_actions.size() == TxCount && observer.m_actions.back() == ChangeAction::Added);
+    WALLET_CHECK(observer.m_items.size() == 1 && observer.m_items[0].m_createTime == 1000 + (TxCount - 1) / 3);
+
+    // pages continue exactly where the previous ones stopped, in the same order as the offset pages
+    auto all = db->getTxHistory();
+    WALLET_CHECK(all.size() == TxCount);
+    vector<TxDescription> paged;
+    TxHistoryQuery query;
+    query.m_count = 64;
+    while (true)
+    {
+        auto page = db->getTxHistory(query);
+        if (page.empty())
+        {
+            break;
+        }
+        WALLET_CHECK(page.size() <= size_t(query.m_count));
+        paged.insert(paged.end(), page.begin(), page.end());
+        query.continueAfter(page.back());
+    }
+    WALLET_CHECK(paged.size() == TxCount);
+    for (size_t i = 0; i < paged.size() && i < all.size(); ++i)
+    {
+        WALLET_CHECK(paged[i].m_txId == all[i].m_txId);
+    }
+
+    // filters
+    query = TxHistoryQuery{};
+    query.m_from = 1100;
+    query.m_to = 1199;
+    query.m_status = TxDescription::Completed;
+    query.m_count = 1000;
+    auto t = db->getTxHistory(query);
+    WALLET_CHECK(t.size() == 100);
+    for (const auto& tx : t)
+    {
+        WALLET_CHECK(tx.m_status == TxDescription::Completed && tx.m_createTime >= 1100 && tx.m_createTime <= 1199);
+    }
+    WALLET_CHECK(t.front().m_createTime == 1199 && t.back().m_createTime == 1100);
+
+    query = TxHistoryQuery{};
+    query.m_peerId = unsigned(1);
+    query.m_count = TxCount;
+    t = db->getTxHistory(query);
+    WALLET_CHECK(t.size() == TxCount / 4);
+    for (const auto& tx : t)
+    {
+        WALLET_CHECK(tx.m_peerId == query.m_peerId);
+    }
+
+    // the change feed carries only the modified rows
+    auto tx = all[10];
+    tx.m_status = TxDescription::Failed;
+    tx.m_amount = 1; // not updated
+    db->saveTx(tx);
+    WALLET_CHECK(observer.m_actions.back() == ChangeAction::Updated);
+    WALLET_CHECK(observer.m_items.size() == 1 && observer.m_items[0].m_txId == tx.m_txId && observer.m_items[0].m_status == TxDescription::Failed);
+    WALLET_CHECK(observer.m_items[0].m_amount == 5);
+
+    db->deleteTx(tx.m_txId);
+    WALLET_CHECK(observer.m_actions.back() == ChangeAction::Removed);
+    WALLET_CHECK(observer.m_items.size() == 1 && observer.m_items[0].m_txId == tx.m_txId);
+    auto actionsCount = observer.m_actions.size();
+    db->deleteTx(tx.m_txId);
+    WALLET_CHECK(observer.m_actions.size() == actionsCount);
+
+    db->clear();
+    WALLET_CHECK(observer.m_actions.back() == ChangeAction::Reset);
+
+    db->unsubscribe(&observer);
+}
+
 void TestSelect2()
 {
     auto db = createSqliteKeychain();
@@ -739,7 +1115,7 @@ void TestSelect2()
     WALLET_CHECK(coins[0].m_amount == 30000000);
 }
 
-int main() 
+int main(int argc, char* argv[])
 {
     int logLevel = LOG_LEVEL_DEBUG;
 #if LOG_VERBOSE_ENABLED
@@ -755,8 +1131,18 @@ int main()
     TestRollback();
     TestPeers();
     TestSelect();
+    TestSelectMaturity();
+    TestSelectFromIndex();
+    TestBulkCoins();
+    TestTxHistoryQuery();
     //TestSelect2();
     TestAddresses();
 
+    if (helpers::IsBenchmarkRequested(argc, argv))
+    {
+        BenchmarkSelect();
+        BenchmarkBulkCoins();
+    }
+
     return WALLET_CHECK_RESULT;
 }
@@ -92,6 +92,7 @@ namespace
         void unsubscribe(IKeyChainObserver* observer) override {}
 
         std::vector<TxDescription> getTxHistory(uint64_t , int ) override { return {}; };
+        std::vector<TxDescription> getTxHistory(const TxHistoryQuery&) override { return {}; };
         boost::optional<TxDescription> getTx(const TxID& ) override { return boost::optional<TxDescription>{}; };
         void saveTx(const TxDescription &) override {};
         void deleteTx(const TxID& ) override {};
@@ -244,6 +245,11 @@ namespace
         {
             cout << "sent tx registration completed \n";
         }
+
+        wallet::ProofPool* get_proof_pool() override
+        {
+            return nullptr;
+        }
     };
 
     struct IOLoop
@@ -1214,6 +1220,64 @@ void TestSplitKey()
     WALLET_CHECK(s1 == nonce);
 }
 
+// Reports how long it takes to get the outputs from the pool if benchmarking
+void TestProofPool(bool benchmark)
+{
+    cout << "\nTesting proof pool...\n";
+
+    const uint64_t CoinsCount = 8;
+    vector<Scalar::Native> keys(CoinsCount);
+    for (uint64_t i = 0; i < CoinsCount; ++i)
+    {
+        keys[i] = i + 100;
+    }
+
+    // the last coin is of a failed transaction, the other ones of a completed one
+    TxID completedTx = { 1 };
+    TxID failedTx = { 2 };
+
+    for (size_t threads : { size_t(0), wallet::ProofPool::DefaultThreads })
+    {
+        wallet::ProofPool pool{ threads };
+        for (uint64_t i = 0; i < CoinsCount; ++i)
+        {
+            pool.push(i + 1 < CoinsCount ? completedTx : failedTx, i + 1, keys[i], 10 * (i + 1));
+        }
+        WALLET_CHECK(pool.size() == CoinsCount);
+
+        pool.discard(failedTx);
+        WALLET_CHECK(pool.size() == CoinsCount - 1);
+        WALLET_CHECK(!pool.pop(CoinsCount));
+        WALLET_CHECK(!pool.pop(CoinsCount + 1));
+
+        // meanwhile the peer confirms the transaction
+        this_thread::sleep_for(chrono::milliseconds(500));
+
+        helpers::StopWatch sw;
+        sw.start();
+        for (uint64_t i = 0; i + 2 < CoinsCount; ++i)
+        {
+            auto output = pool.pop(i + 1);
+            WALLET_CHECK(output);
+            WALLET_CHECK(output->m_Commitment == Commitment(keys[i], 10 * (i + 1)));
+            Point::Native comm;
+            WALLET_CHECK(output->IsValid(comm));
+        }
+        sw.stop();
+
+        if (benchmark)
+        {
+            cout << "Outputs taken from the pool with " << threads << " threads, after a pause: " << sw.milliseconds() << " ms\n";
+        }
+
+        // the transaction ends without taking all of its outputs
+        WALLET_CHECK(pool.size() == 1);
+        pool.discard(completedTx);
+        WALLET_CHECK(pool.size() == 0);
+        WALLET_CHECK(!pool.pop(CoinsCount - 1));
+    }
+}
+
 void TestSerializeFSM()
 {
     cout << "\nTesting wallet's fsm serialization...\nsender\n";
@@ -1413,6 +1477,93 @@ void TestRollback(Height branch, Height current, unsigned step = 1)
     mainLoop.run();
 }
 
+// The node reports the locked coins as spent. Their proofs are prefetched while the wallet still looks for the rollback point,
+// then the rollback makes them unconfirmed again, so they must be requested once more
+struct PrefetchRollbackIO : public RollbackIO
+{
+    PrefetchRollbackIO(IOLoop& mainLoop, MiniChainManager& mcm, Height branch, IKeyChain::Ptr keychain)
+        : RollbackIO(mainLoop, mcm, branch, 1)
+        , m_keychain(keychain)
+    {
+    }
+
+    void send_node_message(proto::GetMined&& data) override
+    {
+        if (!m_rolledBack)
+        {
+            // sent when the rollback is done, right before the proofs are requested
+            m_rolledBack = true;
+            m_keychain->visit([this](const Coin& c)
+            {
+                if (c.m_status == Coin::Unconfirmed || c.m_status == Coin::Locked)
+                {
+                    ++m_unconfirmed;
+                }
+                return true;
+            });
+        }
+        RollbackIO::send_node_message(move(data));
+    }
+
+    void send_node_message(proto::GetProofUtxo&& data) override
+    {
+        if (m_rolledBack)
+        {
+            ++m_requestedAfterRollback;
+        }
+        else
+        {
+            ++m_prefetched;
+        }
+        TestNetwork::send_node_message(move(data));
+    }
+
+    IKeyChain::Ptr m_keychain;
+    bool m_rolledBack = false;
+    size_t m_unconfirmed = 0;
+    size_t m_prefetched = 0;
+    size_t m_requestedAfterRollback = 0;
+};
+
+void TestRollbackPrefetchedProofs(Height branch, Height current)
+{
+    cout << "\nRollback from " << current << " to " << branch << " with prefetched proofs\n";
+    auto db = createSqliteKeychain("wallet.db");
+
+    MiniChainManager mcmOld, mcmNew;
+
+    for (Height i = Rules::HeightGenesis; i <= current; ++i)
+    {
+        mcmOld.Add();
+
+        if (i == branch)
+            mcmNew.m_hvLive = 1U; // branching
+        mcmNew.Add();
+
+        Coin coin1 = { 5, Coin::Locked, 0, 0, KeyType::Regular, i };
+        mcmOld.m_Hdr.get_Hash(coin1.m_confirmHash);
+
+        db->store(coin1);
+    }
+
+    Block::SystemState::ID id;
+    mcmOld.m_Hdr.get_ID(id);
+    db->setSystemStateID(id);
+
+    IOLoop mainLoop;
+    auto network = make_shared<PrefetchRollbackIO>(mainLoop, mcmNew, branch, db);
+
+    Wallet sender(db, network);
+
+    network->registerPeer(&sender, true);
+
+    mainLoop.run();
+
+    WALLET_CHECK(network->m_prefetched == current);
+    WALLET_CHECK(network->m_unconfirmed == current - branch + 1);
+    WALLET_CHECK(network->m_requestedAfterRollback == network->m_unconfirmed);
+}
+
 void TestRollback()
 {
     cout << "\nTesting wallet rollback...\n";
@@ -1436,10 +1587,180 @@ void TestRollback()
     TestRollback(93, 120, 6);
     TestRollback(93, 120, 7);
     TestRollback(99, 100);
+
+    TestRollbackPrefetchedProofs(5, 10);
+    TestRollbackPrefetchedProofs(2, 30);
+}
+
+struct SyncObserver : IWalletObserver
+{
+    SyncObserver(io::Reactor& reactor) : m_reactor(reactor) {}
+
+    void onSyncProgress(int done, int total) override
+    {
+        if (total == 0)
+        {
+            m_reactor.stop();
+        }
+    }
+
+    void onKeychainChanged() override {}
+    void onTransactionChanged(ChangeAction, const vector<TxDescription>&) override {}
+    void onSystemStateChanged() override {}
+    void onTxPeerChanged() override {}
+    void onAddressChanged() override {}
+
+    io::Reactor& m_reactor;
+};
+
+// Reports the time of the separate and of the batch payments if benchmarking
+void TestBatchPayment(bool benchmark)
+{
+    cout << "\nTesting batch payment...\n";
+
+    const size_t PaymentsCount = 16;
+    auto node_address = io::Address::localhost().port(32125);
+    string keystorePass = "123";
+
+    for (bool batch : { false, true })
+    {
+        io::Reactor::Ptr main_reactor{ io::Reactor::create() };
+        io::Reactor::Scope scope(*main_reactor);
+
+        auto senderBbsKeys = createBbsKeystore("sender-bbs", keystorePass);
+        auto receiverBbsKeys = createBbsKeystore("receiver-bbs", keystorePass);
+        WalletID senderID = {};
+        senderBbsKeys->gen_keypair(senderID);
+        senderBbsKeys->save_keypair(senderID, true);
+        WalletID receiverID = {};
+        receiverBbsKeys->gen_keypair(receiverID);
+        receiverBbsKeys->save_keypair(receiverID, true);
+
+        // each payment spends a separate coin and has change
+        auto senderKeychain = createSqliteKeychain("sender_wallet.db");
+        vector<Coin> coins(PaymentsCount, Coin(10));
+        for (auto& coin : coins)
+        {
+            coin.m_maturity = 0;
+        }
+        senderKeychain->store(coins);
+        auto receiverKeychain = createReceiverKeychain();
+
+        TestNode node{ node_address };
+        auto sender_io = make_shared<WalletNetworkIO>(node_address, senderKeychain, senderBbsKeys, main_reactor, 1000, 2000);
+        auto receiver_io = make_shared<WalletNetworkIO>(node_address, receiverKeychain, receiverBbsKeys, main_reactor, 1000, 2000);
+
+        size_t completed = 0;
+        TestWallet sender{ senderKeychain, sender_io, true, [&completed, sender_io](auto)
+        {
+            if (++completed == PaymentsCount)
+            {
+                sender_io->stop();
+            }
+        } };
+        TestWallet receiver{ receiverKeychain, receiver_io, true };
+
+        helpers::StopWatch sw;
+        sw.start();
+        if (batch)
+        {
+            vector<Wallet::Payment> payments(PaymentsCount, Wallet::Payment{ receiverID, 4 });
+            auto txIds = sender.transfer_money(senderID, payments, 1);
+            WALLET_CHECK(txIds.size() == PaymentsCount);
+        }
+        else
+        {
+            for (size_t i = 0; i < PaymentsCount; ++i)
+            {
+                sender.transfer_money(senderID, receiverID, 4, 1);
+            }
+        }
+        main_reactor->run();
+        sw.stop();
+
+        if (benchmark)
+        {
+            cout << PaymentsCount << (batch ? " payments in a batch: " : " separate payments: ") << sw.milliseconds() << " ms\n";
+        }
+
+        WALLET_CHECK(completed == PaymentsCount);
+        WALLET_CHECK(receiver.get_proof_pool()->size() == 0);
+        auto sh = senderKeychain->getTxHistory();
+        WALLET_CHECK(sh.size() == PaymentsCount);
+        for (const auto& tx : sh)
+        {
+            WALLET_CHECK(tx.m_status == TxDescription::Completed);
+            WALLET_CHECK(tx.m_change == 5);
+        }
+
+        size_t received = 0;
+        receiverKeychain->visit([&received](const Coin& c)
+        {
+            if (c.m_amount == 4 && c.m_status == Coin::Unconfirmed)
+            {
+                ++received;
+            }
+            return true;
+        });
+        WALLET_CHECK(received == PaymentsCount);
+    }
 }
 
-int main()
+// Reports the sync time with and without the proofs window if benchmarking
+void TestWindowedSync(bool benchmark)
 {
+    cout << "\nTesting windowed wallet sync...\n";
+
+    const size_t CoinsCount = 1000;
+    auto node_address = io::Address::localhost().port(32125);
+
+    for (size_t window : { size_t(1), Wallet::DefaultProofsWindow })
+    {
+        io::Reactor::Ptr main_reactor{ io::Reactor::create() };
+        io::Reactor::Scope scope(*main_reactor);
+
+        // the test node reports all of them as spent
+        auto keychain = createSqliteKeychain("sync_wallet.db");
+        vector<Coin> coins(CoinsCount, Coin(5, Coin::Locked));
+        keychain->store(coins);
+
+        TestNode node{ node_address };
+        auto io = make_shared<WalletNetworkIO>(node_address, keychain, createBbsKeystore("sync-bbs", "123"), main_reactor, 1000, 2000);
+        TestWallet wallet{ keychain, io };
+        wallet.set_proofs_window(window);
+
+        SyncObserver observer{ *main_reactor };
+        wallet.subscribe(&observer);
+
+        helpers::StopWatch sw;
+        sw.start();
+        main_reactor->run();
+        sw.stop();
+
+        wallet.unsubscribe(&observer);
+
+        if (benchmark)
+        {
+            cout << "Sync of " << CoinsCount << " coins, proofs window=" << window << ": " << sw.milliseconds() << " ms\n";
+        }
+
+        size_t spent = 0;
+        keychain->visit([&spent](const Coin& c)
+        {
+            if (c.m_status == Coin::Spent)
+            {
+                ++spent;
+            }
+            return true;
+        });
+        WALLET_CHECK(spent == CoinsCount);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bool benchmark = helpers::IsBenchmarkRequested(argc, argv);
+
     int logLevel = LOG_LEVEL_DEBUG;
 #if LOG_VERBOSE_ENABLED
     logLevel = LOG_LEVEL_VERBOSE;
@@ -1447,6 +1768,7 @@ int main()
     auto logger = beam::Logger::create(logLevel, logLevel);
 
     TestSplitKey();
+    TestProofPool(benchmark);
     TestP2PWalletNegotiationST();
     TestP2PWalletReverseNegotiationST();
 
@@ -1455,6 +1777,8 @@ int main()
     TestFSM();
     TestSerializeFSM();
     TestRollback();
+    TestWindowedSync(benchmark);
+    TestBatchPayment(benchmark);
 
     assert(g_failureCount == 0);
     return WALLET_CHECK_RESULT;
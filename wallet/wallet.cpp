@@ -22,11 +22,20 @@
 #include <algorithm>
 #include <random>
 #include <iomanip>
+#include <thread>
 
 namespace
 {
     const char* ReceiverPrefix = "[Receiver] ";
     const char* SenderPrefix = "[Sender] ";
+
+    beam::TxID generate_tx_id()
+    {
+        boost::uuids::uuid id = boost::uuids::random_generator()();
+        beam::TxID txId{};
+        std::copy(id.begin(), id.end(), txId.begin());
+        return txId;
+    }
 }
 
 namespace std
@@ -137,6 +146,7 @@ namespace beam
         : m_keyChain{ keyChain }
         , m_network{ network }
         , m_tx_completed_action{move(action)}
+        , m_proofsWindow{ DefaultProofsWindow }
         , m_newState{}
         , m_knownStateID{}
         , m_syncDone{0}
@@ -159,15 +169,47 @@ namespace beam
 
     TxID Wallet::transfer_money(const WalletID& from, const WalletID& to, Amount amount, Amount fee, bool sender, ByteBuffer&& message)
     {
-        boost::uuids::uuid id = boost::uuids::random_generator()();
-        TxID txId{};
-        copy(id.begin(), id.end(), txId.begin());
+        TxID txId = generate_tx_id();
         TxDescription tx( txId, amount, fee, m_keyChain->getCurrentHeight(), to, from, move(message), getTimestamp(), sender);
         m_keyChain->saveTx(tx);
         resume_negotiator(tx);
         return txId;
     }
 
+    vector<TxID> Wallet::transfer_money(const WalletID& from, const vector<Payment>& payments, Amount fee)
+    {
+        Cleaner c{ m_removedNegotiators };
+        vector<TxID> txIds;
+        vector<Negotiator::Ptr> batch;
+        txIds.reserve(payments.size());
+        batch.reserve(payments.size());
+        Height currentHeight = m_keyChain->getCurrentHeight();
+        for (const auto& payment : payments)
+        {
+            TxID txId = generate_tx_id();
+            TxDescription tx(txId, payment.m_amount, fee, currentHeight, payment.m_to, from, {}, getTimestamp(), true);
+            m_keyChain->saveTx(tx);
+
+            auto s = make_shared<Negotiator>(*this, m_keyChain, tx);
+            m_negotiators.emplace(txId, s);
+            batch.push_back(s);
+            txIds.push_back(txId);
+        }
+
+        if (m_synchronized)
+        {
+            Negotiator::initiate(batch);
+        }
+        else
+        {
+            m_pendingEvents.emplace_back([batch]()
+            {
+                Negotiator::initiate(batch);
+            });
+        }
+        return txIds;
+    }
+
     void Wallet::resume_tx(const TxDescription& tx)
     {
         if (tx.canResume() && m_negotiators.find(tx.m_txId) == m_negotiators.end())
@@ -200,6 +242,9 @@ namespace beam
 
     void Wallet::on_tx_completed(const TxDescription& tx)
     {
+        // whatever way the negotiation ended, its outputs aren't needed anymore
+        m_proofPool.discard(tx.m_txId);
+
         auto it = m_negotiators.find(tx.m_txId);
         if (it != m_negotiators.end())
         {
@@ -239,6 +284,11 @@ namespace beam
         send_tx_message(tx, wallet::TxRegistered{ tx.m_peerId, tx.m_txId, true });
     }
 
+    ProofPool* Wallet::get_proof_pool()
+    {
+        return &m_proofPool;
+    }
+
     void Wallet::handle_tx_message(const WalletID& receiver, Invite&& msg)
     {
         auto stored = m_keyChain->getTx(msg.m_txId);
@@ -394,69 +444,141 @@ namespace beam
         return true;
     }
 
+    void Wallet::set_proofs_window(size_t window)
+    {
+        m_proofsWindow = std::max<size_t>(window, 1);
+    }
+
     bool Wallet::handle_node_message(proto::ProofUtxo&& utxoProof)
     {
-        // TODO: handle the maturity of the several proofs (> 1)
-        if (m_pendingProofs.empty())
+        if (m_requestedProofs.empty())
         {
             LOG_WARNING() << "Unexpected UTXO proof";
             return exit_sync();
         }
 
-        Coin& coin = m_pendingProofs.front();
-        Input input;
-        input.m_Commitment = Commitment(m_keyChain->calcKey(coin), coin.m_amount);
-        if (utxoProof.m_Proofs.empty())
+        m_requestedProofs.front().m_proof = move(utxoProof);
+        m_receivedProofs.push_back(move(m_requestedProofs.front()));
+        m_requestedProofs.pop_front();
+
+        request_proofs();
+
+        if (m_receivedProofs.size() < ProofsBatchSize && !m_requestedProofs.empty())
+        {
+            return true; // verify later, with the rest of the batch
+        }
+
+        return process_proofs();
+    }
+
+    bool Wallet::process_proofs()
+    {
+        vector<PendingProof> batch;
+        batch.swap(m_receivedProofs);
+
+        // verification doesn't touch the db, run it in parallel. The result is the index of the first valid proof
+        vector<int> validProofs(batch.size(), -1);
+        auto verifyRange = [this, &batch, &validProofs](size_t i0, size_t i1)
         {
-            LOG_WARNING() << "Got empty proof for: " << input.m_Commitment;
+            for (size_t i = i0; i < i1; ++i)
+            {
+                const PendingProof& p = batch[i];
+                if (p.m_coin.m_status != Coin::Unconfirmed)
+                {
+                    continue;
+                }
+                // TODO: handle the maturity of the several proofs (> 1)
+                for (size_t j = 0; j < p.m_proof.m_Proofs.size(); ++j)
+                {
+                    if (m_newState.IsValidProofUtxo(p.m_input, p.m_proof.m_Proofs[j]))
+                    {
+                        validProofs[i] = static_cast<int>(j);
+                        break;
+                    }
+                }
+            }
+        };
 
-            if (coin.m_status == Coin::Locked)
+        size_t threadsCount = std::min<size_t>(std::thread::hardware_concurrency(), batch.size() / MinProofsPerThread);
+        if (threadsCount > 1)
+        {
+            vector<thread> threads;
+            for (size_t i = 0; i < threadsCount; ++i)
             {
-                coin.m_status = Coin::Spent;
-                m_keyChain->update(coin);
+                threads.emplace_back(verifyRange, batch.size() * i / threadsCount, batch.size() * (i + 1) / threadsCount);
             }
-            else if (coin.m_status == Coin::Unconfirmed && coin.isReward())
+            for (auto& t : threads)
             {
-                m_keyChain->remove(coin);
+                t.join();
             }
         }
         else
         {
-            for (const auto& proof : utxoProof.m_Proofs)
+            verifyRange(0, batch.size());
+        }
+
+        vector<Coin> toStore, toUpdate, toRemove;
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            Coin& coin = batch[i].m_coin;
+            const Input& input = batch[i].m_input;
+            const auto& proofs = batch[i].m_proof.m_Proofs;
+
+            if (proofs.empty())
             {
-                if (coin.m_status == Coin::Unconfirmed)
+                LOG_WARNING() << "Got empty proof for: " << input.m_Commitment;
+
+                if (coin.m_status == Coin::Locked)
                 {
-                    if (m_newState.IsValidProofUtxo(input, proof))
-                    {
-                        LOG_INFO() << "Got proof for: " << input.m_Commitment;
-                        coin.m_status = Coin::Unspent;
-                        coin.m_maturity = proof.m_State.m_Maturity;
-                        coin.m_confirmHeight = m_newState.m_Height;
-                        m_newState.get_Hash(coin.m_confirmHash);
-                        if (coin.isReward())
-                        {
-                            LOG_INFO() << "Block reward received: " << PrintableAmount(coin.m_amount);
-                        }
-                        if (coin.m_id == 0)
-                        {
-                            m_keyChain->store(coin);
-                        }
-                        else
-                        {
-                            m_keyChain->update(coin);
-                        }
-                    }
-                    else
-                    {
-                        LOG_ERROR() << "Invalid proof provided: " << input.m_Commitment;
-                    }
+                    coin.m_status = Coin::Spent;
+                    toUpdate.push_back(coin);
+                }
+                else if (coin.m_status == Coin::Unconfirmed && coin.isReward())
+                {
+                    toRemove.push_back(coin);
+                }
+            }
+            else if (validProofs[i] >= 0)
+            {
+                LOG_INFO() << "Got proof for: " << input.m_Commitment;
+                coin.m_status = Coin::Unspent;
+                coin.m_maturity = proofs[validProofs[i]].m_State.m_Maturity;
+                coin.m_confirmHeight = m_newState.m_Height;
+                m_newState.get_Hash(coin.m_confirmHash);
+                if (coin.isReward())
+                {
+                    LOG_INFO() << "Block reward received: " << PrintableAmount(coin.m_amount);
+                }
+                if (coin.m_id == 0)
+                {
+                    toStore.push_back(coin);
+                }
+                else
+                {
+                    toUpdate.push_back(coin);
                 }
             }
+            else if (coin.m_status == Coin::Unconfirmed)
+            {
+                LOG_ERROR() << "Invalid proof provided: " << input.m_Commitment;
+            }
         }
 
-        m_pendingProofs.pop_front();
+        // each call is a single db transaction
+        if (!toStore.empty())
+        {
+            m_keyChain->store(toStore);
+        }
+        if (!toUpdate.empty())
+        {
+            m_keyChain->update(toUpdate);
+        }
+        if (!toRemove.empty())
+        {
+            m_keyChain->remove(toRemove);
+        }
 
-        return exit_sync();
+        return exit_sync(static_cast<int>(batch.size()));
     }
 
     bool Wallet::handle_node_message(proto::NewTip&& msg)
@@ -499,6 +621,9 @@ namespace beam
 
         m_network->send_node_message(proto::GetProofState{ m_knownStateID.m_Height });
 
+        // the proofs of the coins that are unconfirmed already don't depend on the rollback, don't wait for it
+        getUtxoProofs(getUnconfirmedCoins());
+
         return true;
     }
 
@@ -587,6 +712,7 @@ namespace beam
                     m_knownStateID = {};
                 }
                 m_stateFinder.reset();
+                forget_processed_proofs();
                 LOG_INFO() << "Rolled back to " << m_knownStateID;
             }
         }
@@ -602,6 +728,9 @@ namespace beam
         copy(m_reg_requests.begin(), m_reg_requests.end(), back_inserter(m_pending_reg_requests));
         m_reg_requests.clear();
         m_pendingProofs.clear();
+        m_requestedProofs.clear();
+        m_receivedProofs.clear();
+        m_proofCoinIDs.clear();
 
         notifySyncProgress();
     }
@@ -615,6 +744,11 @@ namespace beam
         enter_sync(); // Mined
         m_network->send_node_message(proto::GetMined{ m_knownStateID.m_Height });
 
+        getUtxoProofs(getUnconfirmedCoins());
+    }
+
+    vector<Coin> Wallet::getUnconfirmedCoins()
+    {
         vector<Coin> unconfirmed;
         m_keyChain->visit([&](const Coin& coin)
         {
@@ -626,18 +760,51 @@ namespace beam
 
             return true;
         });
-
-        getUtxoProofs(unconfirmed);
+        return unconfirmed;
     }
 
     void Wallet::getUtxoProofs(const vector<Coin>& coins)
     {
         for (auto& coin : coins)
         {
+            if (coin.m_id && !m_proofCoinIDs.insert(coin.m_id).second)
+            {
+                continue; // already requested
+            }
             enter_sync();
-            m_pendingProofs.push_back(coin);
-            Input input;
-            input.m_Commitment = Commitment(m_keyChain->calcKey(coin), coin.m_amount);
+            PendingProof& p = m_pendingProofs.emplace_back();
+            p.m_coin = coin;
+            p.m_input.m_Commitment = Commitment(m_keyChain->calcKey(coin), coin.m_amount);
+        }
+
+        request_proofs();
+    }
+
+    void Wallet::forget_processed_proofs()
+    {
+        // The proofs prefetched before the rollback may have confirmed the coins that are unconfirmed again.
+        // Only the coins with the proofs still in flight are skipped by the next request
+        m_proofCoinIDs.clear();
+        auto keep = [this](const PendingProof& p)
+        {
+            if (p.m_coin.m_id)
+            {
+                m_proofCoinIDs.insert(p.m_coin.m_id);
+            }
+        };
+        for_each(m_pendingProofs.begin(), m_pendingProofs.end(), keep);
+        for_each(m_requestedProofs.begin(), m_requestedProofs.end(), keep);
+        for_each(m_receivedProofs.begin(), m_receivedProofs.end(), keep);
+    }
+
+    void Wallet::request_proofs()
+    {
+        while (!m_pendingProofs.empty() && m_requestedProofs.size() < m_proofsWindow)
+        {
+            m_requestedProofs.push_back(move(m_pendingProofs.front()));
+            m_pendingProofs.pop_front();
+
+            const Input& input = m_requestedProofs.back().m_input;
             LOG_DEBUG() << "Get proof: " << input.m_Commitment;
             m_network->send_node_message(proto::GetProofUtxo{ input, 0 });
         }
@@ -654,11 +821,11 @@ namespace beam
         
     }
 
-    bool Wallet::exit_sync()
+    bool Wallet::exit_sync(int count)
     {
         if (m_syncTotal)
         {
-            ++m_syncDone;
+            m_syncDone += count;
             report_sync_progress();
             assert(m_syncDone <= m_syncTotal);
             if (m_syncDone == m_syncTotal)
@@ -668,6 +835,7 @@ namespace beam
                 LOG_INFO() << "Current state is " << m_knownStateID;
                 m_synchronized = true;
                 m_syncDone = m_syncTotal = 0;
+                m_proofCoinIDs.clear();
                 notifySyncProgress();
                 if (!m_pendingEvents.empty())
                 {
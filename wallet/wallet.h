@@ -16,7 +16,9 @@
 
 #include "wallet/wallet_db.h"
 #include "wallet/negotiator.h"
+#include "wallet/proof_pool.h"
 #include <deque>
+#include <set>
 #include "core/proto.h"
 
 namespace beam
@@ -120,6 +122,16 @@ namespace beam
         virtual ~Wallet();
 
         TxID transfer_money(const WalletID& from, const WalletID& to, Amount amount, Amount fee = 0, bool sender = true, ByteBuffer&& message = {} );
+
+        struct Payment
+        {
+            WalletID m_to;
+            Amount m_amount;
+        };
+
+        /// Sends a batch of payments. Each one is a separate transaction negotiated with its peer,
+        /// but they're initiated together and the range proofs of their outputs are generated on several threads
+        std::vector<TxID> transfer_money(const WalletID& from, const std::vector<Payment>& payments, Amount fee = 0);
         void resume_tx(const TxDescription& tx);
         void resume_all_tx();
 
@@ -131,6 +143,7 @@ namespace beam
         void send_tx_confirmation(const TxDescription& tx, wallet::ConfirmInvitation&&) override;
         void register_tx(const TxDescription& tx, Transaction::Ptr) override;
         void send_tx_registered(const TxDescription& tx) override;
+        wallet::ProofPool* get_proof_pool() override;
 
         void handle_tx_message(const WalletID&, wallet::Invite&&) override;
         void handle_tx_message(const WalletID&, wallet::ConfirmTransaction&&) override;
@@ -158,12 +171,23 @@ namespace beam
 		void emergencyReset() override;
 		bool get_IdentityKeyForNode(ECC::Scalar::Native&, const PeerID& idNode);
 
+        /// Max number of UTXO proof requests in flight during the sync
+        void set_proofs_window(size_t window);
+
+        static constexpr size_t DefaultProofsWindow = 64;
+        static constexpr size_t ProofsBatchSize = 64; // received proofs are verified and committed to the db by batches
+        static constexpr size_t MinProofsPerThread = 8;
+
     private:
         void remove_peer(const TxID& txId);
         void getUtxoProofs(const std::vector<Coin>& coins);
+        std::vector<Coin> getUnconfirmedCoins();
+        void request_proofs();
+        bool process_proofs();
+        void forget_processed_proofs();
         void do_fast_forward();
         void enter_sync();
-        bool exit_sync();
+        bool exit_sync(int count = 1);
         void report_sync_progress();
         bool close_node_connection();
         void register_tx(const TxID& txId, Transaction::Ptr);
@@ -208,14 +232,26 @@ namespace beam
 
         struct StateFinder;
 
+        struct PendingProof
+        {
+            Coin m_coin;
+            Input m_input;
+            proto::ProofUtxo m_proof; // set once received
+        };
+
         IKeyChain::Ptr m_keyChain;
         INetworkIO::Ptr m_network;
         std::map<TxID, wallet::Negotiator::Ptr>   m_negotiators;
         std::vector<wallet::Negotiator::Ptr>      m_removedNegotiators;
+        wallet::ProofPool                         m_proofPool;
         TxCompletedAction m_tx_completed_action;
         std::deque<std::pair<TxID, Transaction::Ptr>> m_reg_requests;
         std::vector<std::pair<TxID, Transaction::Ptr>> m_pending_reg_requests;
-        std::deque<Coin> m_pendingProofs;
+        std::deque<PendingProof> m_pendingProofs;   // not requested yet
+        std::deque<PendingProof> m_requestedProofs; // in flight, the node responds in order
+        std::vector<PendingProof> m_receivedProofs; // waiting for the verification
+        std::set<uint64_t> m_proofCoinIDs;          // coins already requested during this sync
+        size_t m_proofsWindow;
         std::vector<Callback> m_pendingEvents;
 
 		Block::SystemState::Full m_newState;
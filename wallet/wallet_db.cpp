@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "wallet_db.h"
+#include "coin_index.h"
 #include "negotiator.h"
 #include "utility/logger.h"
 #include "sqlite/sqlite3.h"
@@ -89,6 +90,10 @@
     each(12, fsmState,  sep, BLOB, obj) \
     each(13, change,       , INTEGER NOT NULL, obj)
 #define HISTORY_FIELDS ENUM_HISTORY_FIELDS(LIST, COMMA, )
+#define HISTORY_INDICES \
+    "CREATE INDEX IF NOT EXISTS HistoryTimeIndex ON " HISTORY_NAME "(createTime DESC, txId);" \
+    "CREATE INDEX IF NOT EXISTS HistoryStatusIndex ON " HISTORY_NAME "(status, createTime DESC, txId);" \
+    "CREATE INDEX IF NOT EXISTS HistoryPeerIndex ON " HISTORY_NAME "(peerId, createTime DESC, txId);"
 
 #define ENUM_PEER_FIELDS(each, sep, obj) \
     each(1, walletID,    sep, BLOB NOT NULL PRIMARY KEY, obj) \
@@ -141,120 +146,6 @@ namespace beam
             throw runtime_error(ss.str());
         }
 
-        struct CoinSelector2
-        {
-            using Result = pair<Amount, vector<Coin>>;
-            CoinSelector2(const vector<Coin>& coins)
-                : m_coins{coins}
-            {
-
-            }
-
-            Result select(Amount amount)
-            {
-                m_amount = amount;
-                m_result.first = 0;
-                m_result.second.clear();
-
-                GenerateCombinations();
-                FindBestResult();
-                SelectCoins();
-                return m_result;
-            }
-
-        private:
-
-            void GenerateCombinations()
-            {
-                for (auto coin = m_coins.begin(); coin != m_coins.end(); ++coin)
-                {
-                    if (coin->m_amount > m_amount)
-                    {
-                        m_Combinations[coin->m_amount] = coin->m_amount;
-                        continue;
-                    }
-
-                    if (coin->m_amount == m_amount)
-                    {
-                        m_Combinations[coin->m_amount] = coin->m_amount;
-                        break;
-                    }
-
-                    vector<Amount> newCombinations;
-
-                    {
-                        auto it = m_Combinations.find(coin->m_amount);
-                        if (it == m_Combinations.end())
-                        {
-                            newCombinations.push_back(coin->m_amount);
-                        }
-                    }
-
-                    for (const auto& sum : m_Combinations)
-                    {
-                        if (sum.first < m_amount)
-                            newCombinations.push_back(sum.first + coin->m_amount);
-                    }
-
-                    for (const auto& sum : newCombinations)
-                    {
-                        auto it = m_Combinations.find(sum);
-                        if (it == m_Combinations.end())
-                        {
-                            m_Combinations[sum] = coin->m_amount;
-                        }
-                    }
-                }
-            }
-
-            void FindBestResult()
-            {
-                auto it = m_Combinations.lower_bound(m_amount);
-
-                if (it == m_Combinations.end())
-                {
-                    return;
-                }
-
-                m_result.first = it->first;
-
-                for (; it != m_Combinations.end() && it->second > 0; it = m_Combinations.find(it->first - it->second))
-                {
-                    auto i = m_intermediateResult.find(it->second);
-                    if (i == m_intermediateResult.end())
-                    {
-                        m_intermediateResult[it->second] = 1;
-                    }
-                    else
-                    {
-                        ++m_intermediateResult[it->second];
-                    }
-                }
-            }
-
-            void SelectCoins()
-            {
-                for (const auto& p : m_intermediateResult)
-                {
-                    auto it = find_if(m_coins.begin(), m_coins.end(), [amount = p.first](const Coin& c)
-                    {
-                        return c.m_amount == amount;
-                    });
-
-                    for (Amount i = 0; i < p.second; ++i, ++it)
-                    {
-                        m_result.second.push_back(*it);
-                    }
-                }
-            }
-
-            const vector<Coin>& m_coins;
-            Result m_result;
-            Amount m_amount;
-            map<Amount, Amount> m_Combinations;
-            map<Amount, Amount> m_intermediateResult;
-        };
-
         struct CoinSelector
         {
             CoinSelector(const std::vector<Coin>& coins)
@@ -321,16 +212,57 @@ namespace beam
 
     namespace sqlite
     {
+        // Prepared statements of the hot requests, kept for the lifetime of the connection.
+        // The key is the address of the request, so only string literals are supposed to be cached
+        struct StatementCache
+        {
+            ~StatementCache()
+            {
+                clear();
+            }
+
+            sqlite3_stmt* get(sqlite3* db, const char* sql)
+            {
+                auto& stm = m_statements[sql];
+                if (!stm)
+                {
+                    int ret = sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stm, NULL);
+                    throwIfError(ret, db);
+                }
+                return stm;
+            }
+
+            void clear()
+            {
+                for (auto& p : m_statements)
+                {
+                    sqlite3_finalize(p.second);
+                }
+                m_statements.clear();
+            }
+        private:
+            unordered_map<const char*, sqlite3_stmt*> m_statements;
+        };
+
         struct Statement
         {
             Statement(sqlite3* db, const char* sql)
                 : _db(db)
                 , _stm(nullptr)
+                , _cached(false)
             {
                 int ret = sqlite3_prepare_v2(_db, sql, -1, &_stm, NULL);
                 throwIfError(ret, _db);
             }
 
+            // the cached statement is reset on destruction instead of finalization. Mustn't be nested with itself
+            Statement(sqlite3* db, StatementCache& cache, const char* sql)
+                : _db(db)
+                , _stm(cache.get(db, sql))
+                , _cached(true)
+            {
+            }
+
             void bind(int col, int val)
             {
                 int ret = sqlite3_bind_int(_stm, col, val);
@@ -528,12 +460,21 @@ namespace beam
 
             ~Statement()
             {
-                sqlite3_finalize(_stm);
+                if (_cached)
+                {
+                    sqlite3_reset(_stm);
+                    sqlite3_clear_bindings(_stm);
+                }
+                else
+                {
+                    sqlite3_finalize(_stm);
+                }
             }
         private:
 
             sqlite3 * _db;
             sqlite3_stmt* _stm;
+            bool _cached;
         };
 
         struct Transaction
@@ -646,7 +587,9 @@ namespace beam
             {
                 const char* req = "CREATE TABLE " STORAGE_NAME " (" ENUM_ALL_STORAGE_FIELDS(LIST_WITH_TYPES, COMMA,) ");"
                                   "CREATE INDEX ConfirmIndex ON " STORAGE_NAME"(confirmHeight);"
-                                  "CREATE INDEX SpentIndex ON " STORAGE_NAME"(lockedHeight);";
+                                  "CREATE INDEX SpentIndex ON " STORAGE_NAME"(lockedHeight);"
+                                  "CREATE INDEX CreateIndex ON " STORAGE_NAME"(createHeight);"
+                                  "CREATE INDEX CreateTxIndex ON " STORAGE_NAME"(createTxId);";
                 int ret = sqlite3_exec(keychain->_db, req, NULL, NULL, NULL);
                 throwIfError(ret, keychain->_db);
             }
@@ -658,7 +601,8 @@ namespace beam
             }
 
             {
-                const char* req = "CREATE TABLE " HISTORY_NAME " (" ENUM_HISTORY_FIELDS(LIST_WITH_TYPES, COMMA,) ") WITHOUT ROWID;";
+                const char* req = "CREATE TABLE " HISTORY_NAME " (" ENUM_HISTORY_FIELDS(LIST_WITH_TYPES, COMMA,) ") WITHOUT ROWID;"
+                                  HISTORY_INDICES;
                 int ret = sqlite3_exec(keychain->_db, req, NULL, NULL, NULL);
                 throwIfError(ret, keychain->_db);
             }
@@ -758,6 +702,16 @@ namespace beam
                     }
                 }
 
+                {
+                    // the indices are missing in the older dbs. The reward coins are looked up by height on insertion,
+                    // the outputs of a transaction by its id
+                    const char* req = "CREATE INDEX IF NOT EXISTS CreateIndex ON " STORAGE_NAME"(createHeight);"
+                                      "CREATE INDEX IF NOT EXISTS CreateTxIndex ON " STORAGE_NAME"(createTxId);"
+                                      HISTORY_INDICES;
+                    int ret = sqlite3_exec(keychain->_db, req, NULL, NULL, NULL);
+                    throwIfError(ret, keychain->_db);
+                }
+
                 if (keychain->getVar(WalletSeed, seed))
                 {
                     keychain->m_kdf.m_Secret = seed;
@@ -782,6 +736,8 @@ namespace beam
 
     Keychain::Keychain(const ECC::NoLeak<ECC::uintBig>& secretKey)
         : _db(nullptr)
+        , m_coinIndex(make_unique<CoinIndex>())
+        , m_statements(make_unique<sqlite::StatementCache>())
     {
         m_kdf.m_Secret = secretKey;
     }
@@ -790,25 +746,12 @@ namespace beam
     {
         if (_db)
         {
+            m_statements->clear();
             sqlite3_close_v2(_db);
             _db = nullptr;
         }
     }
 
-    uint64_t getLastID(sqlite3* db)
-    {
-        int lastId = 0;
-
-        {
-            const char* req = "SELECT seq FROM sqlite_sequence WHERE name = '" STORAGE_NAME "';";
-            sqlite::Statement stm(db, req);
-            if (stm.step())
-                stm.get(0, lastId);
-        }
-
-        return lastId;
-    }
-
     ECC::Scalar::Native Keychain::calcKey(const beam::Coin& coin) const
     {
         assert(coin.m_key_type != KeyType::Regular || coin.m_id > 0);
@@ -825,80 +768,14 @@ namespace beam
 
     vector<beam::Coin> Keychain::selectCoins(const Amount& amount, bool lock)
     {
-        vector<beam::Coin> coins;
         Block::SystemState::ID stateID = {};
         getSystemStateID(stateID);
-        {
-            sqlite::Statement stm(_db, "SELECT SUM(amount)" STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE status=?1 AND maturity<=?2 ;");
-            stm.bind(1, Coin::Unspent);
-            stm.bind(2, stateID.m_Height);
-            Amount avalableAmount = 0;
-            if (stm.step())
-            {
-                stm.get(0, avalableAmount);
-            }
-            if (avalableAmount < amount)
-            {
-                return coins;
-            }
-        }
-        Amount sum = 0;
-        Coin coin2;
-        {
-            // get one coin >= amount
-            sqlite::Statement stm(_db, "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE status=?1 AND maturity<=?2 AND amount>=?3 ORDER BY amount ASC LIMIT 1;");
-            stm.bind(1, Coin::Unspent);
-            stm.bind(2, stateID.m_Height);
-            stm.bind(3, amount);
-            if (stm.step())
-            {
-                ENUM_ALL_STORAGE_FIELDS(STM_GET_LIST, NOSEP, coin2);
-                sum = coin2.m_amount;
-            }
-        }
-        if (sum == amount)
-        {
-            coins.push_back(coin2);
-        }
-        else
-        {
-            // select all coins less than needed amount in sorted order
-            sqlite::Statement stm(_db, "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE status=?1 AND maturity<=?2 AND amount<?3 ORDER BY amount DESC;");
-            stm.bind(1, Coin::Unspent);
-            stm.bind(2, stateID.m_Height);
-            stm.bind(3, amount);
-            vector<Coin> candidats;
-            Amount smallSum = 0;
-            while (stm.step())
-            {
-                auto& coin = candidats.emplace_back();
-                ENUM_ALL_STORAGE_FIELDS(STM_GET_LIST, NOSEP, coin);
-                smallSum += coin.m_amount;
-            }
-            if (smallSum == amount)
-            {
-                coins.swap(candidats);
-            }
-            else if (smallSum > amount)
-            {
-                CoinSelector2 s{ candidats };
-                auto t = s.select(amount);
 
-                if (sum > amount && sum <= t.first)
-                {
-                    // prefer one coin instead on many
-                    coins.push_back(coin2);
-                }
-                else
-                {
-                    coins = t.second;
-                }
-            }
-            else if (sum > amount)
-            {
-                coins.push_back(coin2);
-            }
+        if (!m_coinIndex->isLoaded())
+        {
+            loadCoinIndex(stateID.m_Height);
         }
+        vector<beam::Coin> coins = m_coinIndex->select(amount, stateID.m_Height);
 
         if (lock)
         {
@@ -908,7 +785,7 @@ namespace beam
             {
                 coin.m_status = Coin::Locked;
                 const char* req = "UPDATE " STORAGE_NAME " SET status=?2, lockedHeight=?3 WHERE id=?1;";
-                sqlite::Statement stm(_db, req);
+                sqlite::Statement stm(_db, *m_statements, req);
 
                 stm.bind(1, coin.m_id);
                 stm.bind(2, coin.m_status);
@@ -919,12 +796,30 @@ namespace beam
 
             trans.commit();
 
+            for (const auto& coin : coins)
+            {
+                m_coinIndex->onChanged(coin);
+            }
+
             notifyKeychainChanged();
         }
         std::sort(coins.begin(), coins.end(), [](const Coin& lhs, const Coin& rhs) {return lhs.m_amount < rhs.m_amount; });
         return coins;
     }
 
+    void Keychain::loadCoinIndex(Height height)
+    {
+        vector<Coin> unspent;
+        sqlite::Statement stm(_db, "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE status=?1;");
+        stm.bind(1, Coin::Unspent);
+        while (stm.step())
+        {
+            auto& coin = unspent.emplace_back();
+            ENUM_ALL_STORAGE_FIELDS(STM_GET_LIST, NOSEP, coin);
+        }
+        m_coinIndex->load(unspent, height);
+    }
+
     std::vector<beam::Coin> Keychain::getCoinsCreatedByTx(const TxID& txId)
     {
         // select all coins for TxID
@@ -946,50 +841,73 @@ namespace beam
     {
         sqlite::Transaction trans(_db);
 
-        storeImpl(coin);
+        bool inserted = storeImpl(coin);
 
         trans.commit();
+
+        if (inserted)
+        {
+            m_coinIndex->onChanged(coin);
+            notifyKeychainChanged();
+        }
     }
 
     void Keychain::store(vector<beam::Coin>& coins)
     {
         if (coins.empty()) return;
 
+        vector<char> inserted(coins.size());
+
         sqlite::Transaction trans(_db);
-        for (auto& coin : coins)
+        for (size_t i = 0; i < coins.size(); ++i)
         {
-            storeImpl(coin);
+            inserted[i] = storeImpl(coins[i]);
         }
 
         trans.commit();
+
+        bool changed = false;
+        for (size_t i = 0; i < coins.size(); ++i)
+        {
+            if (inserted[i])
+            {
+                m_coinIndex->onChanged(coins[i]);
+                changed = true;
+            }
+        }
+
+        // single notification for the whole batch
+        if (changed)
+        {
+            notifyKeychainChanged();
+        }
     }
 
-    void Keychain::storeImpl(Coin& coin)
+    bool Keychain::storeImpl(Coin& coin)
     {
         assert(coin.m_amount > 0 && coin.isValid());
         if (coin.m_key_type == KeyType::Coinbase
             || coin.m_key_type == KeyType::Comission)
         {
             const char* req = "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE createHeight=?1 AND key_type=?2;";
-            sqlite::Statement stm(_db, req);
+            sqlite::Statement stm(_db, *m_statements, req);
             stm.bind(1, coin.m_createHeight);
             stm.bind(2, coin.m_key_type);
             if (stm.step()) //has row
             {
-                return; // skip existing
+                return false; // skip existing
             }
         }
 
         const char* req = "INSERT INTO " STORAGE_NAME " (" ENUM_STORAGE_FIELDS(LIST, COMMA, ) ") VALUES(" ENUM_STORAGE_FIELDS(BIND_LIST, COMMA, ) ");";
-        sqlite::Statement stm(_db, req);
+        sqlite::Statement stm(_db, *m_statements, req);
 
         ENUM_STORAGE_FIELDS(STM_BIND_LIST, NOSEP, coin);
 
         stm.step();
 
-        coin.m_id = getLastID(_db);
-
-        notifyKeychainChanged();
+        coin.m_id = sqlite3_last_insert_rowid(_db);
+        return true;
     }
 
     void Keychain::update(const beam::Coin& coin)
@@ -997,17 +915,12 @@ namespace beam
         assert(coin.m_amount > 0 && coin.m_id > 0 && coin.isValid());
         sqlite::Transaction trans(_db);
 
-        {
-            const char* req = "UPDATE " STORAGE_NAME " SET " ENUM_STORAGE_FIELDS(SET_LIST, COMMA, ) " WHERE id=?1;";
-            sqlite::Statement stm(_db, req);
-
-            ENUM_ALL_STORAGE_FIELDS(STM_BIND_LIST, NOSEP, coin);
-
-            stm.step();
-        }
+        updateImpl(coin);
 
         trans.commit();
 
+        m_coinIndex->onChanged(coin);
+
         notifyKeychainChanged();
     }
 
@@ -1020,15 +933,16 @@ namespace beam
             for (const auto& coin : coins)
             {
                 assert(coin.m_amount > 0 && coin.m_id > 0 && coin.isValid());
-                const char* req = "UPDATE " STORAGE_NAME " SET " ENUM_STORAGE_FIELDS(SET_LIST, COMMA, ) " WHERE id=?1;";
-                sqlite::Statement stm(_db, req);
+                updateImpl(coin);
+            }
 
-                ENUM_ALL_STORAGE_FIELDS(STM_BIND_LIST, NOSEP, coin);
+            trans.commit();
 
-                stm.step();
+            for (const auto& coin : coins)
+            {
+                m_coinIndex->onChanged(coin);
             }
 
-            trans.commit();
             notifyKeychainChanged();
         }
     }
@@ -1041,16 +955,16 @@ namespace beam
 
             for (const auto& coin : coins)
             {
-                const char* req = "DELETE FROM " STORAGE_NAME " WHERE id=?1;";
-                sqlite::Statement stm(_db, req);
-
-                stm.bind(1, coin.m_id);
-
-                stm.step();
+                removeImpl(coin.m_id);
             }
 
             trans.commit();
 
+            for (const auto& coin : coins)
+            {
+                m_coinIndex->onRemoved(coin.m_id);
+            }
+
             notifyKeychainChanged();
         }
     }
@@ -1059,29 +973,48 @@ namespace beam
     {
         sqlite::Transaction trans(_db);
 
-        const char* req = "DELETE FROM " STORAGE_NAME " WHERE id=?1;";
-        sqlite::Statement stm(_db, req);
+        removeImpl(coin.m_id);
 
-        stm.bind(1, coin.m_id);
-
-        stm.step();
         trans.commit();
 
+        m_coinIndex->onRemoved(coin.m_id);
+
         notifyKeychainChanged();
     }
 
+    void Keychain::updateImpl(const Coin& coin)
+    {
+        const char* req = "UPDATE " STORAGE_NAME " SET " ENUM_STORAGE_FIELDS(SET_LIST, COMMA, ) " WHERE id=?1;";
+        sqlite::Statement stm(_db, *m_statements, req);
+
+        ENUM_ALL_STORAGE_FIELDS(STM_BIND_LIST, NOSEP, coin);
+
+        stm.step();
+    }
+
+    void Keychain::removeImpl(uint64_t id)
+    {
+        const char* req = "DELETE FROM " STORAGE_NAME " WHERE id=?1;";
+        sqlite::Statement stm(_db, *m_statements, req);
+
+        stm.bind(1, id);
+
+        stm.step();
+    }
+
     void Keychain::clear()
     {
         {
             sqlite::Statement stm(_db, "DELETE FROM " STORAGE_NAME ";");
             stm.step();
+            m_coinIndex->reset();
             notifyKeychainChanged();
         }
 
         {
             sqlite::Statement stm(_db, "DELETE FROM " HISTORY_NAME ";");
             stm.step();
-            notifyTransactionChanged();
+            notifyTransactionChanged(ChangeAction::Reset, {});
         }
     }
 
@@ -1238,13 +1171,66 @@ namespace beam
         }
 
         trans.commit();
+        m_coinIndex->reset(); // will be reloaded on demand
         notifyKeychainChanged();
     }
 
+    vector<TxDescription> Keychain::getTxHistory(const TxHistoryQuery& query)
+    {
+        // the filters and the order are served by the indices, see HISTORY_INDICES
+        string req = "SELECT * FROM " HISTORY_NAME " WHERE createTime>=?1";
+        if (query.m_to)
+        {
+            req += " AND createTime<=?2";
+        }
+        if (query.m_status)
+        {
+            req += " AND status=?3";
+        }
+        if (query.m_peerId)
+        {
+            req += " AND peerId=?4";
+        }
+        if (query.m_after)
+        {
+            req += " AND (createTime<?5 OR (createTime=?5 AND txId>?6))";
+        }
+        req += " ORDER BY createTime DESC, txId LIMIT ?7 ;";
+
+        sqlite::Statement stm(_db, req.c_str());
+        stm.bind(1, query.m_from);
+        if (query.m_to)
+        {
+            stm.bind(2, *query.m_to);
+        }
+        if (query.m_status)
+        {
+            stm.bind(3, *query.m_status);
+        }
+        if (query.m_peerId)
+        {
+            stm.bind(4, *query.m_peerId);
+        }
+        if (query.m_after)
+        {
+            stm.bind(5, query.m_after->m_createTime);
+            stm.bind(6, query.m_after->m_txId);
+        }
+        stm.bind(7, query.m_count);
+
+        vector<TxDescription> res;
+        while (stm.step())
+        {
+            auto& tx = res.emplace_back(TxDescription{});
+            ENUM_HISTORY_FIELDS(STM_GET_LIST, NOSEP, tx);
+        }
+        return res;
+    }
+
     vector<TxDescription> Keychain::getTxHistory(uint64_t start, int count)
     {
         vector<TxDescription> res;
-        const char* req = "SELECT * FROM " HISTORY_NAME " ORDER BY createTime DESC LIMIT ?1 OFFSET ?2 ;";
+        const char* req = "SELECT * FROM " HISTORY_NAME " ORDER BY createTime DESC, txId LIMIT ?1 OFFSET ?2 ;";
 
         sqlite::Statement stm(_db, req);
         stm.bind(1, count);
@@ -1277,6 +1263,7 @@ namespace beam
     void Keychain::saveTx(const TxDescription& p)
     {
         sqlite::Transaction trans(_db);
+        ChangeAction action = ChangeAction::Added;
 
         {
             const char* selectReq = "SELECT * FROM " HISTORY_NAME " WHERE txId=?1;";
@@ -1285,6 +1272,7 @@ namespace beam
 
             if (stm2.step())
             {
+                action = ChangeAction::Updated;
                 const char* updateReq = "UPDATE " HISTORY_NAME " SET modifyTime=?2, status=?3, fsmState=?4, minHeight=?5, change=?6 WHERE txId=?1;";
                 sqlite::Statement stm(_db, updateReq);
 
@@ -1307,11 +1295,24 @@ namespace beam
 
         trans.commit();
 
-        notifyTransactionChanged();
+        if (action == ChangeAction::Added)
+        {
+            notifyTransactionChanged(action, { p });
+        }
+        else if (auto tx = getTx(p.m_txId))
+        {
+            notifyTransactionChanged(action, { *tx }); // only some of the fields are updated
+        }
     }
 
     void Keychain::deleteTx(const TxID& txId)
     {
+        auto tx = getTx(txId);
+        if (!tx)
+        {
+            return;
+        }
+
         sqlite::Transaction trans(_db);
 
         {
@@ -1325,7 +1326,7 @@ namespace beam
 
         trans.commit();
 
-        notifyTransactionChanged();
+        notifyTransactionChanged(ChangeAction::Removed, { *tx });
     }
 
     void Keychain::rollbackTx(const TxID& txId)
@@ -1347,6 +1348,7 @@ namespace beam
             stm.step();
         }
         trans.commit();
+        m_coinIndex->reset(); // will be reloaded on demand
         notifyKeychainChanged();
     }
 
@@ -1502,9 +1504,9 @@ namespace beam
         for (auto sub : m_subscribers) sub->onKeychainChanged();
     }
 
-    void Keychain::notifyTransactionChanged()
+    void Keychain::notifyTransactionChanged(ChangeAction action, const vector<TxDescription>& items)
     {
-        for (auto sub : m_subscribers) sub->onTransactionChanged();
+        for (auto sub : m_subscribers) sub->onTransactionChanged(action, items);
     }
 
     void Keychain::notifySystemStateChanged()
@@ -25,6 +25,12 @@ struct sqlite3;
 
 namespace beam
 {
+    class CoinIndex;
+    namespace sqlite
+    {
+        struct StatementCache;
+    }
+
     struct Coin
     {
         enum Status
@@ -77,10 +83,41 @@ namespace beam
         bool m_own;
     };
 
+    enum class ChangeAction
+    {
+        Added,
+        Removed,
+        Updated,
+        Reset // everything is removed
+    };
+
+    /// Filtered page of the transaction history, the newest first.
+    /// Pages are continued after the last row of the previous one (keyset pagination), not by offset
+    struct TxHistoryQuery
+    {
+        Timestamp m_from = 0; // createTime range, inclusive
+        boost::optional<Timestamp> m_to;
+        boost::optional<TxDescription::Status> m_status;
+        boost::optional<WalletID> m_peerId;
+        int m_count = 100;
+
+        struct Cursor
+        {
+            Timestamp m_createTime;
+            TxID m_txId;
+        };
+        boost::optional<Cursor> m_after;
+
+        void continueAfter(const TxDescription& tx)
+        {
+            m_after = Cursor{ tx.m_createTime, tx.m_txId };
+        }
+    };
+
     struct IKeyChainObserver
     {
         virtual void onKeychainChanged() = 0;
-        virtual void onTransactionChanged() = 0;
+        virtual void onTransactionChanged(ChangeAction action, const std::vector<TxDescription>& items) = 0; // only the modified rows
         virtual void onSystemStateChanged() = 0;
         virtual void onTxPeerChanged() = 0;
         virtual void onAddressChanged() = 0;
@@ -116,6 +153,7 @@ namespace beam
         virtual void rollbackConfirmedUtxo(Height minHeight) = 0;
 
         virtual std::vector<TxDescription> getTxHistory(uint64_t start = 0, int count = std::numeric_limits<int>::max()) = 0;
+        virtual std::vector<TxDescription> getTxHistory(const TxHistoryQuery& query) = 0;
         virtual boost::optional<TxDescription> getTx(const TxID& txId) = 0;
         virtual void saveTx(const TxDescription& p) = 0;
         virtual void deleteTx(const TxID& txId) = 0;
@@ -187,6 +225,7 @@ namespace beam
         void rollbackConfirmedUtxo(Height minHeight) override;
 
         std::vector<TxDescription> getTxHistory(uint64_t start, int count) override;
+        std::vector<TxDescription> getTxHistory(const TxHistoryQuery& query) override;
         boost::optional<TxDescription> getTx(const TxID& txId) override;
         void saveTx(const TxDescription& p) override;
         void deleteTx(const TxID& txId) override;
@@ -211,15 +250,20 @@ namespace beam
 
 		void changePassword(const SecString& password) override;
     private:
-        void storeImpl(Coin& coin);
+        bool storeImpl(Coin& coin); // returns false if skipped
+        void updateImpl(const Coin& coin);
+        void removeImpl(uint64_t id);
+        void loadCoinIndex(Height height);
         void notifyKeychainChanged();
-        void notifyTransactionChanged();
+        void notifyTransactionChanged(ChangeAction action, const std::vector<TxDescription>& items);
         void notifySystemStateChanged();
         void notifyAddressChanged();
     private:
 
         sqlite3* _db;
         ECC::Kdf m_kdf;
+        std::unique_ptr<CoinIndex> m_coinIndex; // unspent coins, to select without scanning the db
+        std::unique_ptr<sqlite::StatementCache> m_statements; // coin writes, reused by the bulk operations
 
         std::vector<IKeyChainObserver*> m_subscribers;
     };
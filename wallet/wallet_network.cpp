@@ -330,24 +330,27 @@ namespace beam {
         uint8_t* out = 0;
         uint32_t size = 0;
 
+        vector<PubKey> keys;
+        vector<const WalletID*> receivers;
         for (const auto& k : m_myPubKeys)
         {
-            uint32_t channel = channel_from_wallet_id(k);
-
-            if (channel != msg.m_Channel) continue;
-            if (m_keystore->decrypt(out, size, msg.m_Message, k))
-            {
-                LOG_DEBUG() << "Succeeded to decrypt BBS message from channel=" << msg.m_Channel;
-                m_lastReceiver = &k;
-                return handle_decrypted_message(msg.m_TimePosted, out, size);
-            }
-            else
+            if (channel_from_wallet_id(k) == msg.m_Channel)
             {
-                LOG_DEBUG() << "failed to decrypt BBS message from channel=" << msg.m_Channel;
+                keys.push_back(k);
+                receivers.push_back(&k);
             }
         }
 
-        return true;
+        int i = m_keystore->decrypt_any(out, size, msg.m_Message, keys);
+        if (i < 0)
+        {
+            LOG_DEBUG() << "BBS message from channel=" << msg.m_Channel << " is not for us, keys tried=" << keys.size();
+            return true;
+        }
+
+        LOG_DEBUG() << "Succeeded to decrypt BBS message from channel=" << msg.m_Channel;
+        m_lastReceiver = receivers[i];
+        return handle_decrypted_message(msg.m_TimePosted, out, size);
     }
 
     void WalletNetworkIO::set_node_address(io::Address node_address)